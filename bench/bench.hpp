@@ -0,0 +1,59 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+
+namespace phase2::bench
+{
+
+	/**
+	 * @brief Keep the compiler from optimizing a value away.
+	 *
+	 * @param value the value to keep.
+	 */
+	template <typename T>
+	inline void do_not_optimize(const T &value)
+	{
+		asm volatile("" : : "r,m"(value) : "memory");
+	}
+
+	/**
+	 * @brief Run a function repeatedly and measure the average time of a call.
+	 *
+	 * @param function the function to run.
+	 * @param iterations number of calls to measure.
+	 * @return nanoseconds per call.
+	 */
+	template <typename Function>
+	double measure(Function &&function, std::size_t iterations)
+	{
+		for (std::size_t i = 0; i < iterations / 10 + 1; ++i)
+			function();
+
+		auto start = std::chrono::steady_clock::now();
+		for (std::size_t i = 0; i < iterations; ++i)
+			function();
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / static_cast<double>(iterations);
+	}
+
+	/**
+	 * @brief Print a benchmark result.
+	 *
+	 * @param name the name of the benchmark.
+	 * @param ns nanoseconds per operation.
+	 * @param bytes bytes processed per operation, 0 to omit the throughput.
+	 */
+	inline void report(std::string_view name, double ns, std::size_t bytes = 0)
+	{
+		std::cout << std::left << std::setw(48) << name << std::right << std::fixed
+				  << std::setprecision(2) << std::setw(12) << ns << " ns/op";
+		if (bytes != 0)
+			std::cout << std::setw(10) << static_cast<double>(bytes) / ns << " GB/s";
+		std::cout << '\n';
+	}
+
+} // namespace phase2::bench
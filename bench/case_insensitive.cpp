@@ -0,0 +1,129 @@
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include <phase2/Http.hpp>
+#include <phase2/utils/HeaderMap.hpp>
+
+#include "bench.hpp"
+
+using namespace phase2;
+
+/**
+ * @brief The comparison used before the SWAR version: tolower and at() on
+ * every byte.
+ */
+bool legacy_equal(std::string_view lhs, std::string_view rhs)
+{
+	if (lhs.size() != rhs.size())
+		return false;
+	for (std::size_t i = 0; i < lhs.size(); ++i)
+		if (std::tolower(static_cast<unsigned char>(lhs.at(i))) != std::tolower(static_cast<unsigned char>(rhs.at(i))))
+			return false;
+	return true;
+}
+
+/**
+ * @brief The hash used before the SWAR version: a lowercase copy of the key
+ * hashed with std::hash.
+ */
+std::size_t legacy_hash(std::string_view str)
+{
+	std::string tmp;
+	tmp.reserve(str.size());
+	for (const char &c : str)
+		tmp.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+	return std::hash<std::string>()(tmp);
+}
+
+constexpr std::array<std::string_view, 12> names{
+	"Host",           "Connection",     "Cache-Control",   "sec-ch-ua-platform",
+	"User-Agent",     "Accept",         "Sec-Fetch-Site",  "Upgrade-Insecure-Requests",
+	"Accept-Encoding", "Accept-Language", "X-Custom-Tracing-Header-Id", "Cookie"};
+
+constexpr std::array<std::string_view, 12> folded{
+	"host",           "CONNECTION",     "cache-control",   "Sec-CH-UA-Platform",
+	"user-agent",     "ACCEPT",         "sec-fetch-site",  "upgrade-insecure-requests",
+	"accept-encoding", "accept-language", "x-custom-tracing-header-id", "COOKIE"};
+
+constexpr std::string_view request =
+	"GET /wiki/Hypertext_Transfer_Protocol HTTP/1.1\r\n"
+	"Host: en.wikipedia.org\r\n"
+	"Connection: keep-alive\r\n"
+	"Cache-Control: max-age=0\r\n"
+	"sec-ch-ua: \"Chromium\";v=\"118\", \"Google Chrome\";v=\"118\", \"Not=A?Brand\";v=\"99\"\r\n"
+	"sec-ch-ua-mobile: ?0\r\n"
+	"sec-ch-ua-platform: \"Windows\"\r\n"
+	"Upgrade-Insecure-Requests: 1\r\n"
+	"User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36\r\n"
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9\r\n"
+	"Sec-Fetch-Site: same-origin\r\n"
+	"Sec-Fetch-Mode: navigate\r\n"
+	"Sec-Fetch-User: ?1\r\n"
+	"Sec-Fetch-Dest: document\r\n"
+	"X-Custom-Tracing-Header-Id: 0123456789abcdef\r\n"
+	"X-Forwarded-For: 203.0.113.7\r\n"
+	"Referer: https://en.wikipedia.org/wiki/Main_Page\r\n"
+	"Accept-Encoding: gzip, deflate, br\r\n"
+	"Accept-Language: en-US,en;q=0.9,zh-TW;q=0.8\r\n"
+	"Cookie: WMF-Last-Access=17-Oct-2026; GeoIP=TW:TPE:Taipei:25.05:121.53:v4\r\n"
+	"\r\n";
+
+int main()
+{
+	constexpr std::size_t iterations = 1000000;
+
+	bench::report("hash 12 names (tolower + std::hash)",
+				  bench::measure(
+					  []
+					  {
+						  std::size_t hash = 0;
+						  for (std::string_view name : names)
+							  hash ^= legacy_hash(name);
+						  bench::do_not_optimize(hash);
+					  },
+					  iterations));
+	bench::report("hash 12 names (CaseInsensitiveHash)",
+				  bench::measure(
+					  []
+					  {
+						  std::size_t hash = 0;
+						  for (std::string_view name : names)
+							  hash ^= CaseInsensitiveHash{}(name);
+						  bench::do_not_optimize(hash);
+					  },
+					  iterations));
+
+	bench::report("compare 12 names (tolower + at)",
+				  bench::measure(
+					  []
+					  {
+						  std::size_t equal = 0;
+						  for (std::size_t i = 0; i < names.size(); ++i)
+							  equal += legacy_equal(names[i], folded[i]);
+						  bench::do_not_optimize(equal);
+					  },
+					  iterations));
+	bench::report("compare 12 names (CaseInsensitiveEqual)",
+				  bench::measure(
+					  []
+					  {
+						  std::size_t equal = 0;
+						  for (std::size_t i = 0; i < names.size(); ++i)
+							  equal += CaseInsensitiveEqual{}(names[i], folded[i]);
+						  bench::do_not_optimize(equal);
+					  },
+					  iterations));
+
+	bench::report("HttpRequestHeaderView, 20 fields",
+				  bench::measure([] { bench::do_not_optimize(HttpRequestHeaderView{request}); }, iterations),
+				  request.size());
+	bench::report("HttpRequestHeader, 20 fields",
+				  bench::measure([] { bench::do_not_optimize(HttpRequestHeader{request}); }, iterations / 10),
+				  request.size());
+
+	return 0;
+}
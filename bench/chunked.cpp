@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <phase2/Chunked.hpp>
+
+#include "bench.hpp"
+
+using namespace phase2;
+
+constexpr std::size_t body_size     = 16 << 20;
+constexpr std::size_t fragment_size = 64 << 10;
+constexpr std::size_t passes        = 128;
+constexpr std::size_t iov_batch     = 1024; // IOV_MAX on Linux
+
+/**
+ * @brief Encode a body with chunks of a fixed size.
+ */
+std::string make_stream(const std::string &body, std::size_t chunk_size)
+{
+	std::vector<iovec> iov;
+	ChunkedEncoder encoder;
+	for (std::size_t i = 0; i < body.size(); i += chunk_size)
+		encoder.encode(std::string_view{body}.substr(i, chunk_size), iov);
+	encoder.finish(iov);
+
+	std::string stream;
+	for (const iovec &segment : iov)
+		stream.append(static_cast<const char *>(segment.iov_base), segment.iov_len);
+	return stream;
+}
+
+/**
+ * @brief Decode a stream fed in fragments, as it comes from a socket.
+ *
+ * @return the number of body bytes.
+ */
+std::size_t decode_stream(std::string_view stream)
+{
+	ChunkedDecoder decoder;
+	std::size_t size = 0;
+	for (std::size_t offset = 0; offset < stream.size(); offset += fragment_size)
+	{
+		std::string_view input = stream.substr(offset, fragment_size);
+		std::string_view data;
+		ParseStatus status;
+		do
+		{
+			status = decoder.decode(input, data);
+			size += data.size();
+			bench::do_not_optimize(data.data());
+		} while (status == ParseStatus::NEED_MORE && !input.empty());
+	}
+	return size;
+}
+
+int main()
+{
+	const std::string body(body_size, 'x');
+	const int null_fd = ::open("/dev/null", O_WRONLY);
+
+	for (std::size_t chunk_size : {std::size_t{1} << 10, std::size_t{16} << 10})
+	{
+		const std::string suffix = ", " + std::to_string(chunk_size >> 10) + "KB chunks, 16MB body";
+		const std::string stream = make_stream(body, chunk_size);
+
+		bench::report("copy the stream (baseline)" + suffix,
+					  bench::measure(
+						  [&stream]
+						  {
+							  static std::string copy(stream.size(), '\0');
+							  std::memcpy(copy.data(), stream.data(), stream.size());
+							  bench::do_not_optimize(copy.data());
+						  },
+						  passes),
+					  stream.size());
+		bench::report("ChunkedDecoder, 64KB fragments" + suffix,
+					  bench::measure([&stream] { bench::do_not_optimize(decode_stream(stream)); }, passes),
+					  stream.size());
+
+		std::vector<iovec> iov;
+		ChunkedEncoder encoder;
+		bench::report("ChunkedEncoder to iovecs" + suffix,
+					  bench::measure(
+						  [&]
+						  {
+							  iov.clear();
+							  encoder.clear();
+							  for (std::size_t i = 0; i < body.size(); i += chunk_size)
+								  encoder.encode(std::string_view{body}.substr(i, chunk_size), iov);
+							  encoder.finish(iov);
+							  bench::do_not_optimize(iov.data());
+						  },
+						  passes),
+					  body.size());
+		bench::report("ChunkedEncoder + writev to /dev/null" + suffix,
+					  bench::measure(
+						  [&]
+						  {
+							  for (std::size_t i = 0; i < iov.size(); i += iov_batch)
+							  {
+								  const int count = static_cast<int>(std::min(iov_batch, iov.size() - i));
+								  bench::do_not_optimize(::writev(null_fd, iov.data() + i, count));
+							  }
+						  },
+						  passes),
+					  body.size());
+	}
+
+	::close(null_fd);
+	return 0;
+}
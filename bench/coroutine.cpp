@@ -0,0 +1,170 @@
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <phase2/HttpCoroutine.hpp>
+#include <phase2/HttpServer.hpp>
+
+#include "bench.hpp"
+
+using namespace phase2;
+
+#if defined(__cpp_impl_coroutine)
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::string_view request = "GET /plaintext HTTP/1.1\r\nHost: localhost\r\n\r\n";
+constexpr std::string_view body    = "Hello, world!";
+constexpr std::size_t total        = 200000;
+constexpr std::size_t connections  = 32;
+constexpr std::size_t depth        = 16;
+
+/**
+ * @brief Connect a blocking client socket to the server.
+ */
+int connect_client(std::uint16_t port)
+{
+	sockaddr_in addr{};
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	const int fd         = ::socket(AF_INET, SOCK_STREAM, 0);
+	const int nodelay    = 1;
+	::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+	if (::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0)
+	{
+		::close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * @brief Read until count responses ending with the body arrived.
+ */
+bool read_responses(int fd, std::string &buf, std::size_t count)
+{
+	std::size_t seen = 0;
+	std::size_t size = 0;
+	buf.resize(64 * 1024);
+	while (seen < count)
+	{
+		const ssize_t n = ::read(fd, buf.data() + size, buf.size() - size);
+		if (n <= 0)
+			return false;
+		size += static_cast<std::size_t>(n);
+
+		// keep the unfinished response for the next read
+		std::string_view unread{buf.data(), size};
+		for (std::size_t pos = unread.find(body); pos != std::string_view::npos; pos = unread.find(body))
+		{
+			++seen;
+			unread.remove_prefix(pos + body.size());
+		}
+		const std::size_t left = unread.size();
+		buf.erase(0, size - left);
+		size = left;
+		buf.resize(64 * 1024);
+	}
+	return true;
+}
+
+/**
+ * @brief Send rounds of pipelined requests over every connection and print
+ * the throughput.
+ *
+ * @param name the name of the server.
+ * @param port the server port.
+ */
+void bench_server(const std::string &name, std::uint16_t port)
+{
+	std::vector<int> fds;
+	for (std::size_t i = 0; i < connections; ++i)
+		fds.push_back(connect_client(port));
+
+	std::string batch;
+	for (std::size_t i = 0; i < depth; ++i)
+		batch += request;
+	std::string buf;
+	const std::size_t rounds = total / (connections * depth);
+
+	const Clock::time_point start = Clock::now();
+	for (std::size_t round = 0; round < rounds; ++round)
+	{
+		for (int fd : fds)
+			bench::do_not_optimize(::write(fd, batch.data(), batch.size()));
+		for (int fd : fds)
+			if (!read_responses(fd, buf, depth))
+			{
+				std::cerr << "coroutine benchmark failed, connection closed\n";
+				return;
+			}
+	}
+	const std::chrono::duration<double> elapsed = Clock::now() - start;
+	for (int fd : fds)
+		::close(fd);
+
+	// reported as nanoseconds per request
+	bench::report(name + ", " + std::to_string(connections) + " conns, " + std::to_string(depth) + " pipelined",
+				  elapsed.count() * 1e9 / static_cast<double>(rounds * connections * depth));
+}
+
+int main()
+{
+	ServerConfig config;
+	config.backend = ServerBackend::EPOLL;
+	HttpServer server{[](const HttpRequestHeader &, std::string_view)
+					  {
+						  HttpResponse response;
+						  response.header.setStatus(HttpResponseHeader::StatusCode::ok);
+						  response.body = body;
+						  return response;
+					  },
+					  config};
+	if (server.listen("127.0.0.1", 0))
+	{
+		std::thread server_thread{[&server] { server.run(); }};
+		bench_server("HttpServer epoll", server.port());
+		server.stop();
+		server_thread.join();
+	}
+
+	AsyncHttpServer async_server{[](HttpConnection &connection) -> HttpTask
+								 {
+									 while (co_await connection.readRequest())
+									 {
+										 HttpResponseHeader header;
+										 header.setStatus(HttpResponseHeader::StatusCode::ok);
+										 if (!co_await connection.writeResponse(std::move(header), body))
+											 break;
+									 }
+								 }};
+	if (async_server.listen("127.0.0.1", 0))
+	{
+		std::thread server_thread{[&async_server] { async_server.run(); }};
+		bench_server("AsyncHttpServer", async_server.port());
+		async_server.stop();
+		server_thread.join();
+	}
+	return 0;
+}
+
+#else
+
+int main()
+{
+	std::cout << "the coroutine benchmark needs C++20, run make bench CXX_STD=c++20 BUILD_DIR=./build/cxx20\n";
+	return 0;
+}
+
+#endif
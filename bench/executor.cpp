@@ -0,0 +1,57 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <phase2/utils/WorkStealingExecutor.hpp>
+
+#include "bench.hpp"
+
+using namespace phase2;
+
+constexpr std::size_t tasks = 100000;
+
+/**
+ * @brief Submit tasks from one thread, like an event loop does, and wait
+ * until the workers ran them.
+ *
+ * @param executor the executor.
+ * @param work the number of loop iterations of a task.
+ * @return nanoseconds per task.
+ */
+double offload(WorkStealingExecutor &executor, std::size_t work)
+{
+	return bench::measure(
+			   [&executor, work]
+			   {
+				   const std::uint64_t target = executor.executed() + tasks;
+				   for (std::size_t i = 0; i < tasks; ++i)
+					   executor.submit(
+						   [work]
+						   {
+							   std::size_t sum = 0;
+							   for (std::size_t j = 0; j < work; ++j)
+								   bench::do_not_optimize(sum += j);
+						   });
+				   while (executor.executed() < target)
+					   std::this_thread::yield();
+			   },
+			   4) /
+		   static_cast<double>(tasks);
+}
+
+int main()
+{
+	for (std::size_t threads : {1, 4})
+	{
+		WorkStealingExecutor executor{threads};
+		for (std::size_t work : {0, 1000})
+			bench::report("WorkStealingExecutor, " + std::to_string(threads) + " worker(s), " + std::to_string(work) +
+							  " iterations per task",
+						  offload(executor, work));
+		std::cout << "    steals: " << executor.steals() << " of " << executor.executed() << " tasks\n";
+	}
+	return 0;
+}
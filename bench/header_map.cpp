@@ -0,0 +1,145 @@
+#include <array>
+#include <cstddef>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#include <phase2/utils/HeaderMap.hpp>
+
+#include "bench.hpp"
+
+using namespace phase2;
+
+/**
+ * @brief The header container used before HeaderMap became a flat vector.
+ */
+using LegacyHeaderMap = std::unordered_map<std::string, std::list<std::string>,
+										   CaseInsensitiveHash, CaseInsensitiveEqual>;
+
+constexpr std::array<std::pair<std::string_view, std::string_view>, 16> fields{{
+	{"Host", "en.wikipedia.org"},
+	{"Connection", "keep-alive"},
+	{"Cache-Control", "max-age=0"},
+	{"sec-ch-ua", "\"Chromium\";v=\"118\", \"Google Chrome\";v=\"118\""},
+	{"sec-ch-ua-mobile", "?0"},
+	{"sec-ch-ua-platform", "\"Windows\""},
+	{"Upgrade-Insecure-Requests", "1"},
+	{"User-Agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36"},
+	{"Accept", "text/html,application/xhtml+xml,application/xml;q=0.9"},
+	{"Sec-Fetch-Site", "same-origin"},
+	{"Sec-Fetch-Mode", "navigate"},
+	{"Sec-Fetch-Dest", "document"},
+	{"Referer", "https://en.wikipedia.org/wiki/Main_Page"},
+	{"Accept-Encoding", "gzip, deflate, br"},
+	{"Accept-Language", "en-US,en;q=0.9"},
+	{"Cookie", "WMF-Last-Access=17-Oct-2026"},
+}};
+
+constexpr std::array<std::string_view, 6> lookups{
+	"host", "CONTENT-LENGTH", "Content-Type", "connection", "accept-encoding", "user-agent"};
+
+constexpr std::array<HeaderId, 6> ids{HeaderId::HOST,       HeaderId::CONTENT_LENGTH,  HeaderId::CONTENT_TYPE,
+									  HeaderId::CONNECTION, HeaderId::ACCEPT_ENCODING, HeaderId::USER_AGENT};
+
+LegacyHeaderMap legacy_insert()
+{
+	LegacyHeaderMap map;
+	for (const auto &field : fields)
+	{
+		std::string field_str{field.first};
+		map.emplace(field_str, std::list<std::string>());
+		map.at(field_str).emplace_back(field.second);
+	}
+	return map;
+}
+
+HeaderMap flat_insert()
+{
+	HeaderMap map;
+	for (const auto &field : fields)
+		map.add(field.first, field.second);
+	return map;
+}
+
+int main()
+{
+	constexpr std::size_t iterations = 200000;
+
+	bench::report("insert 16 fields (unordered_map + list)",
+				  bench::measure([] { bench::do_not_optimize(legacy_insert()); }, iterations));
+	bench::report("insert 16 fields (HeaderMap)",
+				  bench::measure([] { bench::do_not_optimize(flat_insert()); }, iterations));
+
+	const LegacyHeaderMap legacy = legacy_insert();
+	const HeaderMap flat         = flat_insert();
+
+	bench::report("lookup 6 fields (unordered_map + list)",
+				  bench::measure(
+					  [&legacy]
+					  {
+						  std::size_t found = 0;
+						  for (std::string_view field : lookups)
+						  {
+							  auto it = legacy.find(std::string{field});
+							  if (it != legacy.end())
+								  found += it->second.front().size();
+						  }
+						  bench::do_not_optimize(found);
+					  },
+					  iterations));
+	bench::report("lookup 6 fields (HeaderMap)",
+				  bench::measure(
+					  [&flat]
+					  {
+						  std::size_t found = 0;
+						  for (std::string_view field : lookups)
+						  {
+							  auto it = flat.find(field);
+							  if (it != flat.end())
+								  found += it->value.size();
+						  }
+						  bench::do_not_optimize(found);
+					  },
+					  iterations));
+
+	bench::report("lookup 6 fields by HeaderId (HeaderMap)",
+				  bench::measure(
+					  [&flat]
+					  {
+						  std::size_t found = 0;
+						  for (HeaderId id : ids)
+						  {
+							  auto it = flat.find(id);
+							  if (it != flat.end())
+								  found += it->value.size();
+						  }
+						  bench::do_not_optimize(found);
+					  },
+					  iterations));
+
+	bench::report("iterate 16 fields (unordered_map + list)",
+				  bench::measure(
+					  [&legacy]
+					  {
+						  std::size_t size = 0;
+						  for (const auto &pair : legacy)
+							  for (const auto &value : pair.second)
+								  size += pair.first.size() + value.size();
+						  bench::do_not_optimize(size);
+					  },
+					  iterations));
+	bench::report("iterate 16 fields (HeaderMap)",
+				  bench::measure(
+					  [&flat]
+					  {
+						  std::size_t size = 0;
+						  for (const auto &pair : flat)
+							  size += pair.field.size() + pair.value.size();
+						  bench::do_not_optimize(size);
+					  },
+					  iterations));
+
+	return 0;
+}
@@ -0,0 +1,79 @@
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <phase2/utils/Log.hpp>
+
+#include "bench.hpp"
+
+using namespace phase2;
+
+constexpr std::size_t records = 20000;
+
+/**
+ * @brief Log from several threads at once.
+ *
+ * @param threads the number of threads.
+ * @return nanoseconds per record.
+ */
+double contend(std::size_t threads)
+{
+	const double ns = bench::measure(
+		[threads]
+		{
+			std::vector<std::thread> loggers;
+			for (std::size_t i = 0; i < threads; ++i)
+				loggers.emplace_back(
+					[i]
+					{
+						for (std::size_t j = 0; j < records; ++j)
+							log_info << "GET /index.html 200, worker " << i << ", request " << j;
+					});
+			for (std::thread &logger : loggers)
+				logger.join();
+		},
+		1);
+	return ns / static_cast<double>(threads * records);
+}
+
+int main()
+{
+	// the synchronous logger writes to std::cerr
+	const int null_fd = ::open("/dev/null", O_WRONLY);
+	::dup2(null_fd, STDERR_FILENO);
+
+	for (std::size_t threads : {1, 4})
+	{
+		const std::string suffix = ", " + std::to_string(threads) + " thread(s)";
+
+		bench::report("mutex + std::cerr" + suffix, contend(threads));
+
+		start_async_log(null_fd, 8192, LogOverflow::BLOCK);
+		bench::report("async, block on overflow" + suffix, contend(threads));
+		stop_async_log();
+
+		start_async_log(null_fd, 8192, LogOverflow::DROP);
+		bench::report("async, drop on overflow" + suffix, contend(threads));
+		stop_async_log();
+	}
+
+	std::cout << "dropped records: " << get_dropped_logs() << '\n';
+
+	// release builds filter debug records, compare what a filtered statement costs
+	const std::string path = "/wiki/Hypertext_Transfer_Protocol";
+	bench::report("filtered log_debug << ... (legacy)",
+				  bench::measure([&path] { log_debug << "GET " << path << " took " << 48763 << " ns"; }, 1000000));
+	bench::report("filtered PHASE2_LOG(DEBUG, HTTP) << ...",
+				  bench::measure([&path] { PHASE2_LOG(DEBUG, HTTP) << "GET " << path << " took " << 48763 << " ns"; },
+								 1000000));
+	set_log_level(LogModule::HTTP, LogLevel::LOG_DEBUG);
+	bench::report("emitted PHASE2_LOG(DEBUG, HTTP) << ...",
+				  bench::measure([&path] { PHASE2_LOG(DEBUG, HTTP) << "GET " << path << " took " << 48763 << " ns"; },
+								 100000));
+
+	return 0;
+}
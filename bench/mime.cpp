@@ -0,0 +1,84 @@
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <magic.h>
+
+#include <phase2/Mime.hpp>
+#include <phase2/MimeCache.hpp>
+#include <phase2/MimeService.hpp>
+
+#include "bench.hpp"
+
+using namespace phase2;
+
+/**
+ * @brief The libmagic usage before the per-thread handles: the database is
+ * opened and loaded on every call.
+ */
+std::string legacy_magic(const std::filesystem::path &path)
+{
+	::magic_t cookie = ::magic_open(MAGIC_MIME_TYPE);
+	if (cookie == nullptr)
+		return "";
+	if (::magic_load(cookie, nullptr) < 0)
+	{
+		::magic_close(cookie);
+		return "";
+	}
+	const char *result = ::magic_file(cookie, path.c_str());
+	std::string result_str = result == nullptr ? "" : result;
+	::magic_close(cookie);
+	return result_str;
+}
+
+int main(int argc, char const *argv[])
+{
+	const std::filesystem::path path = argc > 1 ? argv[1] : argv[0];
+
+	bench::report("magic_open + magic_load per call (legacy)",
+				  bench::measure([&path] { bench::do_not_optimize(legacy_magic(path)); }, 100));
+
+	bench::report("init_mime, reload database", bench::measure([] { bench::do_not_optimize(init_mime()); }, 10));
+	bench::report("get_mime, thread-local handle",
+				  bench::measure([&path] { bench::do_not_optimize(get_mime(path)); }, 1000));
+
+	const std::string_view body = "<!DOCTYPE html>\n<html><head><title>phase2</title></head><body></body></html>\n";
+	bench::report("get_mime, in-memory body",
+				  bench::measure(
+					  [body]
+					  {
+						  bench::do_not_optimize(
+							  get_mime(reinterpret_cast<const std::uint8_t *>(body.data()), body.size(), "html"));
+					  },
+					  1000));
+
+	bench::report("get_mime, extension mode",
+				  bench::measure([] { bench::do_not_optimize(get_mime("/srv/www/index.html", MimeMode::EXTENSION)); },
+								 1000000));
+	bench::report("get_mime_by_extension",
+				  bench::measure([] { bench::do_not_optimize(get_mime_by_extension("woff2")); }, 1000000));
+
+	MimeCache cache;
+	bench::report("MimeCache hit",
+				  bench::measure([&cache, &path] { bench::do_not_optimize(cache.getMime(path)); }, 100000));
+
+	const std::vector<std::filesystem::path> batch(64, path);
+	for (std::size_t threads : {1, 2, 4})
+	{
+		MimeService service{threads};
+		const std::string name = "MimeService, batch of 64, " + std::to_string(threads) + " thread(s)";
+		bench::report(name, bench::measure(
+								[&service, &batch]
+								{
+									for (auto &future : service.submit(batch))
+										bench::do_not_optimize(future.get());
+								},
+								10));
+	}
+
+	return 0;
+}
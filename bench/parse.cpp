@@ -0,0 +1,149 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include <phase2/Http.hpp>
+#include <phase2/HttpParser.hpp>
+#include <phase2/utils/Scan.hpp>
+
+#include "bench.hpp"
+
+using namespace phase2;
+
+constexpr std::string_view request =
+	"GET /wiki/Hypertext_Transfer_Protocol HTTP/1.1\r\n"
+	"Host: en.wikipedia.org\r\n"
+	"Connection: keep-alive\r\n"
+	"Cache-Control: max-age=0\r\n"
+	"sec-ch-ua: \"Chromium\";v=\"118\", \"Google Chrome\";v=\"118\", \"Not=A?Brand\";v=\"99\"\r\n"
+	"sec-ch-ua-mobile: ?0\r\n"
+	"sec-ch-ua-platform: \"Windows\"\r\n"
+	"Upgrade-Insecure-Requests: 1\r\n"
+	"User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 "
+	"(KHTML, like Gecko) Chrome/118.0.0.0 Safari/537.36\r\n"
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,"
+	"image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+	"Sec-Fetch-Site: same-origin\r\n"
+	"Sec-Fetch-Mode: navigate\r\n"
+	"Sec-Fetch-User: ?1\r\n"
+	"Sec-Fetch-Dest: document\r\n"
+	"Referer: https://en.wikipedia.org/wiki/Main_Page\r\n"
+	"Accept-Encoding: gzip, deflate, br\r\n"
+	"Accept-Language: en-US,en;q=0.9,zh-TW;q=0.8\r\n"
+	"Cookie: WMF-Last-Access=17-Oct-2026; GeoIP=TW:TPE:Taipei:25.05:121.53:v4; "
+	"enwikimwuser-sessionId=0123456789abcdef0123\r\n"
+	"\r\n";
+
+/**
+ * @brief The delimiter search used before the SIMD scanner: one find pass for
+ * the end of the header, then find, find_first_not_of and find_last_not_of
+ * passes for every line.
+ */
+std::size_t legacy_scan(std::string_view str)
+{
+	std::size_t fields                           = 0;
+	const std::string_view::size_type header_end = str.find("\r\n\r\n");
+	if (header_end == str.npos)
+		return 0;
+	str.remove_suffix(str.size() - header_end - 2);
+	str.remove_prefix(str.find("\r\n") + 2);
+
+	std::string_view::size_type line_end;
+	while ((line_end = str.find("\r\n")) != str.npos)
+	{
+		std::string_view line                   = str.substr(0, line_end);
+		std::string_view::size_type colon       = line.find(':');
+		std::string_view::size_type value_begin = line.find_first_not_of(" \t", colon + 1);
+		std::string_view::size_type value_end   = line.find_last_not_of(" \t");
+		fields += colon + value_begin + value_end;
+		str.remove_prefix(line_end + 2);
+	}
+	return fields;
+}
+
+/**
+ * @brief The same search done with find_ctl and find_non_token.
+ */
+std::size_t simd_scan(std::string_view str)
+{
+	std::size_t fields    = 0;
+	const char *const end = str.data() + str.size();
+	const char *line_end  = find_ctl(str.data(), end);
+	while (true)
+	{
+		const char *line = line_end + 2;
+		const char *name = find_non_token(line, end);
+		line_end         = find_ctl(name, end);
+		if (line_end == line || line_end == end)
+			break;
+		fields += (name - line) + (line_end - name);
+	}
+	return fields;
+}
+
+int main()
+{
+	constexpr std::size_t iterations = 1000000;
+
+	bench::report("legacy find() scan",
+				  bench::measure([] { bench::do_not_optimize(legacy_scan(request)); }, iterations),
+				  request.size());
+
+	for (ScanBackend backend : {ScanBackend::SCALAR, ScanBackend::SSE42, ScanBackend::AVX2})
+	{
+		if (!set_scan_backend(backend))
+			continue;
+
+		std::string name = "find_ctl/find_non_token scan (";
+		name += to_string(backend);
+		name += ')';
+		bench::report(name, bench::measure([] { bench::do_not_optimize(simd_scan(request)); }, iterations),
+					  request.size());
+
+		name = "HttpRequestHeader (";
+		name += to_string(backend);
+		name += ')';
+		bench::report(name,
+					  bench::measure([] { bench::do_not_optimize(HttpRequestHeader{request}); }, iterations / 10),
+					  request.size());
+
+		name = "HttpRequestHeaderView (";
+		name += to_string(backend);
+		name += ')';
+		bench::report(name,
+					  bench::measure([] { bench::do_not_optimize(HttpRequestHeaderView{request}); }, iterations),
+					  request.size());
+	}
+
+	// 16 pipelined requests in one read, the way a client batches them
+	std::string batch;
+	for (std::size_t i = 0; i < 16; ++i)
+		batch += request;
+	bench::report("16 pipelined requests, view + erase the prefix (legacy)",
+				  bench::measure(
+					  [&batch]
+					  {
+						  std::string buffer = batch;
+						  std::size_t body_start;
+						  while (!buffer.empty())
+						  {
+							  bench::do_not_optimize(HttpRequestHeaderView{buffer, body_start});
+							  buffer.erase(0, body_start);
+						  }
+					  },
+					  iterations / 100),
+				  batch.size());
+	bench::report("16 pipelined requests, HttpRequestPipeline",
+				  bench::measure(
+					  [&batch]
+					  {
+						  HttpRequestPipeline pipeline{batch};
+						  PipelinedRequest pipelined;
+						  while (pipeline.next(pipelined) == ParseStatus::DONE)
+							  bench::do_not_optimize(pipelined.size);
+					  },
+					  iterations / 100),
+				  batch.size());
+
+	return 0;
+}
@@ -0,0 +1,91 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include <phase2/Http.hpp>
+
+#include "bench.hpp"
+
+using namespace phase2;
+
+constexpr std::string_view response =
+	"HTTP/1.1 200 OK\r\n"
+	"Date: Sat, 17 Oct 2026 08:00:00 GMT\r\n"
+	"Server: phase2\r\n"
+	"Content-Type: text/html; charset=UTF-8\r\n"
+	"Content-Length: 48763\r\n"
+	"Cache-Control: private, s-maxage=0, max-age=0, must-revalidate\r\n"
+	"Content-Language: en\r\n"
+	"Last-Modified: Fri, 16 Oct 2026 21:12:43 GMT\r\n"
+	"Vary: Accept-Encoding,Cookie\r\n"
+	"X-Content-Type-Options: nosniff\r\n"
+	"Set-Cookie: WMF-Last-Access=17-Oct-2026; Path=/; HttpOnly; secure\r\n"
+	"Set-Cookie: GeoIP=TW:TPE:Taipei:25.05:121.53:v4; Path=/; secure\r\n"
+	"Strict-Transport-Security: max-age=106384710; includeSubDomains; preload\r\n"
+	"\r\n";
+
+/**
+ * @brief The serialization used before the iovec mode: the status line is
+ * formatted into a string, the fields into a second buffer, then both are
+ * copied into a third one.
+ */
+std::vector<std::uint8_t> legacy_serialize(const HttpResponseHeader &header)
+{
+	std::string str = to_string(header.getHttpVersion());
+	str += ' ';
+	str += std::to_string(static_cast<int>(header.getStatus()));
+	str += ' ';
+	str += to_string(header.getStatus());
+	str += "\r\n";
+
+	std::vector<std::uint8_t> fields;
+	fields.reserve(256);
+	for (const auto &pair : header.getHeaders())
+	{
+		fields.insert(fields.end(), pair.field.cbegin(), pair.field.cend());
+		fields.push_back(':');
+		fields.push_back(' ');
+		fields.insert(fields.end(), pair.value.cbegin(), pair.value.cend());
+		fields.push_back('\r');
+		fields.push_back('\n');
+	}
+	fields.push_back('\r');
+	fields.push_back('\n');
+
+	std::vector<std::uint8_t> buf;
+	buf.reserve(512);
+	buf.insert(buf.end(), str.cbegin(), str.cend());
+	buf.insert(buf.end(), fields.cbegin(), fields.cend());
+	return buf;
+}
+
+int main()
+{
+	constexpr std::size_t iterations = 200000;
+	const HttpResponseHeader header{response};
+
+	bench::report("string + vector + copy (legacy)",
+				  bench::measure([&header] { bench::do_not_optimize(legacy_serialize(header)); }, iterations),
+				  response.size());
+	bench::report("serialize() to a buffer",
+				  bench::measure([&header] { bench::do_not_optimize(header.serialize()); }, iterations),
+				  response.size());
+
+	std::vector<iovec> iov;
+	bench::report("serialize(iov), reused vector",
+				  bench::measure(
+					  [&header, &iov]
+					  {
+						  iov.clear();
+						  bench::do_not_optimize(header.serialize(iov));
+						  bench::do_not_optimize(iov.data());
+					  },
+					  iterations),
+				  response.size());
+
+	return 0;
+}
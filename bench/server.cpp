@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <phase2/HttpServer.hpp>
+#include <phase2/utils/Log.hpp>
+
+#include "bench.hpp"
+
+using namespace phase2;
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::string_view request = "GET /plaintext HTTP/1.1\r\nHost: localhost\r\nAccept: text/plain\r\n\r\n";
+constexpr std::size_t total        = 200000;
+
+/**
+ * @brief Connect a blocking client socket to the server.
+ */
+int connect_client(std::uint16_t port)
+{
+	sockaddr_in addr{};
+	addr.sin_family      = AF_INET;
+	addr.sin_port        = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	const int fd         = ::socket(AF_INET, SOCK_STREAM, 0);
+	const int nodelay    = 1;
+	::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+	if (::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0)
+	{
+		::close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * @brief Read exactly size bytes.
+ */
+bool read_exactly(int fd, std::string &buf, std::size_t size)
+{
+	buf.resize(size);
+	for (std::size_t offset = 0; offset < size;)
+	{
+		const ssize_t n = ::read(fd, buf.data() + offset, size - offset);
+		if (n <= 0)
+			return false;
+		offset += static_cast<std::size_t>(n);
+	}
+	return true;
+}
+
+/**
+ * @brief Send rounds of pipelined requests over every connection and print
+ * the throughput and the latency of a round trip, from writing a batch to
+ * reading its last response.
+ *
+ * @param backend the backend of the server.
+ * @param port the server port.
+ * @param connections the number of client connections.
+ * @param depth the number of requests pipelined per connection.
+ * @param response_size the size of a response.
+ */
+void bench_server(ServerBackend backend, std::uint16_t port, std::size_t connections, std::size_t depth, std::size_t response_size)
+{
+	std::vector<int> fds;
+	for (std::size_t i = 0; i < connections; ++i)
+		fds.push_back(connect_client(port));
+
+	std::string batch;
+	for (std::size_t i = 0; i < depth; ++i)
+		batch += request;
+	std::string buf;
+	std::vector<double> latencies;
+	const std::size_t rounds = total / (connections * depth);
+	latencies.reserve(rounds * connections);
+
+	const Clock::time_point start = Clock::now();
+	for (std::size_t round = 0; round < rounds; ++round)
+	{
+		const Clock::time_point sent = Clock::now();
+		for (int fd : fds)
+			bench::do_not_optimize(::write(fd, batch.data(), batch.size()));
+		for (int fd : fds)
+		{
+			if (!read_exactly(fd, buf, response_size * depth))
+			{
+				std::cerr << "server benchmark failed, connection closed\n";
+				return;
+			}
+			latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+		}
+	}
+	const std::chrono::duration<double> elapsed = Clock::now() - start;
+	for (int fd : fds)
+		::close(fd);
+
+	std::sort(latencies.begin(), latencies.end());
+	const std::string name = "HttpServer " + std::string{to_string(backend)} + ", " + std::to_string(connections) +
+							 " conns, " + std::to_string(depth) + " pipelined";
+	std::cout << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(0)
+			  << std::setw(12) << static_cast<double>(rounds * connections * depth) / elapsed.count() << " req/s"
+			  << std::setprecision(1) << std::setw(10) << latencies[latencies.size() / 2] << " us p50"
+			  << std::setw(10) << latencies[latencies.size() * 99 / 100] << " us p99\n";
+}
+
+/**
+ * @brief Run the benchmarks against a server with a backend.
+ */
+void bench_backend(ServerBackend backend)
+{
+	ServerConfig config;
+	config.backend = backend;
+	HttpServer server{[](const HttpRequestHeader &, std::string_view)
+					  {
+						  HttpResponse response;
+						  response.header.setStatus(HttpResponseHeader::StatusCode::ok);
+						  response.header.addHeader(HeaderId::CONTENT_TYPE, "text/plain");
+						  response.body = "Hello, world!";
+						  return response;
+					  },
+					  config};
+	if (!server.listen("127.0.0.1", 0))
+		return;
+	std::thread server_thread{[&server] { server.run(); }};
+
+	// learn the response size from a first request
+	std::size_t response_size = 0;
+	const int fd              = connect_client(server.port());
+	std::string buf(4096, '\0');
+	bench::do_not_optimize(::write(fd, request.data(), request.size()));
+	while (std::string_view{buf.data(), response_size}.find("Hello, world!") == std::string_view::npos)
+	{
+		const ssize_t n = ::read(fd, buf.data() + response_size, buf.size() - response_size);
+		if (n <= 0)
+		{
+			response_size = 0;
+			break;
+		}
+		response_size += static_cast<std::size_t>(n);
+	}
+	::close(fd);
+
+	for (std::size_t connections : {1, 32})
+		for (std::size_t depth : {1, 16})
+			if (response_size != 0)
+				bench_server(server.backend(), server.port(), connections, depth, response_size);
+
+	server.stop();
+	server_thread.join();
+}
+
+/**
+ * @brief Run a sharded server with one client thread per shard, each
+ * pipelining over its own connections, and print the throughput.
+ *
+ * @param shards the number of event loops.
+ */
+void bench_sharded(std::size_t shards)
+{
+	constexpr std::size_t connections = 16;
+	constexpr std::size_t depth       = 16;
+	ShardedHttpServer server{[](const HttpRequestHeader &, std::string_view)
+							 {
+								 HttpResponse response;
+								 response.header.setStatus(HttpResponseHeader::StatusCode::ok);
+								 response.header.addHeader(HeaderId::CONTENT_TYPE, "text/plain");
+								 response.body = "Hello, world!";
+								 return response;
+							 },
+							 {}, shards, true};
+	if (!server.listen("127.0.0.1", 0))
+		return;
+	std::thread server_thread{[&server] { server.run(); }};
+
+	std::string batch;
+	for (std::size_t i = 0; i < depth; ++i)
+		batch += request;
+	const std::size_t rounds = total / (connections * depth);
+
+	const Clock::time_point start = Clock::now();
+	std::vector<std::thread> clients;
+	for (std::size_t client = 0; client < shards; ++client)
+		clients.emplace_back(
+			[&]
+			{
+				std::vector<int> fds;
+				for (std::size_t i = 0; i < connections; ++i)
+					fds.push_back(connect_client(server.port()));
+				char buf[65536];
+				for (std::size_t round = 0; round < rounds; ++round)
+				{
+					for (int fd : fds)
+						bench::do_not_optimize(::write(fd, batch.data(), batch.size()));
+					// the server answers every request of the batch, count the bodies
+					for (int fd : fds)
+						for (std::size_t answered = 0; answered < depth;)
+						{
+							const ssize_t n = ::read(fd, buf, sizeof(buf));
+							if (n <= 0)
+								return;
+							for (std::string_view view{buf, static_cast<std::size_t>(n)};
+								 view.find('!') != std::string_view::npos; view.remove_prefix(view.find('!') + 1))
+								++answered;
+						}
+				}
+				for (int fd : fds)
+					::close(fd);
+			});
+	for (std::thread &client : clients)
+		client.join();
+	const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+	server.stop();
+	server_thread.join();
+	const std::string name = "ShardedHttpServer " + std::to_string(shards) + " shards, " +
+							 std::to_string(shards * connections) + " conns, " + std::to_string(depth) + " pipelined";
+	std::cout << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(0)
+			  << std::setw(12) << static_cast<double>(shards * rounds * connections * depth) / elapsed.count()
+			  << " req/s\n";
+}
+
+int main()
+{
+	set_log_level(LogModule::SERVER, LogLevel::LOG_WARNING);
+	bench_backend(ServerBackend::EPOLL);
+	bench_backend(ServerBackend::IO_URING);
+
+	const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+	for (std::size_t shards = 1; shards <= cores; shards *= 2)
+		bench_sharded(shards);
+	if ((cores & (cores - 1)) != 0)
+		bench_sharded(cores);
+	return 0;
+}
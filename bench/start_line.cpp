@@ -0,0 +1,96 @@
+#include <cctype>
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <phase2/Http.hpp>
+
+#include "bench.hpp"
+
+using namespace phase2;
+
+using RequestType = HttpRequestHeader::RequestType;
+
+/**
+ * @brief The version parser before the word compare: an uppercased copy read
+ * by a std::istringstream. It is not inlined, like the library functions.
+ */
+__attribute__((noinline)) std::pair<int, int> legacy_to_version(std::string_view str)
+{
+	std::string tmp;
+	tmp.reserve(str.size());
+	for (const char &c : str)
+		tmp.push_back(std::isalpha(static_cast<unsigned char>(c)) ? std::toupper(static_cast<unsigned char>(c)) : c);
+	if (tmp.compare(0, 5, "HTTP/") != 0)
+		return std::make_pair(-1, -1);
+
+	std::istringstream ss{tmp};
+	ss.ignore(5);
+	int major, minor;
+	if (!(ss >> major))
+		return std::make_pair(-1, -1);
+	ss.ignore();
+	if (!(ss >> minor))
+		return std::make_pair(-1, -1);
+	return std::make_pair(major, minor);
+}
+
+/**
+ * @brief The method parser before the word compare: a switch on the first
+ * letter, then string compares.
+ */
+__attribute__((noinline)) RequestType legacy_to_type(std::string_view str)
+{
+	if (str.length() < 3)
+		return RequestType::UNKNOWN;
+
+	switch (str.at(0))
+	{
+	case 'G':
+		return str.substr(1) == "ET" ? RequestType::GET : RequestType::UNKNOWN;
+	case 'H':
+		return str.substr(1) == "EAD" ? RequestType::HEAD : RequestType::UNKNOWN;
+	case 'P':
+		str.remove_prefix(1);
+		if (str == "OST")
+			return RequestType::POST;
+		if (str == "UT")
+			return RequestType::PUT;
+		if (str == "ATCH")
+			return RequestType::PATCH;
+		return RequestType::UNKNOWN;
+	case 'D':
+		return str.substr(1) == "ELETE" ? RequestType::DELETE : RequestType::UNKNOWN;
+	case 'O':
+		return str.substr(1) == "PTIONS" ? RequestType::OPTIONS : RequestType::UNKNOWN;
+	}
+	return RequestType::UNKNOWN;
+}
+
+int main()
+{
+	constexpr std::size_t iterations = 1000000;
+	constexpr std::string_view methods[] = {"GET", "POST", "DELETE", "OPTIONS"};
+	std::size_t i                        = 0;
+
+	bench::report("to_version (legacy istringstream)",
+				  bench::measure([] { bench::do_not_optimize(legacy_to_version("HTTP/1.1")); }, iterations));
+	bench::report("to_version", bench::measure([] { bench::do_not_optimize(to_version("HTTP/1.1")); }, iterations));
+	bench::report("to_type (legacy compares)",
+				  bench::measure([&] { bench::do_not_optimize(legacy_to_type(methods[i++ % 4])); }, iterations));
+	bench::report("to_type", bench::measure([&] { bench::do_not_optimize(to_type(methods[i++ % 4])); }, iterations));
+
+	constexpr std::string_view request  = "GET /wiki/Hypertext_Transfer_Protocol HTTP/1.1\r\n\r\n";
+	constexpr std::string_view response = "HTTP/1.1 200 OK\r\n\r\n";
+	bench::report("request line, HttpRequestHeaderView",
+				  bench::measure([] { bench::do_not_optimize(HttpRequestHeaderView{request}.getType()); }, iterations),
+				  request.size());
+	bench::report("status line, HttpResponseHeaderView",
+				  bench::measure([] { bench::do_not_optimize(HttpResponseHeaderView{response}.getStatus()); },
+								 iterations),
+				  response.size());
+
+	return 0;
+}
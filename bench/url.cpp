@@ -0,0 +1,119 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include <phase2/Url.hpp>
+#include <phase2/utils/Scan.hpp>
+
+#include "bench.hpp"
+
+using namespace phase2;
+
+constexpr std::string_view target =
+	"/w/index.php?title=Hypertext_Transfer_Protocol&action=history&offset=20261017080000&limit=50&lang=en";
+
+/**
+ * @brief A byte-at-a-time decoder, as the handlers used to write it.
+ */
+std::string naive_decode(std::string_view str)
+{
+	std::string out;
+	for (std::size_t i = 0; i < str.size(); ++i)
+	{
+		if (str[i] == '+')
+			out += ' ';
+		else if (str[i] == '%' && i + 2 < str.size())
+		{
+			out += static_cast<char>(std::stoi(std::string{str.substr(i + 1, 2)}, nullptr, 16));
+			i += 2;
+		}
+		else
+			out += str[i];
+	}
+	return out;
+}
+
+/**
+ * @brief Measure decoding and encoding of a long query string.
+ *
+ * @param name the kind of string.
+ * @param plain the decoded string.
+ */
+void bench_percent(std::string_view name, const std::string &plain)
+{
+	constexpr std::size_t iterations = 20000;
+	std::string encoded;
+	percent_encode(plain, encoded);
+
+	bench::report(std::string{name} + ", naive decode",
+				  bench::measure([&encoded] { bench::do_not_optimize(naive_decode(encoded)); }, iterations),
+				  encoded.size());
+	for (ScanBackend backend : {ScanBackend::SCALAR, ScanBackend::SSE42, ScanBackend::AVX2})
+	{
+		if (!set_scan_backend(backend))
+			continue;
+		std::string out;
+		bench::report(std::string{name} + ", percent_decode " + std::string{to_string(backend)},
+					  bench::measure(
+						  [&encoded, &out]
+						  {
+							  out.clear();
+							  bench::do_not_optimize(percent_decode(encoded, out));
+						  },
+						  iterations),
+					  encoded.size());
+		bench::report(std::string{name} + ", percent_encode " + std::string{to_string(backend)},
+					  bench::measure(
+						  [&plain, &out]
+						  {
+							  out.clear();
+							  percent_encode(plain, out);
+							  bench::do_not_optimize(out.data());
+						  },
+						  iterations),
+					  plain.size());
+	}
+	set_scan_backend(ScanBackend::AVX2) || set_scan_backend(ScanBackend::SSE42);
+}
+
+int main()
+{
+	constexpr std::size_t iterations = 200000;
+
+	bench::report("Url, path only",
+				  bench::measure([] { bench::do_not_optimize(Url{target}.path()); }, iterations), target.size());
+	bench::report("UrlView, path only",
+				  bench::measure([] { bench::do_not_optimize(UrlView{target}.path()); }, iterations), target.size());
+
+	bench::report("Url, path + getParam(\"limit\")",
+				  bench::measure([] { bench::do_not_optimize(Url{target}.getParam("limit")); }, iterations),
+				  target.size());
+	bench::report("UrlView, path + getParam(\"limit\")",
+				  bench::measure([] { bench::do_not_optimize(UrlView{target}.getParam("limit")); }, iterations),
+				  target.size());
+
+	bench::report("UrlView, iterate parameters",
+				  bench::measure(
+					  []
+					  {
+						  std::size_t size = 0;
+						  for (const UrlView::Param &param : UrlView{target}.params())
+							  size += param.value.size();
+						  bench::do_not_optimize(size);
+					  },
+					  iterations),
+				  target.size());
+
+	std::string plain;
+	while (plain.size() < 4096)
+		plain += "Hypertext_Transfer_Protocol-";
+	bench_percent("4KB without escapes", plain);
+	for (std::size_t i = 0; i < plain.size(); i += 64)
+		plain[i] = ' ';
+	bench_percent("4KB, an escape every 64 bytes", plain);
+	for (std::size_t i = 0; i < plain.size(); i += 8)
+		plain[i] = '/';
+	bench_percent("4KB, an escape every 8 bytes", plain);
+
+	return 0;
+}
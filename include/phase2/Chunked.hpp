@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include <phase2/HttpParser.hpp>
+#include <phase2/utils/HeaderMap.hpp>
+
+namespace phase2
+{
+
+	/**
+	 * @brief A streaming decoder of the chunked transfer coding (RFC 7230
+	 * section 4.1). The body arrives in fragments of any size, and the decoder
+	 * returns slices of the fragments, so the body is never buffered. Only an
+	 * unfinished trailer line is kept between two fragments.
+	 */
+	class ChunkedDecoder
+	{
+	public:
+		/**
+		 * @brief Construct a new decoder.
+		 *
+		 * @param max_line the maximum size of a chunk size line, including its
+		 * extensions, and of a trailer field.
+		 */
+		explicit ChunkedDecoder(std::size_t max_line = 4096) noexcept;
+
+		/**
+		 * @brief Decode a fragment until a body slice is found. Call it again
+		 * with the rest of the fragment while it returns NEED_MORE and the
+		 * fragment is not empty.
+		 *
+		 * @param input the fragment, the decoded bytes are removed from it.
+		 * When the decoder is done, the rest is the start of the next message.
+		 * @param data stores the body slice, a part of the fragment. It is
+		 * empty if the fragment only holds framing.
+		 * @return NEED_MORE if the body is not complete yet, DONE after the
+		 * last chunk and the trailers, ERROR if the framing is invalid.
+		 */
+		ParseStatus decode(std::string_view &input, std::string_view &data);
+
+		/**
+		 * @brief Get the trailer fields, complete once the decoder is done.
+		 */
+		const HeaderMap &trailers() const noexcept;
+
+		/**
+		 * @brief Get the number of body bytes decoded so far.
+		 */
+		std::uint64_t size() const noexcept;
+
+		/**
+		 * @brief Reset the decoder to decode a new body.
+		 */
+		void reset() noexcept;
+
+	private:
+		enum class _State
+		{
+			SIZE,
+			EXTENSION,
+			SIZE_LF,
+			DATA,
+			DATA_CR,
+			DATA_LF,
+			TRAILER,
+			DONE,
+			ERROR
+		};
+
+		/**
+		 * @brief Fail the decoder.
+		 */
+		ParseStatus _fail(std::string_view reason);
+
+		/**
+		 * @brief Parse a complete trailer line.
+		 *
+		 * @param line the line without the trailing CRLF.
+		 * @return the status after this line.
+		 */
+		ParseStatus _parseTrailer(std::string_view line);
+
+		HeaderMap _trailers;
+		std::string _line;
+		std::uint64_t _remaining;
+		std::uint64_t _size;
+		std::size_t _line_size;
+		std::size_t _max_line;
+		_State _state;
+		bool _has_digit;
+	};
+
+	/**
+	 * @brief An encoder of the chunked transfer coding. Every chunk becomes
+	 * iovec segments around the producer's data, so the data is not copied,
+	 * and the CRLF ending a chunk shares a segment with the next size line.
+	 * The chunk size lines are kept by the encoder until clear() is called,
+	 * e.g. after the segments are written.
+	 */
+	class ChunkedEncoder
+	{
+	public:
+		ChunkedEncoder();
+
+		/**
+		 * @brief Append a chunk. Empty data is skipped, since an empty chunk
+		 * ends the body.
+		 *
+		 * @param data the chunk data, which must outlive the segments.
+		 * @param iov the list to append to.
+		 */
+		void encode(std::string_view data, std::vector<iovec> &iov);
+
+		/**
+		 * @brief Append the last chunk, the trailer fields and the final CRLF.
+		 *
+		 * @param iov the list to append to.
+		 * @param trailers the trailer fields, which must outlive the segments.
+		 */
+		void finish(std::vector<iovec> &iov, const HeaderMap &trailers = {});
+
+		/**
+		 * @brief Release the chunk size lines of the segments appended so far.
+		 */
+		void clear() noexcept;
+
+	private:
+		std::deque<std::array<char, 24>> _lines;
+		bool _open;
+	};
+
+} // namespace phase2
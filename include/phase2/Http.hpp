@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <filesystem>
 #include <functional>
+#include <list>
 #include <optional>
 #include <ostream>
 #include <string>
@@ -10,17 +11,26 @@
 #include <utility>
 #include <vector>
 
+#include <sys/uio.h>
+
 #include <phase2/Url.hpp>
+#include <phase2/utils/HeaderId.hpp>
 #include <phase2/utils/HeaderMap.hpp>
 
 namespace phase2
 {
 
+	template <typename HeaderType>
+	class BasicHttpParser;
+
 	/**
 	 * @brief The base object of a HTTP request/response.
 	 */
 	class HttpHeader
 	{
+		template <typename HeaderType>
+		friend class BasicHttpParser;
+
 	protected:
 		using HttpVersionType = std::pair<int, int>;
 		using BufferType      = std::vector<std::uint8_t>;
@@ -70,6 +80,15 @@ namespace phase2
 		 */
 		void addHeader(std::string_view field, std::string_view value);
 
+		/**
+		 * @brief Add a standard header to the request/response with its
+		 * canonical field name.
+		 *
+		 * @param id the header ID.
+		 * @param value the value.
+		 */
+		void addHeader(HeaderId id, std::string_view value);
+
 		/**
 		 * @brief Get values of a field of the request/response header.
 		 *
@@ -78,6 +97,21 @@ namespace phase2
 		 */
 		std::list<std::string> getHeader(std::string_view field) const;
 
+		/**
+		 * @brief Get values of a standard field of the request/response header.
+		 *
+		 * @param id the header ID.
+		 * @return the header strings.
+		 */
+		std::list<std::string> getHeader(HeaderId id) const;
+
+		/**
+		 * @brief Get all fields of the request/response header in wire order.
+		 *
+		 * @return the header map.
+		 */
+		const HeaderMap &getHeaders() const noexcept;
+
 		/**
 		 * @brief Get the HTTP version of the request/response.
 		 *
@@ -99,6 +133,13 @@ namespace phase2
 		 */
 		void removeHeader(std::string_view field) noexcept;
 
+		/**
+		 * @brief Remove a standard header from the request/response.
+		 *
+		 * @param id the header ID.
+		 */
+		void removeHeader(HeaderId id) noexcept;
+
 		/**
 		 * @brief Set the HTTP version of the request/response.
 		 *
@@ -126,7 +167,19 @@ namespace phase2
 		 *
 		 * @return the converted buffer.
 		 */
-		virtual BufferType serialize() const;
+		BufferType serialize() const;
+
+		/**
+		 * @brief Append the serialized header as iovec segments for writev. The
+		 * segments point into the field and value storage of this object and
+		 * static separators, so the object must outlive and stay unmodified
+		 * while the segments are in use. Callers sending many fields should
+		 * split the segments by IOV_MAX.
+		 *
+		 * @param iov the segments to append to.
+		 * @return the header can be serialized or not.
+		 */
+		virtual bool serialize(std::vector<iovec> &iov) const;
 
 		/**
 		 * @brief Check whether the request/response is valid or not.
@@ -143,6 +196,25 @@ namespace phase2
 		bool operator!() const noexcept;
 
 	protected:
+		/**
+		 * @brief Parse a complete header block and add the fields to the headers.
+		 *
+		 * @param str the string starting with the start line.
+		 * @param body_start an optional parameter that stores where the body starts.
+		 * @param start_line stores the start line without the trailing CRLF.
+		 * @return the header block is valid or not.
+		 */
+		bool _parseHeader(std::string_view str, std::optional<std::reference_wrapper<std::size_t>> body_start,
+						  std::string_view &start_line);
+
+		/**
+		 * @brief Parse a header field line and add it to the headers.
+		 *
+		 * @param line the line without the trailing CRLF.
+		 * @return the line is a valid header field or not.
+		 */
+		bool _parseField(std::string_view line);
+
 		HeaderMap _Headers;
 		HttpVersionType _version;
 		bool _valid;
@@ -162,6 +234,9 @@ namespace phase2
 	 */
 	class HttpRequestHeader : public HttpHeader
 	{
+		template <typename HeaderType>
+		friend class BasicHttpParser;
+
 	public:
 		/**
 		 * @brief Request types of a HTTP Request.
@@ -226,7 +301,7 @@ namespace phase2
 		 *
 		 * @return the URL of the HTTP request.
 		 */
-		Url getUrl() const noexcept;
+		const Url &getUrl() const noexcept;
 
 		/**
 		 * @brief Set the type of the request.
@@ -242,14 +317,26 @@ namespace phase2
 		 */
 		void setUrl(Url url) noexcept;
 
+		using HttpHeader::serialize;
+
 		/**
-		 * @brief Convert the request to a buffer.
+		 * @brief Append the serialized request as iovec segments for writev.
+		 * The request target points into the URL storage.
 		 *
-		 * @return the converted buffer.
+		 * @param iov the segments to append to.
+		 * @return the request can be serialized or not.
 		 */
-		BufferType serialize() const override;
+		bool serialize(std::vector<iovec> &iov) const override;
 
 	protected:
+		/**
+		 * @brief Parse the request line, e.g. "GET / HTTP/1.1".
+		 *
+		 * @param line the line without the trailing CRLF.
+		 * @return the request line is valid or not.
+		 */
+		bool _parseStartLine(std::string_view line);
+
 		RequestType _type;
 		Url _url;
 	};
@@ -268,6 +355,9 @@ namespace phase2
 	 */
 	class HttpResponseHeader : public HttpHeader
 	{
+		template <typename HeaderType>
+		friend class BasicHttpParser;
+
 	public:
 		// clang-format off
 		/**
@@ -382,14 +472,25 @@ namespace phase2
 		 */
 		void setStatus(StatusCode status) noexcept;
 
+		using HttpHeader::serialize;
+
 		/**
-		 * @brief Convert the response to a buffer.
+		 * @brief Append the serialized response as iovec segments for writev.
 		 *
-		 * @return the converted buffer.
+		 * @param iov the segments to append to.
+		 * @return the response can be serialized or not.
 		 */
-		BufferType serialize() const override;
+		bool serialize(std::vector<iovec> &iov) const override;
 
 	protected:
+		/**
+		 * @brief Parse the status line, e.g. "HTTP/1.1 200 OK".
+		 *
+		 * @param line the line without the trailing CRLF.
+		 * @return the status line is valid or not.
+		 */
+		bool _parseStartLine(std::string_view line);
+
 		StatusCode _status;
 	};
 
@@ -402,6 +503,202 @@ namespace phase2
 	 */
 	std::ostream &operator<<(std::ostream &os, const HttpResponseHeader &res);
 
+	/**
+	 * @brief The base object of a HTTP request/response view. A view borrows
+	 * the buffer it is parsed from: the header fields and values are slices of
+	 * that buffer and nothing is copied, so the buffer must outlive the view.
+	 */
+	class HttpHeaderView
+	{
+	protected:
+		using HttpVersionType = std::pair<int, int>;
+
+	public:
+		/**
+		 * @brief Construct an empty HTTP header view.
+		 */
+		HttpHeaderView() noexcept;
+
+		/**
+		 * @brief Construct a new HTTP header view from a string. This
+		 * constructor will skip the first line and parse the header fields.
+		 *
+		 * @param str the string, which must outlive the view.
+		 * @param body_start an optional parameter that stores where the body starts.
+		 */
+		HttpHeaderView(std::string_view str,
+					   std::optional<std::reference_wrapper<std::size_t>> body_start = {}) noexcept;
+
+		/**
+		 * @brief Get values of a field of the request/response header.
+		 *
+		 * @param field the header field to get.
+		 * @return slices of the buffer holding the values.
+		 */
+		std::vector<std::string_view> getHeader(std::string_view field) const;
+
+		/**
+		 * @brief Get values of a standard field of the request/response header.
+		 *
+		 * @param id the header ID.
+		 * @return slices of the buffer holding the values.
+		 */
+		std::vector<std::string_view> getHeader(HeaderId id) const;
+
+		/**
+		 * @brief Get all fields of the request/response header in wire order.
+		 *
+		 * @return the header map.
+		 */
+		const HeaderViewMap &getHeaders() const noexcept;
+
+		/**
+		 * @brief Get the HTTP version of the request/response.
+		 *
+		 * @return a version pair.
+		 */
+		HttpVersionType getHttpVersion() const noexcept;
+
+		/**
+		 * @brief Check whether the request/response is valid or not.
+		 *
+		 * @return the request/response is valid or not.
+		 */
+		bool isValid() const noexcept;
+
+		/**
+		 * @brief Check whether the request/response is valid or not.
+		 *
+		 * @return the request/response is valid or not.
+		 */
+		operator bool() const noexcept;
+
+		/**
+		 * @brief Check whether the request/response is invalid or not.
+		 *
+		 * @return the request/response is invalid or not.
+		 */
+		bool operator!() const noexcept;
+
+	protected:
+		/**
+		 * @brief Parse a complete header block and store the slices of the fields.
+		 *
+		 * @param str the string starting with the start line.
+		 * @param body_start an optional parameter that stores where the body starts.
+		 * @param start_line stores the start line without the trailing CRLF.
+		 * @return the header block is valid or not.
+		 */
+		bool _parseHeader(std::string_view str, std::optional<std::reference_wrapper<std::size_t>> body_start,
+						  std::string_view &start_line);
+
+		/**
+		 * @brief Copy the header fields to an owning header.
+		 *
+		 * @param header the owning header.
+		 */
+		void _copyTo(HttpHeader &header) const;
+
+		HeaderViewMap _headers;
+		HttpVersionType _version;
+		bool _valid;
+	};
+
+	/**
+	 * @brief A HTTP request view that borrows the buffer it is parsed from.
+	 */
+	class HttpRequestHeaderView : public HttpHeaderView
+	{
+	public:
+		using RequestType = HttpRequestHeader::RequestType;
+
+		/**
+		 * @brief Construct an empty HTTP request view.
+		 */
+		HttpRequestHeaderView() noexcept;
+
+		/**
+		 * @brief Construct a new HTTP request view from a string.
+		 *
+		 * @param str the string, which must outlive the view.
+		 * @param body_start an optional parameter that stores where the body starts.
+		 */
+		HttpRequestHeaderView(std::string_view str,
+							  std::optional<std::reference_wrapper<std::size_t>> body_start = {}) noexcept;
+
+		/**
+		 * @brief Get the type of the HTTP request.
+		 *
+		 * @return the type of the HTTP request.
+		 */
+		RequestType getType() const noexcept;
+
+		/**
+		 * @brief Get the request target of the HTTP request.
+		 *
+		 * @return a slice of the buffer holding the request target.
+		 */
+		std::string_view getTarget() const noexcept;
+
+		/**
+		 * @brief Get the URL of the HTTP request.
+		 *
+		 * @return a view of the URL, valid as long as the viewed string.
+		 */
+		UrlView getUrl() const noexcept;
+
+		/**
+		 * @brief Copy the request to an owning request header, which can
+		 * outlive the buffer.
+		 *
+		 * @return the owning request header.
+		 */
+		HttpRequestHeader toOwned() const;
+
+	protected:
+		RequestType _type;
+		std::string_view _target;
+	};
+
+	/**
+	 * @brief A HTTP response view that borrows the buffer it is parsed from.
+	 */
+	class HttpResponseHeaderView : public HttpHeaderView
+	{
+	public:
+		using StatusCode = HttpResponseHeader::StatusCode;
+
+		/**
+		 * @brief Construct an empty HTTP response view.
+		 */
+		HttpResponseHeaderView() noexcept;
+
+		/**
+		 * @brief Construct a new HTTP response view from a string.
+		 *
+		 * @param str the string, which must outlive the view.
+		 * @param body_start an optional parameter that stores where the body starts.
+		 */
+		HttpResponseHeaderView(std::string_view str,
+							   std::optional<std::reference_wrapper<std::size_t>> body_start = {}) noexcept;
+
+		/**
+		 * @brief Get the status code of the response.
+		 */
+		StatusCode getStatus() const noexcept;
+
+		/**
+		 * @brief Copy the response to an owning response header, which can
+		 * outlive the buffer.
+		 *
+		 * @return the owning response header.
+		 */
+		HttpResponseHeader toOwned() const;
+
+	protected:
+		StatusCode _status;
+	};
+
 	/**
 	 * @brief Convert the HTTP version pair to a string.
 	 *
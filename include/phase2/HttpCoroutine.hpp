@@ -0,0 +1,503 @@
+#pragma once
+
+// The coroutine layer needs C++20, build with "make cxx20" to enable it.
+#if defined(__cpp_impl_coroutine)
+
+#include <array>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include <phase2/Chunked.hpp>
+#include <phase2/Http.hpp>
+#include <phase2/HttpParser.hpp>
+#include <phase2/HttpServer.hpp>
+
+namespace phase2
+{
+
+	class HttpConnection;
+	class AsyncHttpServer;
+
+	/**
+	 * @brief A free-list allocator of coroutine frames, owned by a connection.
+	 * Frames are rounded up to size classes and returned to the free lists
+	 * when they are destroyed, so the frames of a request handler are reused
+	 * by the next requests of the connection instead of allocated again.
+	 */
+	class FramePool
+	{
+	public:
+		FramePool() noexcept;
+
+		FramePool(const FramePool &)            = delete;
+		FramePool &operator=(const FramePool &) = delete;
+
+		/**
+		 * @brief Free the blocks of the free lists. Every frame must be
+		 * deallocated before.
+		 */
+		~FramePool();
+
+		/**
+		 * @brief Allocate a frame, from the free lists if possible.
+		 *
+		 * @param size the size of the frame.
+		 */
+		void *allocate(std::size_t size);
+
+		/**
+		 * @brief Return a frame to the free lists.
+		 *
+		 * @param frame the frame.
+		 * @param size the size it was allocated with.
+		 */
+		void deallocate(void *frame, std::size_t size) noexcept;
+
+		/**
+		 * @brief Get the number of blocks allocated from the heap so far.
+		 */
+		std::size_t allocated() const noexcept;
+
+	private:
+		static constexpr std::size_t _GRANULE = 64;
+		static constexpr std::size_t _CLASSES = 64;
+
+		struct _Block
+		{
+			_Block *next;
+		};
+
+		std::array<_Block *, _CLASSES> _free;
+		std::size_t _allocated;
+	};
+
+	/**
+	 * @brief A lazily started coroutine of a connection, the type of request
+	 * handlers and of the coroutines they await. Coroutines created while a
+	 * connection runs, the handler and what it calls, allocate their frames
+	 * from the FramePool of the connection. Exceptions are not supported and
+	 * terminate.
+	 */
+	class [[nodiscard]] HttpTask
+	{
+	public:
+		struct promise_type
+		{
+			/**
+			 * @brief The coroutine awaiting this one, resumed when it ends.
+			 */
+			std::coroutine_handle<> continuation;
+
+			HttpTask get_return_object() noexcept
+			{
+				return HttpTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+			}
+
+			std::suspend_always initial_suspend() noexcept { return {}; }
+
+			auto final_suspend() noexcept
+			{
+				struct FinalAwaiter
+				{
+					bool await_ready() noexcept { return false; }
+
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+					{
+						const std::coroutine_handle<> continuation = handle.promise().continuation;
+						return continuation ? continuation : std::noop_coroutine();
+					}
+
+					void await_resume() noexcept {}
+				};
+				return FinalAwaiter{};
+			}
+
+			void return_void() noexcept {}
+
+			void unhandled_exception() noexcept { std::terminate(); }
+
+			/**
+			 * @brief Allocate the frame from the pool of the connection that
+			 * runs, or from the heap.
+			 */
+			static void *operator new(std::size_t size);
+
+			static void operator delete(void *frame) noexcept;
+		};
+
+		HttpTask() noexcept = default;
+		HttpTask(HttpTask &&other) noexcept;
+		HttpTask &operator=(HttpTask &&other) noexcept;
+
+		/**
+		 * @brief Destroy the frame of the coroutine.
+		 */
+		~HttpTask();
+
+		/**
+		 * @brief Check whether the coroutine ran to its end, or there is none.
+		 */
+		bool done() const noexcept;
+
+		/**
+		 * @brief Run the coroutine from the awaiting one, which is resumed
+		 * when it ends.
+		 */
+		auto operator co_await() && noexcept
+		{
+			struct Awaiter
+			{
+				std::coroutine_handle<promise_type> handle;
+
+				bool await_ready() noexcept { return !this->handle || this->handle.done(); }
+
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+				{
+					this->handle.promise().continuation = awaiting;
+					return this->handle;
+				}
+
+				void await_resume() noexcept {}
+			};
+			return Awaiter{this->_handle};
+		}
+
+	private:
+		friend class HttpConnection;
+
+		explicit HttpTask(std::coroutine_handle<promise_type> handle) noexcept;
+
+		std::coroutine_handle<promise_type> _handle;
+	};
+
+	/**
+	 * @brief A connection of AsyncHttpServer seen from its coroutine. Every
+	 * awaitable first tries to complete without suspending, and only
+	 * suspends when the socket would block, so a handler written as
+	 * sequential code does the same reads and writes as a state machine.
+	 * The connection is used by the loop thread only.
+	 */
+	class HttpConnection
+	{
+	public:
+		HttpConnection(const HttpConnection &)            = delete;
+		HttpConnection &operator=(const HttpConnection &) = delete;
+
+		/**
+		 * @brief Close the socket.
+		 */
+		~HttpConnection();
+
+		/**
+		 * @brief Awaitable of the next request header, nullptr if the
+		 * connection ends: the client closed it, asked to close it after the
+		 * previous response, or sent an invalid request, which is answered
+		 * with an error. The unread body of the previous request is skipped.
+		 * The header is valid until the next readRequest().
+		 */
+		auto readRequest() noexcept
+		{
+			return _Awaiter<const HttpRequestHeader *, &HttpConnection::_tryReadRequest>{*this};
+		}
+
+		/**
+		 * @brief Awaitable of the next piece of the request body, decoded if
+		 * it is chunked. It is empty at the end of the body, or if the body
+		 * is invalid or larger than max_body_size, which ends the connection.
+		 * The piece is a view of the read buffer, valid until the next await.
+		 */
+		auto readBodyChunk() noexcept { return _Awaiter<std::string_view, &HttpConnection::_tryReadBody>{*this}; }
+
+		/**
+		 * @brief Awaitable of writing a response to the current request. The
+		 * header is completed like HttpServer does: the version, the
+		 * Content-Length and the Connection field, and the body is dropped
+		 * for HEAD requests. Nothing is copied, the body must stay valid
+		 * until the await ends.
+		 *
+		 * @param header the response header.
+		 * @param body the body.
+		 * @return an awaitable of whether the response is written.
+		 */
+		auto writeResponse(HttpResponseHeader header, std::string_view body = {}) noexcept
+		{
+			return _WriteAwaiter{*this, std::move(header), body};
+		}
+
+		/**
+		 * @brief Get the frame allocator of the connection.
+		 */
+		FramePool &frames() noexcept;
+
+	private:
+		friend class AsyncHttpServer;
+
+		/**
+		 * @brief The result of filling the read buffer.
+		 */
+		enum class _Fill
+		{
+			DATA,
+			AGAIN,
+			END
+		};
+
+		/**
+		 * @brief An awaitable of a read operation. The operation returns false
+		 * if it has to wait for the socket.
+		 */
+		template <typename Result, bool (HttpConnection::*Operation)(Result &)>
+		struct _Awaiter
+		{
+			HttpConnection &connection;
+			Result result{};
+
+			bool await_ready() noexcept { return (this->connection.*Operation)(this->result); }
+
+			void await_suspend(std::coroutine_handle<> handle) noexcept
+			{
+				this->connection._suspend(handle, &_Awaiter::retry, this);
+			}
+
+			Result await_resume() noexcept { return this->result; }
+
+			static bool retry(void *awaiter)
+			{
+				_Awaiter &self = *static_cast<_Awaiter *>(awaiter);
+				return (self.connection.*Operation)(self.result);
+			}
+		};
+
+		struct _WriteAwaiter
+		{
+			HttpConnection &connection;
+			HttpResponseHeader header;
+			std::string_view body;
+			bool result = false;
+
+			bool await_ready() noexcept
+			{
+				return this->connection._write(this->header, this->body, this->result);
+			}
+
+			void await_suspend(std::coroutine_handle<> handle) noexcept
+			{
+				this->connection._suspend(handle, &_WriteAwaiter::retry, this);
+			}
+
+			bool await_resume() noexcept { return this->result; }
+
+			static bool retry(void *awaiter)
+			{
+				_WriteAwaiter &self = *static_cast<_WriteAwaiter *>(awaiter);
+				return self.connection._tryWrite(self.result);
+			}
+		};
+
+		HttpConnection(int fd, const ServerConfig &config, std::atomic<std::uint64_t> &requests);
+
+		/**
+		 * @brief Park a coroutine until the operation of its awaiter can
+		 * complete.
+		 *
+		 * @param handle the coroutine.
+		 * @param retry retries the operation, false if it still has to wait.
+		 * @param awaiter the awaiter passed to retry.
+		 */
+		void _suspend(std::coroutine_handle<> handle, bool (*retry)(void *), void *awaiter) noexcept;
+
+		/**
+		 * @brief Create the coroutine of the connection and run it until its
+		 * first operation would block.
+		 */
+		void _start(const std::function<HttpTask(HttpConnection &)> &handler);
+
+		/**
+		 * @brief Retry the operation of the parked coroutine, and resume the
+		 * coroutine if it completes.
+		 */
+		void _resume();
+
+		/**
+		 * @brief The operations of the awaitables.
+		 *
+		 * @return the operation completed, or false if it has to wait for the
+		 * socket.
+		 */
+		bool _tryReadRequest(const HttpRequestHeader *&request);
+		bool _tryReadBody(std::string_view &chunk);
+		bool _tryWrite(bool &written);
+
+		/**
+		 * @brief Read from the socket into the buffer, keeping the unread
+		 * bytes at its front and growing it up to max_header_size plus
+		 * read_buffer_size bytes.
+		 */
+		_Fill _fill();
+
+		/**
+		 * @brief Queue a response and write it. While another pipelined
+		 * request is buffered and nothing is in flight, the response is
+		 * copied instead, and sent in one write with the next ones.
+		 *
+		 * @return the write completed, or false if it has to wait for the
+		 * socket.
+		 */
+		bool _write(HttpResponseHeader &header, std::string_view body, bool &written);
+
+		/**
+		 * @brief Serialize a response into the output segments.
+		 */
+		void _queue(HttpResponseHeader &header, std::string_view body);
+
+		/**
+		 * @brief Queue an error response, unless the request is answered
+		 * already, and end the connection. The next response is dropped.
+		 */
+		void _reject(HttpResponseHeader::StatusCode status);
+
+		/**
+		 * @brief Write the copied responses, then the queued segments, until
+		 * the socket is full.
+		 *
+		 * @return nothing is left to write, or false if the socket is full.
+		 * The segments are dropped if the socket fails.
+		 */
+		bool _flush();
+
+		// the frames of the task must be released before the pool
+		FramePool _frames;
+		HttpTask _task;
+		int _fd;
+		std::size_t _index;
+		const ServerConfig &_config;
+		std::atomic<std::uint64_t> &_requests;
+
+		std::string _input;
+		std::size_t _input_begin;
+		std::size_t _input_end;
+		// a header split over reads, resumed where the previous read stopped
+		HttpRequestParser _parser;
+		std::size_t _parsed;
+		HttpRequestHeader _request;
+		bool _head;
+		bool _http10;
+		bool _in_body;
+		bool _chunked;
+		std::size_t _body_left;
+		std::size_t _body_size;
+		ChunkedDecoder _decoder;
+
+		std::vector<iovec> _iov;
+		std::size_t _iov_first;
+		std::string _output;
+		std::string _sending;
+		HttpResponseHeader _error;
+
+		bool _keep_alive;
+		bool _answered;
+		bool _closing;
+		bool _failed;
+
+		std::coroutine_handle<> _waiting;
+		bool (*_retry)(void *);
+		void *_awaiter;
+	};
+
+	/**
+	 * @brief An HTTP/1.1 server running one coroutine per connection on an
+	 * edge-triggered epoll loop, for handlers that stream bodies. The
+	 * coroutine reads the requests of its connection and writes their
+	 * responses one after the other, and the connection is closed when it
+	 * returns.
+	 */
+	class AsyncHttpServer
+	{
+	public:
+		/**
+		 * @brief Start the coroutine of a connection, on the loop thread.
+		 */
+		using Handler = std::function<HttpTask(HttpConnection &connection)>;
+
+		/**
+		 * @brief Construct a new server.
+		 *
+		 * @param handler the connection handler.
+		 * @param config the limits, the backend and the executor are ignored.
+		 */
+		explicit AsyncHttpServer(Handler handler, ServerConfig config = {});
+
+		AsyncHttpServer(const AsyncHttpServer &)            = delete;
+		AsyncHttpServer &operator=(const AsyncHttpServer &) = delete;
+
+		/**
+		 * @brief Close the listening socket and the connections.
+		 */
+		~AsyncHttpServer();
+
+		/**
+		 * @brief Bind and listen on an IPv4 address.
+		 *
+		 * @param address the address, e.g. "127.0.0.1" or "0.0.0.0".
+		 * @param port the port, 0 to pick a free one.
+		 * @return the server listens or not.
+		 */
+		bool listen(const std::string &address, std::uint16_t port);
+
+		/**
+		 * @brief Get the port the server listens on.
+		 */
+		std::uint16_t port() const noexcept;
+
+		/**
+		 * @brief Run the event loop until stop() is called.
+		 *
+		 * @return the loop stopped normally, or failed.
+		 */
+		bool run();
+
+		/**
+		 * @brief Stop the event loop, safe to call from any thread.
+		 */
+		void stop() noexcept;
+
+		/**
+		 * @brief Get the number of requests read so far.
+		 */
+		std::uint64_t requests() const noexcept;
+
+	private:
+		void _accept();
+
+		/**
+		 * @brief Resume the coroutine of a connection, and close the
+		 * connection once it returned and its output is written.
+		 */
+		void _drive(HttpConnection &connection);
+
+		void _close(HttpConnection &connection);
+
+		Handler _handler;
+		ServerConfig _config;
+		std::vector<std::unique_ptr<HttpConnection>> _connections;
+		std::atomic<std::uint64_t> _requests;
+		std::atomic<bool> _stopping;
+		int _epoll_fd;
+		int _wake_fd;
+		int _listen_fd;
+		std::uint16_t _port;
+	};
+
+} // namespace phase2
+
+#endif
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <phase2/Http.hpp>
+
+namespace phase2
+{
+
+	/**
+	 * @brief Result of feeding bytes to a parser.
+	 */
+	enum class ParseStatus
+	{
+		NEED_MORE,
+		DONE,
+		ERROR
+	};
+
+	/**
+	 * @brief An incremental HTTP header parser. Bytes are pushed in chunks as
+	 * they arrive from the socket, and the parser remembers where it stopped,
+	 * so every byte is examined only once. Only the unfinished line is kept
+	 * between two calls.
+	 *
+	 * @tparam HeaderType HttpRequestHeader or HttpResponseHeader.
+	 */
+	template <typename HeaderType>
+	class BasicHttpParser
+	{
+	protected:
+		using BufferType = std::vector<std::uint8_t>;
+
+	public:
+		/**
+		 * @brief Construct a new parser.
+		 *
+		 * @param max_size the maximum size of the header block, larger headers
+		 * will be rejected.
+		 */
+		explicit BasicHttpParser(std::size_t max_size = 65536) noexcept;
+
+		/**
+		 * @brief Feed a chunk of bytes to the parser.
+		 *
+		 * @param chunk the bytes received.
+		 * @param consumed an optional parameter that stores how many bytes of
+		 * this chunk belong to the header. When the parser is done, the rest of
+		 * the chunk is the start of the body.
+		 * @return NEED_MORE if the header is not complete yet, DONE if the
+		 * header is complete, ERROR if the header is invalid.
+		 */
+		ParseStatus parse(std::string_view chunk,
+						  std::optional<std::reference_wrapper<std::size_t>> consumed = {});
+
+		/**
+		 * @brief Feed a vector buffer to the parser.
+		 *
+		 * @param buf the buffer.
+		 * @param consumed an optional parameter that stores how many bytes of
+		 * this buffer belong to the header.
+		 * @return the status of the parser.
+		 */
+		ParseStatus parse(const BufferType &buf,
+						  std::optional<std::reference_wrapper<std::size_t>> consumed = {});
+
+		/**
+		 * @brief Feed a buffer with the specified size to the parser.
+		 *
+		 * @param buf the buffer.
+		 * @param size size of the buffer.
+		 * @param consumed an optional parameter that stores how many bytes of
+		 * this buffer belong to the header.
+		 * @return the status of the parser.
+		 */
+		ParseStatus parse(const std::uint8_t *buf, std::size_t size,
+						  std::optional<std::reference_wrapper<std::size_t>> consumed = {});
+
+		/**
+		 * @brief Get the total number of header bytes consumed so far. When
+		 * the parser is done, this is where the body starts.
+		 *
+		 * @return the number of bytes.
+		 */
+		std::size_t consumed() const noexcept;
+
+		/**
+		 * @brief Get the parsed header. The header is valid only after the
+		 * parser returns DONE.
+		 *
+		 * @return the parsed header.
+		 */
+		const HeaderType &header() const noexcept;
+
+		/**
+		 * @brief Get the parsed header. The header is valid only after the
+		 * parser returns DONE.
+		 *
+		 * @return the parsed header.
+		 */
+		HeaderType &header() noexcept;
+
+		/**
+		 * @brief Reset the parser to parse a new message.
+		 */
+		void reset() noexcept;
+
+		/**
+		 * @brief Get the current status of the parser.
+		 *
+		 * @return the status.
+		 */
+		ParseStatus status() const noexcept;
+
+	protected:
+		/**
+		 * @brief Parse a complete line.
+		 *
+		 * @param line the line with the trailing CRLF.
+		 * @return the status after this line.
+		 */
+		ParseStatus _parseLine(std::string_view line);
+
+		HeaderType _header;
+		std::string _line;
+		std::size_t _consumed;
+		std::size_t _max_size;
+		ParseStatus _status;
+		bool _start_line_parsed;
+	};
+
+	using HttpRequestParser  = BasicHttpParser<HttpRequestHeader>;
+	using HttpResponseParser = BasicHttpParser<HttpResponseHeader>;
+
+	extern template class BasicHttpParser<HttpRequestHeader>;
+	extern template class BasicHttpParser<HttpResponseHeader>;
+
+	/**
+	 * @brief Find the body framing of a request (RFC 7230 section 3.3.3).
+	 *
+	 * @param header the request header.
+	 * @param length stores the Content-Length, 0 if there is none.
+	 * @param chunked stores whether the body is chunked.
+	 * @return the framing is valid or not. Conflicting Content-Length values
+	 * and transfer codings other than a final chunked are rejected.
+	 */
+	bool body_framing(const HttpRequestHeaderView &header, std::size_t &length, bool &chunked) noexcept;
+
+	/**
+	 * @brief Check whether the client keeps the connection open after a
+	 * request: HTTP/1.1 unless it sends "Connection: close", HTTP/1.0 only if
+	 * it sends "Connection: keep-alive".
+	 *
+	 * @param request the request header.
+	 * @return the connection stays open or not.
+	 */
+	bool keep_alive(const HttpRequestHeaderView &request) noexcept;
+
+	/**
+	 * @brief A request found by HttpRequestPipeline.
+	 */
+	struct PipelinedRequest
+	{
+		/**
+		 * @brief The header, a view of the pipeline buffer.
+		 */
+		HttpRequestHeaderView header;
+
+		/**
+		 * @brief The Content-Length body, a slice of the pipeline buffer. It is
+		 * empty for chunked requests.
+		 */
+		std::string_view body;
+
+		/**
+		 * @brief The number of bytes of the message, header and body. When
+		 * the buffer ends in the body, it is the size the buffer must reach,
+		 * and 0 when it ends in the header.
+		 */
+		std::size_t size;
+
+		/**
+		 * @brief The body uses the chunked transfer coding and follows the
+		 * header in the buffer. It is not consumed, the caller decodes it and
+		 * calls HttpRequestPipeline::advance with its size.
+		 */
+		bool chunked;
+	};
+
+	/**
+	 * @brief Walk a buffer holding several requests, as pipelining clients
+	 * send them in one read. The requests and their bodies are views of the
+	 * buffer, nothing is copied. When the buffer ends in the middle of a
+	 * request, remaining() is the part to keep for the next read.
+	 */
+	class HttpRequestPipeline
+	{
+	public:
+		/**
+		 * @brief Construct a pipeline over a buffer.
+		 *
+		 * @param buffer the received bytes, which must outlive the pipeline
+		 * and the requests.
+		 * @param max_size the maximum size of a header block, larger headers
+		 * will be rejected.
+		 */
+		explicit HttpRequestPipeline(std::string_view buffer, std::size_t max_size = 65536) noexcept;
+
+		/**
+		 * @brief Parse the next request and consume it.
+		 *
+		 * @param request stores the request.
+		 * @return DONE if a request is parsed, NEED_MORE if the buffer ends
+		 * before the next request does, ERROR if the request is invalid, its
+		 * framing is ambiguous or its size overflows. NEED_MORE and ERROR
+		 * consume nothing.
+		 */
+		ParseStatus next(PipelinedRequest &request) noexcept;
+
+		/**
+		 * @brief Consume bytes the caller handled itself, e.g. a chunked body.
+		 *
+		 * @param size the number of bytes, at most remaining().size().
+		 */
+		void advance(std::size_t size) noexcept;
+
+		/**
+		 * @brief Get the number of bytes consumed so far.
+		 */
+		std::size_t consumed() const noexcept;
+
+		/**
+		 * @brief Get the bytes not consumed yet.
+		 */
+		std::string_view remaining() const noexcept;
+
+	private:
+		std::string_view _buffer;
+		std::size_t _consumed;
+		std::size_t _max_size;
+	};
+
+} // namespace phase2
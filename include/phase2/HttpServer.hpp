@@ -0,0 +1,463 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <phase2/Chunked.hpp>
+#include <phase2/Http.hpp>
+#include <phase2/HttpParser.hpp>
+#include <phase2/utils/MpscQueue.hpp>
+
+namespace phase2
+{
+
+	/**
+	 * @brief A response returned by a handler of HttpServer.
+	 */
+	struct HttpResponse
+	{
+		/**
+		 * @brief The header. The server sets HTTP/1.1 if the version is not
+		 * set, and adds Content-Length and Connection when they are missing.
+		 */
+		HttpResponseHeader header;
+
+		/**
+		 * @brief The body, it is not sent for HEAD requests.
+		 */
+		std::string body;
+	};
+
+	/**
+	 * @brief The I/O backends of HttpServer.
+	 */
+	enum class ServerBackend
+	{
+		/**
+		 * @brief io_uring if the kernel supports it, epoll otherwise.
+		 */
+		AUTO,
+		EPOLL,
+		IO_URING
+	};
+
+	/**
+	 * @brief Convert a server backend to string.
+	 *
+	 * @param backend the backend.
+	 * @return the string.
+	 */
+	std::string_view to_string(ServerBackend backend) noexcept;
+
+	class IoUring;
+	class WorkStealingExecutor;
+
+	/**
+	 * @brief The limits of HttpServer.
+	 */
+	struct ServerConfig
+	{
+		/**
+		 * @brief The I/O backend.
+		 */
+		ServerBackend backend = ServerBackend::AUTO;
+
+		/**
+		 * @brief The maximum size of a request header block.
+		 */
+		std::size_t max_header_size = 65536;
+
+		/**
+		 * @brief The maximum size of a request body.
+		 */
+		std::size_t max_body_size = 1 << 20;
+
+		/**
+		 * @brief The initial size of the read buffer of a connection, it grows
+		 * up to max_header_size + max_body_size.
+		 */
+		std::size_t read_buffer_size = 16384;
+
+		/**
+		 * @brief The number of response bytes queued on a connection above
+		 * which the server stops reading from it until the client reads.
+		 */
+		std::size_t max_pending_output = 1 << 20;
+
+		/**
+		 * @brief The backlog of the listening socket.
+		 */
+		int backlog = 1024;
+
+		/**
+		 * @brief The number of receive buffers of size read_buffer_size the
+		 * io_uring backend provides to the kernel, a power of 2.
+		 */
+		std::uint16_t ring_buffers = 256;
+
+		/**
+		 * @brief Set SO_REUSEPORT on the listening socket, so several servers
+		 * listen on the same port and the kernel spreads the connections
+		 * across them.
+		 */
+		bool reuse_port = false;
+
+		/**
+		 * @brief The CPU run() pins its thread to, -1 to keep the affinity.
+		 */
+		int cpu = -1;
+
+		/**
+		 * @brief An executor running the handler off the loop, for handlers
+		 * that block or burn CPU, nullptr to call it on the loop. A connection
+		 * waits for the response of its offloaded request before its next
+		 * request is handled. The executor must outlive the server.
+		 */
+		WorkStealingExecutor *executor = nullptr;
+	};
+
+	/**
+	 * @brief Create a non-blocking socket listening on an IPv4 address, with
+	 * the backlog and the socket options of a config.
+	 *
+	 * @param address the address, e.g. "127.0.0.1" or "0.0.0.0".
+	 * @param port the port, 0 to pick a free one, stores the bound port.
+	 * @param config the config.
+	 * @return the socket, or -1 if it cannot listen.
+	 */
+	int open_listener(const std::string &address, std::uint16_t &port, const ServerConfig &config);
+
+	/**
+	 * @brief A non-blocking HTTP/1.1 server driven by an event loop on the
+	 * calling thread, either edge-triggered epoll or io_uring with multishot
+	 * accept and recv into provided buffers. Every read is parsed with
+	 * HttpRequestPipeline, so pipelined requests arriving in one read are
+	 * answered with one write. The header of a request split over reads is
+	 * fed to HttpRequestParser as it arrives, so earlier reads are not scanned
+	 * again, and once it is complete the pipeline parses it once more.
+	 * Connections are kept alive unless the client asks otherwise, and a
+	 * connection whose client does not read its responses is not read either,
+	 * so the queued output stays bounded.
+	 */
+	class HttpServer
+	{
+	public:
+		/**
+		 * @brief Called for every request with its decoded body, on the loop
+		 * thread where it must not block, or on a worker of config.executor.
+		 * It must not throw.
+		 */
+		using Handler = std::function<HttpResponse(const HttpRequestHeader &request, std::string_view body)>;
+
+		/**
+		 * @brief Construct a new server.
+		 *
+		 * @param handler the request handler.
+		 * @param config the limits.
+		 */
+		explicit HttpServer(Handler handler, ServerConfig config = {});
+
+		HttpServer(const HttpServer &)            = delete;
+		HttpServer &operator=(const HttpServer &) = delete;
+
+		/**
+		 * @brief Close the listening socket and the connections.
+		 */
+		~HttpServer();
+
+		/**
+		 * @brief Bind and listen on an IPv4 address.
+		 *
+		 * @param address the address, e.g. "127.0.0.1" or "0.0.0.0".
+		 * @param port the port, 0 to pick a free one.
+		 * @return the server listens or not.
+		 */
+		bool listen(const std::string &address, std::uint16_t port);
+
+		/**
+		 * @brief Get the port the server listens on.
+		 */
+		std::uint16_t port() const noexcept;
+
+		/**
+		 * @brief Get the I/O backend run() uses. It is resolved when the
+		 * server is constructed, and becomes EPOLL if run() cannot set up
+		 * io_uring.
+		 */
+		ServerBackend backend() const noexcept;
+
+		/**
+		 * @brief Run the event loop until stop() is called.
+		 *
+		 * @return the loop stopped normally, or failed.
+		 */
+		bool run();
+
+		/**
+		 * @brief Stop the event loop, safe to call from any thread.
+		 */
+		void stop() noexcept;
+
+		/**
+		 * @brief Get the number of requests handled so far.
+		 */
+		std::uint64_t requests() const noexcept;
+
+	private:
+		struct _Connection
+		{
+			int fd;
+			std::size_t index;
+			std::string input;
+			std::size_t input_size;
+			// the header of the request at the front of the input, resumed
+			// where the previous read stopped, and the size the input must
+			// reach once it is complete
+			HttpRequestParser parser;
+			std::size_t parsed;
+			std::size_t needed;
+			std::deque<HttpResponse> responses;
+			std::vector<iovec> iov;
+			std::size_t iov_first;
+			std::size_t output_size;
+			ChunkedDecoder decoder;
+			HttpRequestHeader chunked_request;
+			std::string chunked_body;
+			bool in_chunked;
+			bool keep_alive;
+			bool readable;
+			bool eof;
+			bool closing;
+			bool offloaded;
+
+			// io_uring state, the operations in flight keep the connection alive
+			std::vector<iovec> sending_iov;
+			msghdr message;
+			bool recv_armed;
+			bool paused;
+			bool sending;
+			bool closed;
+			// an operation found the submission ring full, the loop retries it
+			bool deferred;
+		};
+
+		bool _runEpoll();
+		bool _runUring();
+
+		/**
+		 * @brief Register an accepted socket.
+		 */
+		_Connection &_open(int fd);
+
+		void _accept();
+
+		/**
+		 * @brief Read, handle and write until the connection blocks.
+		 */
+		void _drive(_Connection &connection);
+
+		/**
+		 * @brief Read once from the socket.
+		 *
+		 * @return the connection is still open or not.
+		 */
+		bool _read(_Connection &connection);
+
+		/**
+		 * @brief Handle the buffered requests until the queued output is full.
+		 *
+		 * @return a request was handled, or the queued output stopped the
+		 * handling, so calling it again may handle more.
+		 */
+		bool _process(_Connection &connection);
+
+		/**
+		 * @brief The response of an offloaded request, sent back to the loop.
+		 */
+		struct _Completion
+		{
+			_Connection *connection;
+			HttpResponse response;
+			bool head;
+			bool http10;
+		};
+
+		/**
+		 * @brief Call the handler, or offload it to the executor, and queue
+		 * its response.
+		 */
+		void _respond(_Connection &connection, HttpRequestHeader request, std::string_view body);
+
+		/**
+		 * @brief Queue the response of the handler.
+		 */
+		void _finish(_Connection &connection, HttpResponse &&response, bool head, bool http10);
+
+		/**
+		 * @brief Finish the offloaded requests the executor completed.
+		 */
+		void _complete();
+
+		/**
+		 * @brief Wake the event loop up.
+		 */
+		void _wake() noexcept;
+
+		/**
+		 * @brief Queue an error response and close the connection after it.
+		 */
+		void _reject(_Connection &connection, HttpResponseHeader::StatusCode status);
+
+		/**
+		 * @brief Serialize a response into the output segments.
+		 */
+		void _queue(_Connection &connection, HttpResponse &response, bool head);
+
+		/**
+		 * @brief Write the queued segments until the socket is full.
+		 *
+		 * @return the connection is still open or not.
+		 */
+		bool _flush(_Connection &connection);
+
+		/**
+		 * @brief Skip the segments of written bytes, and release the responses
+		 * once everything is written.
+		 */
+		void _consume(_Connection &connection, std::size_t size);
+
+		/**
+		 * @brief Close a connection, or shut it down if io_uring operations
+		 * are still in flight, the last completion closes it then.
+		 *
+		 * @return the connection is released or not.
+		 */
+		bool _close(_Connection &connection);
+
+		void _armAccept();
+		void _armWake();
+		void _armRecv(_Connection &connection);
+		void _cancelRecv(_Connection &connection);
+		void _send(_Connection &connection);
+
+		/**
+		 * @brief Retry the operations of a connection after the next
+		 * completions, the submission ring is full. The connection is not
+		 * released meanwhile.
+		 */
+		void _defer(_Connection &connection);
+
+		/**
+		 * @brief Retry the deferred operations.
+		 */
+		void _retryDeferred();
+		void _onRecv(_Connection &connection, int result, unsigned flags);
+		void _onSend(_Connection &connection, int result);
+
+		/**
+		 * @brief Handle and write what a completion made possible, and pause
+		 * or resume receiving.
+		 */
+		void _driveUring(_Connection &connection);
+
+		Handler _handler;
+		ServerConfig _config;
+		std::vector<std::unique_ptr<_Connection>> _connections;
+		// read buffers of closed connections, reused by the next ones
+		std::vector<std::string> _spare_buffers;
+		std::atomic<std::uint64_t> _requests;
+		std::atomic<bool> _stopping;
+		MpscQueue<_Completion> _completions;
+		std::atomic<std::size_t> _offloaded;
+		std::unique_ptr<IoUring> _ring;
+		std::vector<_Connection *> _deferred;
+		bool _accept_deferred;
+		bool _wake_deferred;
+		ServerBackend _backend;
+		int _epoll_fd;
+		int _wake_fd;
+		int _listen_fd;
+		std::uint16_t _port;
+	};
+
+	/**
+	 * @brief One HttpServer per core, each running its event loop on its own
+	 * thread with its own SO_REUSEPORT listener, so the kernel spreads the
+	 * connections and the loops share nothing on the hot path: connections,
+	 * read buffers, libmagic handles and the log time cache are per thread.
+	 * The handler is called concurrently from every loop.
+	 */
+	class ShardedHttpServer
+	{
+	public:
+		/**
+		 * @brief Construct the servers.
+		 *
+		 * @param handler the request handler, copied into every shard.
+		 * @param config the limits of every shard, reuse_port is forced.
+		 * @param shards the number of event loops, 0 for one per allowed CPU.
+		 * @param pin_cpus pin every loop to its own CPU, overriding config.cpu.
+		 */
+		explicit ShardedHttpServer(HttpServer::Handler handler, ServerConfig config = {}, std::size_t shards = 0,
+								   bool pin_cpus = false);
+
+		/**
+		 * @brief Bind and listen on an IPv4 address with every shard.
+		 *
+		 * @param address the address, e.g. "127.0.0.1" or "0.0.0.0".
+		 * @param port the port, 0 to pick a free one.
+		 * @return every shard listens or not.
+		 */
+		bool listen(const std::string &address, std::uint16_t port);
+
+		/**
+		 * @brief Get the port the shards listen on.
+		 */
+		std::uint16_t port() const noexcept;
+
+		/**
+		 * @brief Get the number of shards.
+		 */
+		std::size_t shards() const noexcept;
+
+		/**
+		 * @brief Get a shard.
+		 *
+		 * @param index the index of the shard, less than shards().
+		 */
+		HttpServer &shard(std::size_t index) noexcept;
+
+		/**
+		 * @brief Run every event loop until stop() is called or one of them
+		 * fails, which stops the others. The first shard runs on the calling
+		 * thread.
+		 *
+		 * @return every loop stopped normally, or one failed.
+		 */
+		bool run();
+
+		/**
+		 * @brief Stop every event loop, safe to call from any thread.
+		 */
+		void stop() noexcept;
+
+		/**
+		 * @brief Get the number of requests handled so far by all shards.
+		 */
+		std::uint64_t requests() const noexcept;
+
+	private:
+		std::vector<std::unique_ptr<HttpServer>> _servers;
+	};
+
+} // namespace phase2
@@ -1,11 +1,33 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace phase2
 {
 
+	/**
+	 * @brief How get_mime decides the MIME type.
+	 */
+	enum class MimeMode
+	{
+		/**
+		 * @brief Sniff the content with libmagic, and use the extension only
+		 * when libmagic returns a generic type.
+		 */
+		SNIFF,
+
+		/**
+		 * @brief Trust the extension and never open the file, for trusted
+		 * static directories. Unknown extensions are application/octet-stream.
+		 */
+		EXTENSION,
+	};
+
 	/**
 	 * @brief Get the MIME type of the file. This function uses
 	 * libmagic functions to query the MIME type first, and
@@ -14,8 +36,61 @@ namespace phase2
 	 * "application/octet-stream".
 	 *
 	 * @param path path to the file.
+	 * @param mode sniff the content or only look at the extension.
 	 * @return The MIME type of the file in string.
 	 */
-	std::string get_mime(const std::filesystem::path &path);
+	std::string get_mime(const std::filesystem::path &path, MimeMode mode = MimeMode::SNIFF);
+
+	/**
+	 * @brief The number of bytes get_mime looks at in a buffer.
+	 */
+	constexpr std::size_t MIME_SNIFF_SIZE = 4096;
+
+	/**
+	 * @brief Get the MIME type of data in memory, e.g. a request body, without
+	 * any filesystem I/O. Only the first MIME_SNIFF_SIZE bytes are sniffed with
+	 * libmagic, and the extension hint is used if libmagic returns a generic
+	 * type, like the path version does.
+	 *
+	 * @param buf the buffer.
+	 * @param size size of the buffer.
+	 * @param extension an optional extension hint, without the dot.
+	 * @return The MIME type of the data in string.
+	 */
+	std::string get_mime(const std::uint8_t *buf, std::size_t size, std::string_view extension = {});
+
+	/**
+	 * @brief Get the MIME type of data in a vector buffer without any
+	 * filesystem I/O.
+	 *
+	 * @param buf the buffer.
+	 * @param extension an optional extension hint, without the dot.
+	 * @return The MIME type of the data in string.
+	 */
+	std::string get_mime(const std::vector<std::uint8_t> &buf, std::string_view extension = {});
+
+	/**
+	 * @brief Look up the MIME type of a file extension in the table generated
+	 * from data/mime.types. The extension is case-insensitive.
+	 *
+	 * @param extension the extension of the file, without the dot.
+	 * @return The MIME type, or an empty string if the extension is unknown.
+	 */
+	std::string_view get_mime_by_extension(std::string_view extension) noexcept;
+
+	/**
+	 * @brief Select the magic database and load it for the calling thread.
+	 * Every thread keeps its own libmagic handle, which is loaded once on
+	 * the first get_mime call of the thread and reused afterwards, so call
+	 * this at startup to take the loading cost out of the first request.
+	 * Handles of other threads are reloaded on their next call when the
+	 * database changes. A database that cannot be loaded is not selected,
+	 * the previous one stays in use.
+	 *
+	 * @param database path to a magic database, e.g. a precompiled .mgc
+	 * file. An empty path selects the default database of libmagic.
+	 * @return the database is loaded or not.
+	 */
+	bool init_mime(const std::filesystem::path &database = {});
 
 } // namespace phase2
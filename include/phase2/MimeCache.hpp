@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace phase2
+{
+
+	/**
+	 * @brief A concurrent cache in front of get_mime. Entries are keyed by the
+	 * identity of the file (device, inode, modification time and size) and
+	 * the type of its extension, so a hit only costs a stat call, a modified
+	 * or replaced file is sniffed again, and links to the same file with
+	 * different extensions are cached apart. The cache is split into shards with their own lock and LRU list.
+	 */
+	class MimeCache
+	{
+	public:
+		/**
+		 * @brief Construct a new MIME cache.
+		 *
+		 * @param capacity the maximum number of cached files.
+		 * @param shards the number of shards, each holding capacity / shards files.
+		 */
+		explicit MimeCache(std::size_t capacity = 4096, std::size_t shards = 16);
+
+		MimeCache(const MimeCache &)            = delete;
+		MimeCache &operator=(const MimeCache &) = delete;
+
+		/**
+		 * @brief Get the MIME type of a file, calling get_mime only if the file
+		 * is not cached or has changed.
+		 *
+		 * @param path path to the file.
+		 * @return The MIME type of the file in string.
+		 */
+		std::string getMime(const std::filesystem::path &path);
+
+		/**
+		 * @brief Remove all entries. The counters are kept.
+		 */
+		void clear() noexcept;
+
+		/**
+		 * @brief Get the number of lookups answered from the cache.
+		 */
+		std::uint64_t getHits() const noexcept;
+
+		/**
+		 * @brief Get the number of lookups that called get_mime.
+		 */
+		std::uint64_t getMisses() const noexcept;
+
+		/**
+		 * @brief Get the number of cached files.
+		 */
+		std::size_t size() const noexcept;
+
+	private:
+		struct _Key
+		{
+			::dev_t dev;
+			::ino_t ino;
+			std::int64_t mtime_sec;
+			std::int64_t mtime_nsec;
+			::off_t size;
+			// get_mime refines a generic result by the extension, the type it
+			// maps to points into the static table, nullptr if it is unknown
+			const char *extension_type;
+
+			bool operator==(const _Key &other) const noexcept;
+		};
+
+		struct _KeyHash
+		{
+			std::size_t operator()(const _Key &key) const noexcept;
+		};
+
+		using _Entry    = std::pair<_Key, std::string>;
+		using _LruList  = std::list<_Entry>;
+		using _EntryMap = std::unordered_map<_Key, _LruList::iterator, _KeyHash>;
+
+		/**
+		 * @brief A shard with its own lock, on its own cache line so that
+		 * threads working on different shards do not contend.
+		 */
+		struct alignas(64) _Shard
+		{
+			mutable std::mutex mutex;
+			_LruList lru;
+			_EntryMap entries;
+			std::atomic<std::uint64_t> hits{0};
+			std::atomic<std::uint64_t> misses{0};
+		};
+
+		_Shard &_shardOf(const _Key &key) noexcept;
+
+		std::vector<std::unique_ptr<_Shard>> _shards;
+		std::size_t _shard_capacity;
+	};
+
+} // namespace phase2
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace phase2
+{
+
+	class MimeCache;
+
+	/**
+	 * @brief An asynchronous front end of get_mime. Paths are classified by a
+	 * small pool of worker threads, each with its own libmagic handle, so the
+	 * submitting threads never block on disk reads.
+	 */
+	class MimeService
+	{
+	public:
+		/**
+		 * @brief Called by a worker with the path and its MIME type. It must
+		 * not throw.
+		 */
+		using Callback = std::function<void(const std::filesystem::path &, std::string)>;
+
+		/**
+		 * @brief Start the worker threads.
+		 *
+		 * @param threads the number of workers, at least 1.
+		 * @param cache an optional cache to look up first, it must outlive the service.
+		 */
+		explicit MimeService(std::size_t threads = 2, MimeCache *cache = nullptr);
+
+		MimeService(const MimeService &)            = delete;
+		MimeService &operator=(const MimeService &) = delete;
+
+		/**
+		 * @brief Finish the submitted paths and stop the workers.
+		 */
+		~MimeService();
+
+		/**
+		 * @brief Classify a path.
+		 *
+		 * @param path path to the file.
+		 * @return a future of the MIME type.
+		 */
+		std::future<std::string> submit(std::filesystem::path path);
+
+		/**
+		 * @brief Classify a batch of paths.
+		 *
+		 * @param paths paths to the files.
+		 * @return futures of the MIME types, in the order of the paths.
+		 */
+		std::vector<std::future<std::string>> submit(const std::vector<std::filesystem::path> &paths);
+
+		/**
+		 * @brief Classify a path and call back on a worker thread.
+		 *
+		 * @param path path to the file.
+		 * @param callback called with the result.
+		 */
+		void submit(std::filesystem::path path, Callback callback);
+
+		/**
+		 * @brief Classify a batch of paths and call back on the worker threads
+		 * for every path, in any order. This avoids a future per path when
+		 * indexing a large tree.
+		 *
+		 * @param paths paths to the files.
+		 * @param callback called with every result.
+		 */
+		void submit(const std::vector<std::filesystem::path> &paths, Callback callback);
+
+		/**
+		 * @brief Get the number of paths waiting for a worker.
+		 */
+		std::size_t pending() const;
+
+	private:
+		struct _Job
+		{
+			std::filesystem::path path;
+			std::optional<std::promise<std::string>> promise;
+			std::shared_ptr<Callback> callback;
+		};
+
+		void _run();
+
+		mutable std::mutex _mutex;
+		std::condition_variable _cv;
+		std::deque<_Job> _jobs;
+		bool _stopping;
+		MimeCache *_cache;
+		std::vector<std::thread> _workers;
+	};
+
+} // namespace phase2
@@ -1,40 +1,273 @@
 #pragma once
 
-#include <filesystem>
+#include <cstddef>
+#include <iterator>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include <phase2/utils/SmallVector.hpp>
 
 namespace phase2
 {
 
+	class Url;
+
+	/**
+	 * @brief Decode %XX escapes and append the result to a string.
+	 *
+	 * @param str the encoded string.
+	 * @param out the string to append to.
+	 * @param plus_as_space decode '+' to a space, as in a query string.
+	 * @return false if an escape is not followed by two hexadecimal digits,
+	 * out is then left with the part decoded so far.
+	 */
+	bool percent_decode(std::string_view str, std::string &out, bool plus_as_space = true);
+
+	/**
+	 * @brief Escape a string to %XX and append the result to a string.
+	 * Letters, digits and "-._~!'()*" are kept, so the result can be a query
+	 * parameter name or value.
+	 *
+	 * @param str the string to encode.
+	 * @param out the string to append to.
+	 * @param path also keep '/' and the RFC 3986 sub-delims, so the result
+	 * can be a path.
+	 */
+	void percent_encode(std::string_view str, std::string &out, bool path = false);
+
+	/**
+	 * @brief A non-owning view of a request target. The constructor only
+	 * splits the path from the query string, parameters are parsed while they
+	 * are looked up or iterated, without allocating. The path and parameters
+	 * are not percent decoded. The viewed string must outlive the view, use
+	 * toOwned to keep, decode or modify the URL.
+	 */
+	class UrlView
+	{
+	public:
+		/**
+		 * @brief A query parameter, a parameter without '=' has an empty value.
+		 */
+		struct Param
+		{
+			std::string_view name;
+			std::string_view value;
+		};
+
+		/**
+		 * @brief A forward iterator over the parameters of a query string, it
+		 * parses one parameter per step.
+		 */
+		class ParamIterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type        = Param;
+			using difference_type   = std::ptrdiff_t;
+			using pointer           = const Param *;
+			using reference         = const Param &;
+
+			/**
+			 * @brief Construct the end iterator.
+			 */
+			ParamIterator() noexcept;
+
+			/**
+			 * @brief Construct an iterator at the first parameter of a query string.
+			 *
+			 * @param query the query string, without the leading '?'.
+			 */
+			explicit ParamIterator(std::string_view query) noexcept;
+
+			reference operator*() const noexcept;
+
+			pointer operator->() const noexcept;
+
+			ParamIterator &operator++() noexcept;
+
+			ParamIterator operator++(int) noexcept;
+
+			bool operator==(const ParamIterator &other) const noexcept;
+
+			bool operator!=(const ParamIterator &other) const noexcept;
+
+		private:
+			void _parse() noexcept;
+
+			std::string_view _rest;
+			Param _param;
+			bool _more;
+			bool _end;
+		};
+
+		/**
+		 * @brief The parameters of a view, for range-based for loops.
+		 */
+		struct ParamRange
+		{
+			ParamIterator first;
+			ParamIterator last;
+
+			ParamIterator begin() const noexcept { return this->first; }
+			ParamIterator end() const noexcept { return this->last; }
+		};
+
+		UrlView() noexcept;
+
+		/**
+		 * @brief Construct a view of a request target.
+		 *
+		 * @param raw the request target, e.g. "/index.html?lang=en".
+		 */
+		UrlView(std::string_view raw) noexcept;
+
+		/**
+		 * @brief Get the path, the part before '?'.
+		 */
+		std::string_view path() const noexcept;
+
+		/**
+		 * @brief Get the query string, the part after '?'.
+		 */
+		std::string_view query() const noexcept;
+
+		/**
+		 * @brief Look up the first parameter with a name.
+		 *
+		 * @param param the name of the parameter.
+		 * @return the value, or an empty string if there is no such parameter.
+		 */
+		std::string_view getParam(std::string_view param) const noexcept;
+
+		/**
+		 * @brief Iterate the parameters in the order of the query string.
+		 */
+		ParamRange params() const noexcept;
+
+		/**
+		 * @brief Check whether every parameter of the query string has '='.
+		 */
+		bool isValid() const noexcept;
+
+		/**
+		 * @brief Copy the view into an owning Url.
+		 */
+		Url toOwned() const;
+
+	private:
+		std::string_view _path;
+		std::string_view _query;
+	};
+
+	/**
+	 * @brief An owning, percent decoded URL. The parameters are kept in the
+	 * order of the query string, with inline storage for the typical number
+	 * of parameters, and repeated names are kept as separate entries.
+	 */
 	class Url
 	{
 	public:
+		/**
+		 * @brief A query parameter.
+		 */
+		struct Param
+		{
+			std::string name;
+			std::string value;
+		};
+
+		using ParamList = SmallVector<Param, 8>;
+
 		Url() noexcept;
 
+		/**
+		 * @brief Parse and percent decode a request target, the URL is invalid
+		 * if a parameter has no '=', an escape is malformed, or the path
+		 * escapes '/' or NUL, which decoding would turn into another path.
+		 *
+		 * @param raw the request target.
+		 */
 		Url(std::string_view raw);
 
+		explicit Url(const UrlView &view);
+
 		void clearParams() noexcept;
 
-		std::string getParam(std::string_view param) const;
-		
+		/**
+		 * @brief Get the first value of a parameter.
+		 *
+		 * @param param the name of the parameter.
+		 * @return the value, or an empty string if there is no such parameter.
+		 * It is valid until the parameters are modified.
+		 */
+		std::string_view getParam(std::string_view param) const noexcept;
+
+		/**
+		 * @brief Get every value of a parameter, in the order of the query string.
+		 *
+		 * @param param the name of the parameter.
+		 * @return the values, valid until the parameters are modified.
+		 */
+		std::vector<std::string_view> getParams(std::string_view param) const;
+
+		/**
+		 * @brief Get all parameters in order.
+		 */
+		const ParamList &getParams() const noexcept;
+
 		bool isValid() const;
-		
+
+		/**
+		 * @brief Remove every value of a parameter.
+		 *
+		 * @param param the name of the parameter.
+		 */
 		void removeParam(std::string_view param);
 
+		/**
+		 * @brief Set a parameter to a single value. The first entry of the
+		 * parameter keeps its position and the others are removed, a new
+		 * parameter is appended.
+		 *
+		 * @param param the name of the parameter.
+		 * @param value the value.
+		 */
 		void setParam(std::string_view param, std::string_view value);
 
-		std::filesystem::path path() const noexcept;
+		/**
+		 * @brief Append a value of a parameter, existing values are kept.
+		 *
+		 * @param param the name of the parameter.
+		 * @param value the value.
+		 */
+		void addParam(std::string_view param, std::string_view value);
 
-		void path(const std::filesystem::path &p);
+		const std::string &path() const noexcept;
 
+		void path(std::string_view p);
+
+		/**
+		 * @brief Percent encode the URL into a request target.
+		 */
 		std::string string() const;
 
+		/**
+		 * @brief Append the percent encoded URL to an iovec list. The segments
+		 * point into the URL and into a static table of escapes, so they are
+		 * valid until the URL is modified, and several threads may serialize
+		 * the same URL.
+		 *
+		 * @param iov the list to append to.
+		 */
+		void serialize(std::vector<iovec> &iov) const;
+
 	private:
 		bool _valid;
-		std::filesystem::path _path;
-		std::unordered_map<std::string, std::string> _params;
+		std::string _path;
+		ParamList _params;
 	};
 
 } // namespace phase2
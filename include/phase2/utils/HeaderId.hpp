@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace phase2
+{
+
+	/**
+	 * @brief IDs of the standard header fields. Parsed fields are resolved to
+	 * an ID once, so lookups by ID do not need to compare strings.
+	 */
+	enum class HeaderId : std::uint8_t
+	{
+		UNKNOWN = 0,
+
+		ACCEPT,
+		ACCEPT_CHARSET,
+		ACCEPT_ENCODING,
+		ACCEPT_LANGUAGE,
+		ACCEPT_RANGES,
+		ACCESS_CONTROL_ALLOW_ORIGIN,
+		AGE,
+		ALLOW,
+		AUTHORIZATION,
+		CACHE_CONTROL,
+		CONNECTION,
+		CONTENT_DISPOSITION,
+		CONTENT_ENCODING,
+		CONTENT_LANGUAGE,
+		CONTENT_LENGTH,
+		CONTENT_LOCATION,
+		CONTENT_RANGE,
+		CONTENT_TYPE,
+		COOKIE,
+		DATE,
+		ETAG,
+		EXPECT,
+		EXPIRES,
+		FORWARDED,
+		FROM,
+		HOST,
+		IF_MATCH,
+		IF_MODIFIED_SINCE,
+		IF_NONE_MATCH,
+		IF_RANGE,
+		IF_UNMODIFIED_SINCE,
+		KEEP_ALIVE,
+		LAST_MODIFIED,
+		LINK,
+		LOCATION,
+		ORIGIN,
+		PRAGMA,
+		PROXY_AUTHENTICATE,
+		PROXY_AUTHORIZATION,
+		RANGE,
+		REFERER,
+		RETRY_AFTER,
+		SERVER,
+		SET_COOKIE,
+		STRICT_TRANSPORT_SECURITY,
+		TE,
+		TRAILER,
+		TRANSFER_ENCODING,
+		UPGRADE,
+		UPGRADE_INSECURE_REQUESTS,
+		USER_AGENT,
+		VARY,
+		VIA,
+		WWW_AUTHENTICATE,
+		X_FORWARDED_FOR,
+		X_FORWARDED_PROTO,
+		X_REQUESTED_WITH
+	};
+
+	/**
+	 * @brief Number of header IDs, including UNKNOWN.
+	 */
+	constexpr std::size_t HEADER_ID_COUNT = static_cast<std::size_t>(HeaderId::X_REQUESTED_WITH) + 1;
+
+	/**
+	 * @brief Convert a header field name to its ID with a perfect hash table.
+	 *
+	 * @param field the field name, case-insensitive.
+	 * @return the ID, or UNKNOWN if the field is not a standard one.
+	 */
+	HeaderId to_header_id(std::string_view field) noexcept;
+
+	/**
+	 * @brief Convert a header ID to its canonical field name.
+	 *
+	 * @param id the header ID.
+	 * @return the field name, empty for UNKNOWN.
+	 */
+	std::string_view to_string(HeaderId id) noexcept;
+
+} // namespace phase2
@@ -1,9 +1,14 @@
 #pragma once
 
-#include <list>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+
+#include <phase2/utils/HeaderId.hpp>
+#include <phase2/utils/SmallVector.hpp>
 
 namespace phase2
 {
@@ -18,7 +23,214 @@ namespace phase2
 		std::size_t operator()(std::string_view str) const;
 	};
 
-	using HeaderMap = std::unordered_map<std::string, std::list<std::string>,
-										 CaseInsensitiveHash, CaseInsensitiveEqual>;
+	/**
+	 * @brief An entry of BasicHeaderMap.
+	 */
+	template <typename StringType>
+	struct BasicHeaderField
+	{
+		StringType field;
+		StringType value;
+		HeaderId id;
+	};
+
+	/**
+	 * @brief A flat container of header fields. The fields are stored in a
+	 * contiguous vector in insertion order, with inline storage for the
+	 * typical number of headers. Repeated fields are kept as separate entries.
+	 * Field names are compared case-insensitively.
+	 *
+	 * Standard fields are resolved to a HeaderId when they are added, and the
+	 * first entry of every ID is indexed, so lookups by ID are an array access.
+	 *
+	 * @tparam StringType std::string for owning fields, std::string_view for
+	 * fields borrowed from a buffer.
+	 * @tparam N the number of inline fields.
+	 */
+	template <typename StringType, std::size_t N = 16>
+	class BasicHeaderMap
+	{
+	public:
+		using value_type     = BasicHeaderField<StringType>;
+		using container_type = SmallVector<value_type, N>;
+		using size_type      = std::size_t;
+		using iterator       = typename container_type::iterator;
+		using const_iterator = typename container_type::const_iterator;
+
+		BasicHeaderMap() noexcept : _fields{}, _index{} {}
+
+		/**
+		 * @brief Append a field. Existing fields with the same name are kept.
+		 *
+		 * @param field the field name.
+		 * @param value the value.
+		 */
+		void add(std::string_view field, std::string_view value)
+		{
+			this->_add(phase2::to_header_id(field), field, value);
+		}
+
+		/**
+		 * @brief Append a standard field with its canonical name.
+		 *
+		 * @param id the header ID, must not be UNKNOWN.
+		 * @param value the value.
+		 */
+		void add(HeaderId id, std::string_view value)
+		{
+			this->_add(id, phase2::to_string(id), value);
+		}
+
+		/**
+		 * @brief Find the first entry of a standard field.
+		 *
+		 * @param id the header ID.
+		 * @return iterator to the entry, or end() if not found.
+		 */
+		const_iterator find(HeaderId id) const noexcept
+		{
+			const std::uint16_t position = this->_index[static_cast<std::size_t>(id)];
+			if (position == 0 || id == HeaderId::UNKNOWN)
+				return this->end();
+			if (position != _UNINDEXED)
+				return this->begin() + position - 1;
+			return this->find(id, this->begin());
+		}
+
+		/**
+		 * @brief Find the next entry of a standard field, starting from an iterator.
+		 *
+		 * @param id the header ID.
+		 * @param from where to start searching.
+		 * @return iterator to the entry, or end() if not found.
+		 */
+		const_iterator find(HeaderId id, const_iterator from) const noexcept
+		{
+			return std::find_if(from, this->end(), [id](const value_type &entry) { return entry.id == id; });
+		}
+
+		/**
+		 * @brief Find the first entry of a field.
+		 *
+		 * @param field the field name.
+		 * @return iterator to the entry, or end() if not found.
+		 */
+		const_iterator find(std::string_view field) const noexcept
+		{
+			const HeaderId id = phase2::to_header_id(field);
+			if (id != HeaderId::UNKNOWN)
+				return this->find(id);
+			return this->find(field, this->begin());
+		}
+
+		/**
+		 * @brief Find the next entry of a field, starting from an iterator.
+		 *
+		 * @param field the field name.
+		 * @param from where to start searching.
+		 * @return iterator to the entry, or end() if not found.
+		 */
+		const_iterator find(std::string_view field, const_iterator from) const noexcept
+		{
+			const HeaderId id = phase2::to_header_id(field);
+			if (id != HeaderId::UNKNOWN)
+				return this->find(id, from);
+			return std::find_if(from, this->end(),
+								[field](const value_type &entry)
+								{ return entry.id == HeaderId::UNKNOWN && CaseInsensitiveEqual{}(entry.field, field); });
+		}
+
+		/**
+		 * @brief Check whether the map has a field.
+		 *
+		 * @param field the field name or the header ID.
+		 * @return the field exists or not.
+		 */
+		template <typename Key>
+		bool contains(const Key &field) const noexcept
+		{
+			return this->find(field) != this->end();
+		}
+
+		/**
+		 * @brief Count the entries of a field.
+		 *
+		 * @param field the field name or the header ID.
+		 * @return the number of entries.
+		 */
+		template <typename Key>
+		size_type count(const Key &field) const noexcept
+		{
+			size_type n = 0;
+			for (const_iterator it = this->find(field); it != this->end(); it = this->find(field, it + 1))
+				++n;
+			return n;
+		}
+
+		/**
+		 * @brief Remove every entry of a field.
+		 *
+		 * @param field the field name or the header ID.
+		 * @return the number of removed entries.
+		 */
+		template <typename Key>
+		size_type erase(const Key &field)
+		{
+			const size_type size = this->_fields.size();
+			for (const_iterator it = this->find(field); it != this->end(); it = this->find(field, it))
+				this->_fields.erase(it);
+			if (this->_fields.size() != size)
+				this->_reindex();
+			return size - this->_fields.size();
+		}
+
+		void clear() noexcept
+		{
+			this->_fields.clear();
+			this->_index.fill(0);
+		}
+
+		void reserve(size_type n) { this->_fields.reserve(n); }
+		bool empty() const noexcept { return this->_fields.empty(); }
+		size_type size() const noexcept { return this->_fields.size(); }
+		const_iterator begin() const noexcept { return this->_fields.begin(); }
+		const_iterator end() const noexcept { return this->_fields.end(); }
+
+	private:
+		/**
+		 * @brief Index value of fields that are too far to be indexed.
+		 */
+		static constexpr std::uint16_t _UNINDEXED = UINT16_MAX;
+
+		void _add(HeaderId id, std::string_view field, std::string_view value)
+		{
+			this->_fields.push_back(value_type{StringType{field}, StringType{value}, id});
+			this->_indexLast();
+		}
+
+		void _indexLast() noexcept
+		{
+			std::uint16_t &position = this->_index[static_cast<std::size_t>(this->_fields.back().id)];
+			if (position == 0)
+				position = static_cast<std::uint16_t>(std::min<size_type>(this->_fields.size(), _UNINDEXED));
+		}
+
+		void _reindex() noexcept
+		{
+			this->_index.fill(0);
+			for (size_type i = 0; i < this->_fields.size(); ++i)
+			{
+				std::uint16_t &position = this->_index[static_cast<std::size_t>(this->_fields[i].id)];
+				if (position == 0)
+					position = static_cast<std::uint16_t>(std::min<size_type>(i + 1, _UNINDEXED));
+			}
+		}
+
+		container_type _fields;
+		std::array<std::uint16_t, HEADER_ID_COUNT> _index;
+	};
+
+	using HeaderMap     = BasicHeaderMap<std::string>;
+	using HeaderViewMap = BasicHeaderMap<std::string_view>;
 
 } // namespace phase2
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <linux/io_uring.h>
+
+namespace phase2
+{
+
+	/**
+	 * @brief A minimal io_uring instance driven by the raw system calls, so
+	 * there is no dependency on liburing. It maps the submission and
+	 * completion rings and can register one provided-buffer ring, from which
+	 * the kernel picks the buffers of recv operations. It is used by one
+	 * thread only.
+	 */
+	class IoUring
+	{
+	public:
+		/**
+		 * @brief Set up a ring. The ring is created for the calling thread,
+		 * which must be the one submitting.
+		 *
+		 * @param entries the number of submission entries, rounded up to a
+		 * power of 2 by the kernel.
+		 */
+		explicit IoUring(unsigned entries) noexcept;
+
+		IoUring(const IoUring &)            = delete;
+		IoUring &operator=(const IoUring &) = delete;
+
+		/**
+		 * @brief Unmap the rings and close the instance, which cancels the
+		 * operations in flight.
+		 */
+		~IoUring();
+
+		/**
+		 * @brief Check whether the kernel supports every feature HttpServer
+		 * needs: multishot accept and recv, and provided-buffer rings. The
+		 * result is probed once and cached.
+		 */
+		static bool supported() noexcept;
+
+		/**
+		 * @brief Check whether the ring is set up.
+		 */
+		bool isValid() const noexcept;
+
+		/**
+		 * @brief Get a cleared submission entry. When the submission ring is
+		 * full, the queued entries are submitted first.
+		 *
+		 * @return the entry, or nullptr if the ring stays full.
+		 */
+		io_uring_sqe *getSqe() noexcept;
+
+		/**
+		 * @brief Submit the queued entries and wait for completions.
+		 *
+		 * @param wait the number of completions to wait for.
+		 * @return the number of entries submitted, or -1 with errno set.
+		 */
+		int submit(unsigned wait = 0) noexcept;
+
+		/**
+		 * @brief Get the oldest completion not seen yet.
+		 *
+		 * @return the completion, or nullptr if there is none.
+		 */
+		const io_uring_cqe *peekCqe() const noexcept;
+
+		/**
+		 * @brief Release the completion returned by peekCqe().
+		 */
+		void seenCqe() noexcept;
+
+		/**
+		 * @brief Allocate and register the provided-buffer ring.
+		 *
+		 * @param group the buffer group id used by the operations.
+		 * @param count the number of buffers, a power of 2.
+		 * @param size the size of a buffer.
+		 * @return the buffers are registered or not.
+		 */
+		bool registerBuffers(std::uint16_t group, std::uint16_t count, std::size_t size) noexcept;
+
+		/**
+		 * @brief Get a provided buffer.
+		 *
+		 * @param id the buffer id from the completion flags.
+		 */
+		char *buffer(std::uint16_t id) const noexcept;
+
+		/**
+		 * @brief Give a provided buffer back to the kernel.
+		 *
+		 * @param id the buffer id from the completion flags.
+		 */
+		void recycleBuffer(std::uint16_t id) noexcept;
+
+		explicit operator bool() const noexcept { return this->isValid(); }
+
+	private:
+		/**
+		 * @brief Map the rings of a set up instance.
+		 */
+		bool _map(const io_uring_params &params) noexcept;
+
+		int _fd;
+
+		void *_ring;
+		std::size_t _ring_size;
+		void *_cq_ring;
+		std::size_t _cq_ring_size;
+		io_uring_sqe *_sqes;
+		std::size_t _sqes_size;
+
+		unsigned *_sq_head;
+		unsigned *_sq_tail;
+		unsigned _sq_mask;
+		unsigned _sq_entries;
+		unsigned _sq_local_tail;
+
+		unsigned *_cq_head;
+		unsigned *_cq_tail;
+		io_uring_cqe *_cqes;
+		unsigned _cq_mask;
+
+		io_uring_buf *_buf_ring;
+		std::size_t _buf_ring_size;
+		char *_buffers;
+		std::size_t _buffer_size;
+		std::uint16_t _buffer_count;
+		std::uint16_t _buffer_tail;
+	};
+
+} // namespace phase2
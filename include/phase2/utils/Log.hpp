@@ -1,10 +1,19 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <ctime>
 #include <iostream>
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #define TTY_RED "\x1B[38;5;204m"
@@ -40,6 +49,189 @@ namespace phase2
 #endif
 	extern std::mutex log_lock;
 
+	/**
+	 * @brief The modules with their own runtime log level.
+	 */
+	enum class LogModule
+	{
+		GENERAL,
+		HTTP,
+		MIME,
+		URL,
+		SERVER,
+	};
+
+	constexpr std::size_t LOG_MODULE_COUNT = static_cast<std::size_t>(LogModule::SERVER) + 1;
+
+	/**
+	 * @brief Convert log module to string.
+	 *
+	 * @param module log module.
+	 * @return The string.
+	 */
+	std::string_view to_string(LogModule module) noexcept;
+
+#ifndef PHASE2_LOG_FLOOR
+#define PHASE2_LOG_FLOOR 3
+#endif
+
+	/**
+	 * @brief The most verbose level compiled in, set with -DPHASE2_LOG_FLOOR=n
+	 * where n is the value of a LogLevel. PHASE2_LOG statements of more
+	 * verbose levels are removed by the compiler.
+	 */
+	constexpr LogLevel LOG_FLOOR = static_cast<LogLevel>(PHASE2_LOG_FLOOR);
+
+	/**
+	 * @brief The runtime level of every module, records more verbose than it
+	 * are skipped. Use set_log_level and log_enabled instead.
+	 */
+	extern std::array<std::atomic<LogLevel>, LOG_MODULE_COUNT> _log_levels;
+
+	/**
+	 * @brief Set the runtime level of a module.
+	 *
+	 * @param module log module.
+	 * @param level the most verbose level to emit.
+	 */
+	void set_log_level(LogModule module, LogLevel level) noexcept;
+
+	/**
+	 * @brief Check whether records of a level are emitted for a module.
+	 *
+	 * @param level log level.
+	 * @param module log module.
+	 * @return the records are emitted or not.
+	 */
+	inline bool log_enabled(LogLevel level, LogModule module) noexcept
+	{
+		return level <= _log_levels[static_cast<std::size_t>(module)].load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief What the asynchronous logger does when its queue is full.
+	 */
+	enum class LogOverflow
+	{
+		/**
+		 * @brief Discard the record and count it, producers never wait.
+		 */
+		DROP,
+
+		/**
+		 * @brief Wait until the writer thread makes room.
+		 */
+		BLOCK,
+	};
+
+	/**
+	 * @brief Switch to asynchronous logging. Records are pushed into a
+	 * lock-free queue and a background thread writes them to the file
+	 * descriptor in large batches. Safe to call while other threads are
+	 * logging, their records go to std::cerr until it returns.
+	 *
+	 * @param fd the file descriptor to write to.
+	 * @param capacity the number of records the queue holds.
+	 * @param overflow what to do when the queue is full.
+	 * @return the writer thread is started or not, it fails if asynchronous
+	 * logging is already on.
+	 */
+	bool start_async_log(int fd = 2, std::size_t capacity = 8192, LogOverflow overflow = LogOverflow::DROP);
+
+	/**
+	 * @brief Write the queued records and switch back to synchronous logging
+	 * to std::cerr. Safe to call while other threads are logging, it waits
+	 * for the records being pushed. It is called at exit if asynchronous
+	 * logging is still on.
+	 */
+	void stop_async_log();
+
+	/**
+	 * @brief Get the number of records dropped because the queue was full.
+	 */
+	std::uint64_t get_dropped_logs() noexcept;
+
+	/**
+	 * @brief Format the current local time for a record. The string is cached
+	 * per thread and only formatted again when the second changes.
+	 *
+	 * @return the time string, valid until the next call in the same thread.
+	 */
+	std::string_view log_time();
+
+	/**
+	 * @brief Write a formatted record, to the asynchronous queue if it is on,
+	 * otherwise to std::cerr under log_lock.
+	 *
+	 * @param line the record, including the trailing newline.
+	 */
+	void write_log(std::string line);
+
+	/**
+	 * @brief A log record of PHASE2_LOG. The arguments are appended to the
+	 * record as they come, and the record is written when it is destroyed at
+	 * the end of the statement. Records are only created for enabled levels,
+	 * so filtered statements do not format or even evaluate their arguments.
+	 */
+	class LogRecord
+	{
+	public:
+		LogRecord(LogLevel level, LogModule module);
+		~LogRecord();
+
+		LogRecord(const LogRecord &)            = delete;
+		LogRecord &operator=(const LogRecord &) = delete;
+
+		template <typename T>
+		LogRecord &operator<<(const T &value)
+		{
+			if constexpr (std::is_same_v<T, char>)
+				this->_line += value;
+			else if constexpr (std::is_same_v<T, bool>)
+				this->_line += value ? "true" : "false";
+			else if constexpr (std::is_integral_v<T>)
+			{
+				char buf[24];
+				this->_line.append(buf, std::to_chars(buf, buf + sizeof(buf), value).ptr);
+			}
+			else if constexpr (std::is_convertible_v<const T &, std::string_view>)
+				this->_line += std::string_view{value};
+			else
+			{
+				std::ostringstream ss;
+				ss << value;
+				this->_line += ss.str();
+			}
+			return *this;
+		}
+
+	private:
+		std::string _line;
+	};
+
+	/**
+	 * @brief Turn a PHASE2_LOG statement into void, so both branches of its
+	 * conditional have the same type. operator& binds looser than operator<<.
+	 */
+	struct LogVoidify
+	{
+		void operator&(const LogRecord &) const noexcept {}
+	};
+
+/**
+ * @brief Log a record, e.g. PHASE2_LOG(DEBUG, HTTP) << "parsed " << n << " fields".
+ * Levels more verbose than LOG_FLOOR are compiled out, and levels filtered
+ * by the runtime level of the module cost one relaxed atomic load.
+ *
+ * @param level ERROR, WARNING, INFO or DEBUG.
+ * @param module a LogModule.
+ */
+#define PHASE2_LOG(level, module)                                                                                 \
+	!(::phase2::LogLevel::LOG_##level <= ::phase2::LOG_FLOOR &&                                                   \
+	  ::phase2::log_enabled(::phase2::LogLevel::LOG_##level, ::phase2::LogModule::module))                        \
+		? (void)0                                                                                                 \
+		: ::phase2::LogVoidify{} & ::phase2::LogRecord{::phase2::LogLevel::LOG_##level, ::phase2::LogModule::module}
+
 	template <LogLevel level>
 	class Log
 	{
@@ -49,16 +241,23 @@ namespace phase2
 		{
 			if constexpr (_global_level < level)
 				return;
+			if (!log_enabled(level, LogModule::GENERAL))
+				return;
 
-			auto &&now   = std::chrono::system_clock::now();
-			auto &&now_c = std::chrono::system_clock::to_time_t(now);
-			char time_buf[128];
-			strftime(time_buf, sizeof(time_buf),
-					 "%Y-%m-%d %H:%M:%S", std::localtime(&now_c));
+			std::string line = to_string(level);
+			line += ' ';
+			line += log_time();
+			line += " | ";
+			if constexpr (std::is_convertible_v<const T &, std::string_view>)
+				line += std::string_view{data};
+			else
 			{
-				std::lock_guard<std::mutex> guard{log_lock};
-				std::cerr << to_string(level) << ' ' << time_buf << " | " << data << '\n';
+				std::ostringstream ss;
+				ss << data;
+				line += ss.str();
 			}
+			line += '\n';
+			write_log(std::move(line));
 		}
 	};
 
@@ -81,7 +280,7 @@ namespace phase2
 			else if constexpr (level == LogLevel::LOG_INFO)
 				log_info.log(ss.str());
 			else
-				log_debug.log(ss.str());
+				log_error.log(ss.str());
 		}
 
 		LogBuffer(const LogBuffer &) = delete;
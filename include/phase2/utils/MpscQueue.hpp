@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace phase2
+{
+
+	/**
+	 * @brief A bounded lock-free queue with many producers and one consumer,
+	 * after Dmitry Vyukov's bounded MPMC queue. Every cell has a sequence
+	 * number telling whether it is free for the producer of a position or
+	 * filled for the consumer, so producers only contend on one atomic
+	 * counter and never wait for each other.
+	 *
+	 * @tparam T the element type, must be default constructible and movable.
+	 */
+	template <typename T>
+	class MpscQueue
+	{
+	public:
+		/**
+		 * @brief Construct an empty queue.
+		 *
+		 * @param capacity the number of elements, rounded up to a power of 2.
+		 */
+		explicit MpscQueue(std::size_t capacity)
+			: _cells{}, _mask{_round_up(capacity) - 1}, _tail{0}, _head{0}
+		{
+			this->_cells = std::make_unique<_Cell[]>(this->_mask + 1);
+			for (std::size_t i = 0; i <= this->_mask; ++i)
+				this->_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		MpscQueue(const MpscQueue &)            = delete;
+		MpscQueue &operator=(const MpscQueue &) = delete;
+
+		/**
+		 * @brief Push an element, safe to call from any thread.
+		 *
+		 * @param value the element, only moved from if it is pushed.
+		 * @return the element is pushed, or the queue is full.
+		 */
+		template <typename U>
+		bool tryPush(U &&value)
+		{
+			std::size_t position = this->_tail.load(std::memory_order_relaxed);
+			while (true)
+			{
+				_Cell &cell                = this->_cells[position & this->_mask];
+				const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				const std::intptr_t diff   = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+				if (diff == 0)
+				{
+					if (this->_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						cell.value = std::forward<U>(value);
+						cell.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff < 0)
+					return false;
+				else
+					position = this->_tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		/**
+		 * @brief Pop an element, only the consumer thread may call it.
+		 *
+		 * @param value stores the element.
+		 * @return an element is popped, or the queue is empty.
+		 */
+		bool tryPop(T &value)
+		{
+			_Cell &cell = this->_cells[this->_head & this->_mask];
+			if (cell.sequence.load(std::memory_order_acquire) != this->_head + 1)
+				return false;
+			value = std::move(cell.value);
+			cell.sequence.store(this->_head + this->_mask + 1, std::memory_order_release);
+			++this->_head;
+			return true;
+		}
+
+		/**
+		 * @brief Check whether the queue is empty, only the consumer thread may
+		 * call it.
+		 */
+		bool empty() const noexcept
+		{
+			return this->_cells[this->_head & this->_mask].sequence.load(std::memory_order_acquire) !=
+				   this->_head + 1;
+		}
+
+		std::size_t capacity() const noexcept { return this->_mask + 1; }
+
+	private:
+		struct _Cell
+		{
+			std::atomic<std::size_t> sequence;
+			T value;
+		};
+
+		static std::size_t _round_up(std::size_t n) noexcept
+		{
+			std::size_t capacity = 2;
+			while (capacity < n)
+				capacity <<= 1;
+			return capacity;
+		}
+
+		std::unique_ptr<_Cell[]> _cells;
+		std::size_t _mask;
+		alignas(64) std::atomic<std::size_t> _tail;
+		alignas(64) std::size_t _head;
+	};
+
+} // namespace phase2
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string_view>
+
+namespace phase2
+{
+
+	/**
+	 * @brief Implementations of the delimiter scanning functions.
+	 */
+	enum class ScanBackend
+	{
+		SCALAR,
+		SSE42,
+		AVX2
+	};
+
+	/**
+	 * @brief Get the scanning implementation in use. The fastest one supported
+	 * by the CPU is picked on the first call.
+	 *
+	 * @return the backend.
+	 */
+	ScanBackend get_scan_backend() noexcept;
+
+	/**
+	 * @brief Force a scanning implementation. This is meant for tests and
+	 * benchmarks and should be called before any parsing starts.
+	 *
+	 * @param backend the backend to use.
+	 * @return false if the CPU does not support the backend.
+	 */
+	bool set_scan_backend(ScanBackend backend) noexcept;
+
+	/**
+	 * @brief Find the first byte that is not a token character (RFC 7230
+	 * tchar). Space, colon, CR and LF all stop the scan, so this finds the end
+	 * of a method or a header field name and validates it in the same pass.
+	 *
+	 * @param first the first byte to scan.
+	 * @param last one past the last byte to scan.
+	 * @return pointer to the byte found, or last if every byte is a token character.
+	 */
+	const char *find_non_token(const char *first, const char *last) noexcept;
+
+	/**
+	 * @brief Find the first control character other than horizontal tab,
+	 * including CR, LF and DEL. This finds the end of a line and rejects
+	 * control characters inside it in the same pass.
+	 *
+	 * @param first the first byte to scan.
+	 * @param last one past the last byte to scan.
+	 * @return pointer to the byte found, or last if there is no control character.
+	 */
+	const char *find_ctl(const char *first, const char *last) noexcept;
+
+	/**
+	 * @brief Find the first '%' or '+', the bytes percent_decode rewrites.
+	 *
+	 * @param first the first byte to scan.
+	 * @param last one past the last byte to scan.
+	 * @return pointer to the byte found, or last if there is none.
+	 */
+	const char *find_url_escape(const char *first, const char *last) noexcept;
+
+	/**
+	 * @brief Find the first byte percent_encode has to escape.
+	 *
+	 * @param first the first byte to scan.
+	 * @param last one past the last byte to scan.
+	 * @param path scan a path, which keeps '/' and the RFC 3986 sub-delims,
+	 * instead of a query parameter name or value.
+	 * @return pointer to the byte found, or last if every byte is kept.
+	 */
+	const char *find_url_unsafe(const char *first, const char *last, bool path = false) noexcept;
+
+	/**
+	 * @brief Convert the scanning backend to a string.
+	 *
+	 * @param backend the backend.
+	 * @return the converted string.
+	 */
+	std::string_view to_string(ScanBackend backend) noexcept;
+
+} // namespace phase2
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace phase2
+{
+
+	/**
+	 * @brief A contiguous vector that keeps the first N elements in inline
+	 * storage and only allocates when it grows past N.
+	 *
+	 * @tparam T the element type.
+	 * @tparam N the number of inline elements.
+	 */
+	template <typename T, std::size_t N>
+	class SmallVector
+	{
+	public:
+		using value_type             = T;
+		using size_type              = std::size_t;
+		using reference              = T &;
+		using const_reference        = const T &;
+		using iterator               = T *;
+		using const_iterator         = const T *;
+		using reverse_iterator       = std::reverse_iterator<iterator>;
+		using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+		/**
+		 * @brief Construct an empty vector.
+		 */
+		SmallVector() noexcept : _data{reinterpret_cast<T *>(_storage)}, _size{0}, _capacity{N} {}
+
+		SmallVector(const SmallVector &other) : SmallVector{}
+		{
+			this->reserve(other._size);
+			std::uninitialized_copy(other.begin(), other.end(), this->_data);
+			this->_size = other._size;
+		}
+
+		SmallVector(SmallVector &&other) noexcept(std::is_nothrow_move_constructible_v<T>) : SmallVector{}
+		{
+			this->_steal(std::move(other));
+		}
+
+		SmallVector &operator=(const SmallVector &other)
+		{
+			if (this != &other)
+			{
+				this->clear();
+				this->reserve(other._size);
+				std::uninitialized_copy(other.begin(), other.end(), this->_data);
+				this->_size = other._size;
+			}
+			return *this;
+		}
+
+		SmallVector &operator=(SmallVector &&other) noexcept(std::is_nothrow_move_constructible_v<T>)
+		{
+			if (this != &other)
+			{
+				this->clear();
+				this->_release();
+				this->_steal(std::move(other));
+			}
+			return *this;
+		}
+
+		~SmallVector()
+		{
+			this->clear();
+			this->_release();
+		}
+
+		iterator begin() noexcept { return this->_data; }
+		const_iterator begin() const noexcept { return this->_data; }
+		const_iterator cbegin() const noexcept { return this->_data; }
+		iterator end() noexcept { return this->_data + this->_size; }
+		const_iterator end() const noexcept { return this->_data + this->_size; }
+		const_iterator cend() const noexcept { return this->_data + this->_size; }
+		reverse_iterator rbegin() noexcept { return reverse_iterator{this->end()}; }
+		const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator{this->end()}; }
+		reverse_iterator rend() noexcept { return reverse_iterator{this->begin()}; }
+		const_reverse_iterator rend() const noexcept { return const_reverse_iterator{this->begin()}; }
+
+		reference operator[](size_type i) noexcept { return this->_data[i]; }
+		const_reference operator[](size_type i) const noexcept { return this->_data[i]; }
+		reference front() noexcept { return this->_data[0]; }
+		const_reference front() const noexcept { return this->_data[0]; }
+		reference back() noexcept { return this->_data[this->_size - 1]; }
+		const_reference back() const noexcept { return this->_data[this->_size - 1]; }
+		T *data() noexcept { return this->_data; }
+		const T *data() const noexcept { return this->_data; }
+
+		bool empty() const noexcept { return this->_size == 0; }
+		size_type size() const noexcept { return this->_size; }
+		size_type capacity() const noexcept { return this->_capacity; }
+
+		/**
+		 * @brief Check whether the elements are still in the inline storage.
+		 *
+		 * @return the elements are inline or not.
+		 */
+		bool isInline() const noexcept
+		{
+			return this->_data == reinterpret_cast<const T *>(this->_storage);
+		}
+
+		/**
+		 * @brief Make sure the vector can hold at least n elements without
+		 * allocating again.
+		 *
+		 * @param n the number of elements.
+		 */
+		void reserve(size_type n)
+		{
+			if (n <= this->_capacity)
+				return;
+			T *data = std::allocator<T>{}.allocate(n);
+			std::uninitialized_move(this->begin(), this->end(), data);
+			this->_replace(data, n);
+		}
+
+		template <typename... Args>
+		reference emplace_back(Args &&...args)
+		{
+			if (this->_size < this->_capacity)
+				return *::new (static_cast<void *>(this->_data + this->_size++)) T(std::forward<Args>(args)...);
+
+			// construct the new element first, args may refer to an element
+			const size_type capacity = this->_capacity * 2;
+			T *data                  = std::allocator<T>{}.allocate(capacity);
+			::new (static_cast<void *>(data + this->_size)) T(std::forward<Args>(args)...);
+			std::uninitialized_move(this->begin(), this->end(), data);
+			this->_replace(data, capacity);
+			return this->_data[this->_size++];
+		}
+
+		void push_back(const T &value) { this->emplace_back(value); }
+		void push_back(T &&value) { this->emplace_back(std::move(value)); }
+
+		void pop_back() noexcept
+		{
+			std::destroy_at(this->_data + --this->_size);
+		}
+
+		/**
+		 * @brief Remove the elements in [first, last), keeping the order of the rest.
+		 *
+		 * @return iterator following the last removed element.
+		 */
+		iterator erase(const_iterator first, const_iterator last)
+		{
+			iterator begin = this->_data + (first - this->_data);
+			iterator end   = std::move(this->_data + (last - this->_data), this->end(), begin);
+			std::destroy(end, this->end());
+			this->_size = end - this->_data;
+			return begin;
+		}
+
+		iterator erase(const_iterator pos)
+		{
+			return this->erase(pos, pos + 1);
+		}
+
+		void clear() noexcept
+		{
+			std::destroy(this->begin(), this->end());
+			this->_size = 0;
+		}
+
+	private:
+		/**
+		 * @brief Destroy the elements in the current storage and switch to
+		 * new storage that already holds them.
+		 */
+		void _replace(T *data, size_type capacity) noexcept
+		{
+			std::destroy(this->begin(), this->end());
+			this->_release();
+			this->_data     = data;
+			this->_capacity = capacity;
+		}
+
+		/**
+		 * @brief Free the heap storage if any, the elements must be destroyed.
+		 */
+		void _release() noexcept
+		{
+			if (!this->isInline())
+				std::allocator<T>{}.deallocate(this->_data, this->_capacity);
+			this->_data     = reinterpret_cast<T *>(this->_storage);
+			this->_capacity = N;
+		}
+
+		/**
+		 * @brief Take the elements of another vector, this vector must be empty
+		 * and inline.
+		 */
+		void _steal(SmallVector &&other)
+		{
+			if (other.isInline())
+			{
+				std::uninitialized_move(other.begin(), other.end(), this->_data);
+				this->_size = other._size;
+				other.clear();
+				return;
+			}
+
+			this->_data     = other._data;
+			this->_size     = other._size;
+			this->_capacity = other._capacity;
+			other._data     = reinterpret_cast<T *>(other._storage);
+			other._size     = 0;
+			other._capacity = N;
+		}
+
+		alignas(T) unsigned char _storage[sizeof(T) * N];
+		T *_data;
+		size_type _size;
+		size_type _capacity;
+	};
+
+} // namespace phase2
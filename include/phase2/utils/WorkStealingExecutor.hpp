@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace phase2
+{
+
+	/**
+	 * @brief A thread pool for blocking or CPU-heavy tasks, e.g. handlers of
+	 * HttpServer that must not stall an event loop. Every worker owns a deque:
+	 * tasks submitted from a worker go to its own deque, tasks submitted from
+	 * other threads are spread over the deques round-robin, and an idle worker
+	 * steals from the busiest ends of the others. There is no queue shared by
+	 * all workers, only the idle ones touch a common mutex to sleep.
+	 */
+	class WorkStealingExecutor
+	{
+	public:
+		/**
+		 * @brief A task, it must not throw.
+		 */
+		using Task = std::function<void()>;
+
+		/**
+		 * @brief Start the workers.
+		 *
+		 * @param threads the number of workers, 0 for one per hardware thread.
+		 */
+		explicit WorkStealingExecutor(std::size_t threads = 0);
+
+		WorkStealingExecutor(const WorkStealingExecutor &)            = delete;
+		WorkStealingExecutor &operator=(const WorkStealingExecutor &) = delete;
+
+		/**
+		 * @brief Run the submitted tasks and stop the workers.
+		 */
+		~WorkStealingExecutor();
+
+		/**
+		 * @brief Submit a task, safe to call from any thread.
+		 *
+		 * @param task the task.
+		 */
+		void submit(Task task);
+
+		/**
+		 * @brief Get the number of workers.
+		 */
+		std::size_t threads() const noexcept;
+
+		/**
+		 * @brief Get the number of tasks waiting for a worker.
+		 */
+		std::size_t pending() const noexcept;
+
+		/**
+		 * @brief Get the number of tasks waiting in the deque of a worker.
+		 *
+		 * @param worker the index of the worker, less than threads().
+		 */
+		std::size_t pending(std::size_t worker) const noexcept;
+
+		/**
+		 * @brief Get the number of tasks a worker took from another's deque.
+		 */
+		std::uint64_t steals() const noexcept;
+
+		/**
+		 * @brief Get the number of tasks run so far.
+		 */
+		std::uint64_t executed() const noexcept;
+
+	private:
+		struct _Worker
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+			std::atomic<std::size_t> depth;
+			std::thread thread;
+		};
+
+		void _run(std::size_t index);
+
+		/**
+		 * @brief Take the oldest task of a worker, or steal the newest task of
+		 * another one.
+		 *
+		 * @return a task is taken or not.
+		 */
+		bool _take(std::size_t index, Task &task);
+
+		std::vector<std::unique_ptr<_Worker>> _workers;
+		std::atomic<std::size_t> _pending;
+		std::atomic<std::uint64_t> _steals;
+		std::atomic<std::uint64_t> _executed;
+		std::atomic<std::size_t> _sleepers;
+		std::atomic<bool> _stopping;
+		std::mutex _idle_mutex;
+		std::condition_variable _idle_cv;
+	};
+
+} // namespace phase2
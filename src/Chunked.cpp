@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include <phase2/Chunked.hpp>
+#include <phase2/HttpParser.hpp>
+#include <phase2/utils/HeaderMap.hpp>
+#include <phase2/utils/Log.hpp>
+#include <phase2/utils/Scan.hpp>
+
+namespace phase2
+{
+
+	/**
+	 * @brief Split a header field line, defined in Http.cpp.
+	 */
+	bool _split_field(std::string_view line, std::string_view &field, std::string_view &value) noexcept;
+
+	/**
+	 * @brief Convert a hexadecimal digit of a chunk size.
+	 *
+	 * @return the value, or -1 if c is not a hexadecimal digit.
+	 */
+	inline int _chunk_digit(char c) noexcept
+	{
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		c = static_cast<char>(c | 0x20);
+		if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		return -1;
+	}
+
+	ChunkedDecoder::ChunkedDecoder(std::size_t max_line) noexcept
+		: _trailers{}, _line{}, _remaining{0}, _size{0}, _line_size{0}, _max_line{max_line},
+		  _state{_State::SIZE}, _has_digit{false} {}
+
+	ParseStatus ChunkedDecoder::decode(std::string_view &input, std::string_view &data)
+	{
+		data = {};
+		while (!input.empty())
+		{
+			switch (this->_state)
+			{
+			case _State::SIZE:
+			{
+				const char c    = input.front();
+				const int digit = _chunk_digit(c);
+				if (digit < 0)
+				{
+					// the size is followed by extensions, optional whitespace or CRLF
+					if (!this->_has_digit || (c != ';' && c != ' ' && c != '\t' && c != '\r'))
+						return this->_fail("invalid chunk size");
+					this->_state = _State::EXTENSION;
+					break;
+				}
+				if ((this->_remaining >> 60) != 0)
+					return this->_fail("chunk size too big");
+				// leading zeros never grow the size, only the line
+				if (++this->_line_size > this->_max_line)
+					return this->_fail("chunk size line too long");
+				this->_remaining = this->_remaining << 4 | static_cast<std::uint64_t>(digit);
+				this->_has_digit = true;
+				input.remove_prefix(1);
+				break;
+			}
+			case _State::EXTENSION:
+			{
+				// extensions are skipped, they end at the first control character
+				const char *ctl        = phase2::find_ctl(input.data(), input.data() + input.size());
+				const std::size_t size = static_cast<std::size_t>(ctl - input.data());
+				this->_line_size += size;
+				if (this->_line_size > this->_max_line)
+					return this->_fail("chunk size line too long");
+				input.remove_prefix(size);
+				if (input.empty())
+					break;
+				if (input.front() != '\r')
+					return this->_fail("control character in chunk extension");
+				input.remove_prefix(1);
+				this->_state = _State::SIZE_LF;
+				break;
+			}
+			case _State::SIZE_LF:
+				if (input.front() != '\n')
+					return this->_fail("chunk size line is not terminated by CRLF");
+				input.remove_prefix(1);
+				this->_line_size = 0;
+				this->_has_digit = false;
+				this->_state     = this->_remaining == 0 ? _State::TRAILER : _State::DATA;
+				break;
+			case _State::DATA:
+			{
+				const std::size_t size =
+					static_cast<std::size_t>(std::min<std::uint64_t>(this->_remaining, input.size()));
+				data = input.substr(0, size);
+				input.remove_prefix(size);
+				this->_remaining -= size;
+				this->_size += size;
+				if (this->_remaining == 0)
+					this->_state = _State::DATA_CR;
+				return ParseStatus::NEED_MORE;
+			}
+			case _State::DATA_CR:
+				if (input.front() != '\r')
+					return this->_fail("chunk data is not followed by CRLF");
+				input.remove_prefix(1);
+				this->_state = _State::DATA_LF;
+				break;
+			case _State::DATA_LF:
+				if (input.front() != '\n')
+					return this->_fail("chunk data is not followed by CRLF");
+				input.remove_prefix(1);
+				this->_state = _State::SIZE;
+				break;
+			case _State::TRAILER:
+			{
+				const std::size_t lf   = input.find('\n');
+				const std::size_t size = lf == input.npos ? input.size() : lf + 1;
+				if (this->_line.size() + size > this->_max_line + 2)
+					return this->_fail("trailer field too long");
+				if (lf == input.npos)
+				{
+					this->_line.append(input);
+					input = {};
+					break;
+				}
+
+				ParseStatus status;
+				if (this->_line.empty())
+					status = this->_parseTrailer(input.substr(0, size));
+				else
+				{
+					this->_line.append(input.substr(0, size));
+					status = this->_parseTrailer(this->_line);
+					this->_line.clear();
+				}
+				input.remove_prefix(size);
+				if (status != ParseStatus::NEED_MORE)
+					return status;
+				break;
+			}
+			case _State::DONE:
+				return ParseStatus::DONE;
+			case _State::ERROR:
+				return ParseStatus::ERROR;
+			}
+		}
+
+		if (this->_state == _State::DONE)
+			return ParseStatus::DONE;
+		return this->_state == _State::ERROR ? ParseStatus::ERROR : ParseStatus::NEED_MORE;
+	}
+
+	const HeaderMap &ChunkedDecoder::trailers() const noexcept
+	{
+		return this->_trailers;
+	}
+
+	std::uint64_t ChunkedDecoder::size() const noexcept
+	{
+		return this->_size;
+	}
+
+	void ChunkedDecoder::reset() noexcept
+	{
+		this->_trailers.clear();
+		this->_line.clear();
+		this->_remaining = 0;
+		this->_size      = 0;
+		this->_line_size = 0;
+		this->_state     = _State::SIZE;
+		this->_has_digit = false;
+	}
+
+	ParseStatus ChunkedDecoder::_fail(std::string_view reason)
+	{
+		PHASE2_LOG(DEBUG, HTTP) << "ChunkedDecoder: " << reason;
+		this->_state = _State::ERROR;
+		return ParseStatus::ERROR;
+	}
+
+	ParseStatus ChunkedDecoder::_parseTrailer(std::string_view line)
+	{
+		if (line.size() < 2 || line[line.size() - 2] != '\r')
+			return this->_fail("trailer field is not terminated by CRLF");
+		line.remove_suffix(2);
+		if (line.empty())
+		{
+			this->_state = _State::DONE;
+			return ParseStatus::DONE;
+		}
+
+		std::string_view field, value;
+		if (!_split_field(line, field, value) ||
+			phase2::find_ctl(value.data(), value.data() + value.size()) != value.data() + value.size())
+			return this->_fail("invalid trailer field");
+		this->_trailers.add(field, value);
+		return ParseStatus::NEED_MORE;
+	}
+
+	ChunkedEncoder::ChunkedEncoder() : _lines{}, _open{false} {}
+
+	void ChunkedEncoder::encode(std::string_view data, std::vector<iovec> &iov)
+	{
+		if (data.empty())
+			return;
+
+		// the CRLF closing the previous chunk shares the segment of this size line
+		std::array<char, 24> &line = this->_lines.emplace_back();
+		char *pos                  = line.data();
+		if (this->_open)
+		{
+			*pos++ = '\r';
+			*pos++ = '\n';
+		}
+		pos         = std::to_chars(pos, line.data() + line.size() - 2, data.size(), 16).ptr;
+		*pos++      = '\r';
+		*pos++      = '\n';
+		this->_open = true;
+
+		const std::size_t n = iov.size();
+		iov.resize(n + 2);
+		iov[n]     = iovec{line.data(), static_cast<std::size_t>(pos - line.data())};
+		iov[n + 1] = iovec{const_cast<char *>(data.data()), data.size()};
+	}
+
+	void ChunkedEncoder::finish(std::vector<iovec> &iov, const HeaderMap &trailers)
+	{
+		const std::string_view last = this->_open ? std::string_view{"\r\n0\r\n"} : std::string_view{"0\r\n"};
+		this->_open                 = false;
+
+		std::size_t n = iov.size();
+		iov.resize(n + 2 + trailers.size() * 4);
+		iov[n++] = iovec{const_cast<char *>(last.data()), last.size()};
+		for (const auto &pair : trailers)
+		{
+			iov[n++] = iovec{const_cast<char *>(pair.field.data()), pair.field.size()};
+			iov[n++] = iovec{const_cast<char *>(": "), 2};
+			iov[n++] = iovec{const_cast<char *>(pair.value.data()), pair.value.size()};
+			iov[n++] = iovec{const_cast<char *>("\r\n"), 2};
+		}
+		iov[n] = iovec{const_cast<char *>("\r\n"), 2};
+	}
+
+	void ChunkedEncoder::clear() noexcept
+	{
+		this->_lines.clear();
+	}
+
+} // namespace phase2
@@ -1,3 +1,4 @@
+#include <array>
 #include <cctype>
 #include <charconv>
 #include <cstdint>
@@ -12,57 +13,293 @@
 #include <string_view>
 #include <vector>
 
-#ifndef NDEBUG
-#include <phase2/utils/Log.hpp>
-#endif
+#include <sys/uio.h>
 
 #include <phase2/Http.hpp>
+#include <phase2/utils/Log.hpp>
+#include <phase2/utils/Scan.hpp>
 
 namespace phase2
 {
 
 	HttpHeader::HttpHeader() noexcept : _Headers{}, _version{-1, -1}, _valid{false} {}
 
-	HttpHeader::HttpHeader(std::string_view str, std::optional<std::reference_wrapper<std::size_t>> body_start) noexcept
-		: _version{-1, -1}
+	/**
+	 * @brief Check whether the bytes at pos are CRLF.
+	 */
+	inline bool _is_crlf(const char *pos, const char *end) noexcept
 	{
-		const std::string_view::size_type header_end = str.find("\r\n\r\n");
-		if (header_end == str.npos)
+		return end - pos >= 2 && pos[0] == '\r' && pos[1] == '\n';
+	}
+
+	/**
+	 * @brief Split a header block into lines. Each line is found with a single
+	 * find_ctl pass, which also rejects control characters inside the lines.
+	 *
+	 * @param str the string starting with the start line.
+	 * @param start_line stores the start line without the trailing CRLF.
+	 * @param body_start stores where the body starts.
+	 * @param on_field called with every header field line, returns false to stop.
+	 * @return the header block is complete and valid or not.
+	 */
+	template <typename FieldHandler>
+	bool _split_header(std::string_view str, std::string_view &start_line, std::size_t &body_start,
+					   FieldHandler &&on_field)
+	{
+		const char *const end = str.data() + str.size();
+		const char *line      = str.data();
+		const char *line_end  = phase2::find_ctl(line, end);
+		if (!_is_crlf(line_end, end))
+			return false;
+		start_line = std::string_view{line, static_cast<std::size_t>(line_end - line)};
+
+		while (true)
 		{
-			this->_valid = false;
-			return;
+			line     = line_end + 2;
+			line_end = phase2::find_ctl(line, end);
+			if (!_is_crlf(line_end, end))
+				return false;
+			if (line_end == line)
+				break;
+			if (!on_field(std::string_view{line, static_cast<std::size_t>(line_end - line)}))
+				return false;
 		}
-		if (body_start)
-			body_start->get() = header_end + 4;
-		str.remove_suffix(str.size() - header_end - 2);
 
-		const std::string_view::size_type firstline_end = str.find("\r\n");
-		if (firstline_end == str.npos)
+		body_start = line_end + 2 - str.data();
+		return true;
+	}
+
+	/**
+	 * @brief Check whether a HTTP version pair is valid.
+	 */
+	inline bool _is_valid_version(const std::pair<int, int> &version) noexcept
+	{
+		return (version.first > 0 && version.second >= 0) || (version.first == 0 && version.second > 0);
+	}
+
+	/**
+	 * @brief Make an iovec segment pointing at a string.
+	 */
+	inline iovec _to_iov(std::string_view str) noexcept
+	{
+		return iovec{const_cast<char *>(str.data()), str.size()};
+	}
+
+	/**
+	 * @brief Grow an iovec list and get the first new segment, writing the
+	 * segments in place is much cheaper than a push_back for each one.
+	 */
+	inline iovec *_extend_iov(std::vector<iovec> &iov, std::size_t n)
+	{
+		const std::size_t size = iov.size();
+		iov.resize(size + n);
+		return iov.data() + size;
+	}
+
+	constexpr std::array<std::array<char, 8>, 100> _make_version_strings() noexcept
+	{
+		std::array<std::array<char, 8>, 100> strings{};
+		for (std::size_t i = 0; i < strings.size(); ++i)
+			strings[i] = {'H', 'T', 'T', 'P', '/', static_cast<char>('0' + i / 10), '.', static_cast<char>('0' + i % 10)};
+		return strings;
+	}
+
+	constexpr std::array<std::array<char, 5>, 1000> _make_status_code_strings() noexcept
+	{
+		std::array<std::array<char, 5>, 1000> strings{};
+		for (std::size_t i = 0; i < strings.size(); ++i)
+			strings[i] = {' ', static_cast<char>('0' + i / 100), static_cast<char>('0' + i / 10 % 10),
+						  static_cast<char>('0' + i % 10), ' '};
+		return strings;
+	}
+
+	/**
+	 * @brief "HTTP/x.y" of every single-digit version, indexed by x * 10 + y.
+	 */
+	constexpr std::array<std::array<char, 8>, 100> _VERSION_STRINGS = _make_version_strings();
+
+	/**
+	 * @brief " xyz " of every status code, so a status line needs no formatting.
+	 */
+	constexpr std::array<std::array<char, 5>, 1000> _STATUS_CODE_STRINGS = _make_status_code_strings();
+
+	/**
+	 * @brief Get the static string of a HTTP version.
+	 *
+	 * @param version the version pair.
+	 * @param str stores the string.
+	 * @return the version has a static string or not.
+	 */
+	bool _version_string(const std::pair<int, int> &version, std::string_view &str) noexcept
+	{
+		if (version.first < 0 || version.first > 9 || version.second < 0 || version.second > 9)
 		{
-			this->_valid = false;
-			return;
+			PHASE2_LOG(DEBUG, HTTP) << "serialize: HTTP version " << version.first << '.' << version.second
+									<< " cannot be serialized";
+			return false;
+		}
+		const auto &chars = _VERSION_STRINGS[version.first * 10 + version.second];
+		str               = std::string_view{chars.data(), chars.size()};
+		return true;
+	}
+
+	/**
+	 * @brief Split a header field line into the field name and the value
+	 * without the surrounding whitespaces.
+	 *
+	 * @param line the line without the trailing CRLF.
+	 * @param field stores the field name.
+	 * @param value stores the value.
+	 * @return the line is a valid header field or not.
+	 */
+	bool _split_field(std::string_view line, std::string_view &field, std::string_view &value) noexcept
+	{
+		const char *const end = line.data() + line.size();
+		const char *colon     = phase2::find_non_token(line.data(), end);
+		if (colon == line.data() || colon == end || *colon != ':')
+		{
+			PHASE2_LOG(DEBUG, HTTP) << "invalid HTTP header: field name is not followed by a colon";
+			return false;
+		}
+
+		const char *value_begin = colon + 1;
+		const char *value_end   = end;
+		while (value_begin != value_end && (*value_begin == ' ' || *value_begin == '\t'))
+			++value_begin;
+		while (value_begin != value_end && (value_end[-1] == ' ' || value_end[-1] == '\t'))
+			--value_end;
+
+		field = std::string_view{line.data(), static_cast<std::size_t>(colon - line.data())};
+		value = std::string_view{value_begin, static_cast<std::size_t>(value_end - value_begin)};
+		return true;
+	}
+
+	/**
+	 * @brief Split a request line, e.g. "GET / HTTP/1.1".
+	 *
+	 * @param line the line without the trailing CRLF.
+	 * @param type stores the request type.
+	 * @param target stores the request target.
+	 * @param version stores the HTTP version.
+	 * @return the request line is valid or not.
+	 */
+	bool _split_request_line(std::string_view line, HttpRequestHeader::RequestType &type,
+							 std::string_view &target, std::pair<int, int> &version) noexcept
+	{
+		const char *method_end = phase2::find_non_token(line.data(), line.data() + line.size());
+		if (method_end == line.data() + line.size() || *method_end != ' ')
+		{
+			PHASE2_LOG(DEBUG, HTTP) << "invalid HTTP request: cannot find request type";
+			return false;
+		}
+		std::string_view::size_type first_space = method_end - line.data();
+		type                                    = phase2::to_type(line.substr(0, first_space));
+		if (type == HttpRequestHeader::RequestType::UNKNOWN)
+		{
+			PHASE2_LOG(DEBUG, HTTP) << "invalid HTTP request: unknown request type";
+			return false;
+		}
+		line.remove_prefix(first_space + 1);
+
+		std::string_view::size_type second_space = line.find(' ');
+		if (second_space == line.npos)
+		{
+			PHASE2_LOG(DEBUG, HTTP) << "invalid HTTP request: cannot find url";
+			return false;
+		}
+		target = line.substr(0, second_space);
+		line.remove_prefix(second_space + 1);
+
+		version = phase2::to_version(line);
+		if (!_is_valid_version(version))
+		{
+			PHASE2_LOG(DEBUG, HTTP) << "invalid HTTP request: invalid HTTP version";
+			return false;
 		}
-		str.remove_prefix(firstline_end + 2);
 
-		std::string_view::size_type line_end;
-		while ((line_end = str.find("\r\n")) != str.npos)
+		return true;
+	}
+
+	/**
+	 * @brief Split a status line, e.g. "HTTP/1.1 200 OK".
+	 *
+	 * @param line the line without the trailing CRLF.
+	 * @param version stores the HTTP version.
+	 * @param status stores the status code.
+	 * @return the status line is valid or not.
+	 */
+	bool _split_status_line(std::string_view line, std::pair<int, int> &version,
+							HttpResponseHeader::StatusCode &status) noexcept
+	{
+		std::string_view::size_type first_space = line.find(' ');
+		if (first_space == line.npos)
+		{
+			PHASE2_LOG(DEBUG, HTTP) << "invalid HTTP response: cannot find HTTP version";
+			return false;
+		}
+		version = phase2::to_version(line.substr(0, first_space));
+		if (!_is_valid_version(version))
+		{
+			PHASE2_LOG(DEBUG, HTTP) << "invalid HTTP response: invalid HTTP version";
+			return false;
+		}
+		line.remove_prefix(first_space + 1);
+
+		std::string_view::size_type second_space = line.find(' ');
+		if (second_space == line.npos)
+		{
+			PHASE2_LOG(DEBUG, HTTP) << "invalid HTTP response: cannot find status code";
+			return false;
+		}
+
+		// the common three-digit code is converted directly
+		unsigned short code{0};
+		const unsigned int hundreds = static_cast<unsigned char>(line[0]) - '0';
+		const unsigned int tens     = second_space == 3 ? static_cast<unsigned char>(line[1]) - '0' : 10;
+		const unsigned int ones     = second_space == 3 ? static_cast<unsigned char>(line[2]) - '0' : 10;
+		if (hundreds - 1 < 9 && tens < 10 && ones < 10)
+		{
+			status = static_cast<HttpResponseHeader::StatusCode>(hundreds * 100 + tens * 10 + ones);
+			return true;
+		}
+
+		std::from_chars_result result = std::from_chars(line.begin(), line.begin() + second_space, code);
+		if (result.ec == std::errc::result_out_of_range)
+		{
+			PHASE2_LOG(DEBUG, HTTP) << "invalid HTTP response: status code too big";
+			return false;
+		}
+		if (result.ec != std::errc{} || result.ptr != line.begin() + second_space || code == 0)
 		{
-			std::string_view line             = {str.begin(), line_end};
-			std::string_view::size_type colon = line.find(':');
-			if (colon == line.npos)
-			{
-				this->_valid = false;
-				return;
-			}
-			std::string_view::size_type value_begin = line.find_first_not_of(" \t", colon + 1);
-			std::string_view::size_type value_end   = line.find_last_not_of(" \t");
-			std::string field{line.begin(), colon};
-			this->_Headers.emplace(field, std::list<std::string>());
-			this->_Headers.at(field).emplace_back(line.substr(value_begin, value_end));
-			str.remove_prefix(line_end + 2);
+			PHASE2_LOG(DEBUG, HTTP) << "invalid HTTP response: invalid status code";
+			return false;
 		}
+		status = static_cast<HttpResponseHeader::StatusCode>(code);
 
-		this->_valid = true;
+		return true;
+	}
+
+	/**
+	 * @brief Collect the values of a field.
+	 *
+	 * @param headers the header map.
+	 * @param key the field name or the header ID.
+	 * @return the values in order.
+	 */
+	template <typename Container, typename Map, typename Key>
+	Container _get_values(const Map &headers, const Key &key)
+	{
+		Container values;
+		for (auto it = headers.find(key); it != headers.end(); it = headers.find(key, it + 1))
+			values.emplace_back(it->value);
+		return values;
+	}
+
+	HttpHeader::HttpHeader(std::string_view str, std::optional<std::reference_wrapper<std::size_t>> body_start) noexcept
+		: _version{-1, -1}
+	{
+		std::string_view start_line;
+		this->_parseHeader(str, body_start, start_line);
 	}
 
 	HttpHeader::HttpHeader(const std::vector<std::uint8_t> &buf,
@@ -73,25 +310,53 @@ namespace phase2
 						   std::optional<std::reference_wrapper<std::size_t>> body_start) noexcept
 		: HttpHeader{std::string_view{reinterpret_cast<const char *>(buf), size}, body_start} {}
 
+	bool HttpHeader::_parseHeader(std::string_view str, std::optional<std::reference_wrapper<std::size_t>> body_start,
+								  std::string_view &start_line)
+	{
+		std::size_t header_size;
+		this->_valid = _split_header(str, start_line, header_size,
+									 [this](std::string_view line) { return this->_parseField(line); });
+		if (this->_valid && body_start)
+			body_start->get() = header_size;
+		return this->_valid;
+	}
+
+	bool HttpHeader::_parseField(std::string_view line)
+	{
+		std::string_view field, value;
+		if (!_split_field(line, field, value))
+			return false;
+		this->addHeader(field, value);
+		return true;
+	}
+
 	void HttpHeader::addHeader(std::string_view field, std::string_view value)
 	{
-		std::string field_str{field};
-		this->_Headers.emplace(field_str, std::list<std::string>());
-		this->_Headers.at(field_str).emplace_back(value);
+		this->_Headers.add(field, value);
+	}
+
+	void HttpHeader::addHeader(HeaderId id, std::string_view value)
+	{
+		this->_Headers.add(id, value);
 	}
 
 	std::list<std::string> HttpHeader::getHeader(std::string_view field) const
 	{
-		std::string field_str{field};
-		if (this->_Headers.find(field_str) == this->_Headers.end())
-		{
-#ifndef NDEBUG
-			log_debug << "field " << field << "not found, return empty list";
-#endif
-			return {};
-		}
+		std::list<std::string> values = _get_values<std::list<std::string>>(this->_Headers, field);
+		if (values.empty())
+			PHASE2_LOG(DEBUG, HTTP) << "field " << field << " not found, return empty list";
 
-		return this->_Headers.at(field_str);
+		return values;
+	}
+
+	std::list<std::string> HttpHeader::getHeader(HeaderId id) const
+	{
+		return _get_values<std::list<std::string>>(this->_Headers, id);
+	}
+
+	const HeaderMap &HttpHeader::getHeaders() const noexcept
+	{
+		return this->_Headers;
 	}
 
 	HttpHeader::HttpVersionType HttpHeader::getHttpVersion() const noexcept
@@ -106,7 +371,12 @@ namespace phase2
 
 	void HttpHeader::removeHeader(std::string_view field) noexcept
 	{
-		this->_Headers.erase(std::string{field});
+		this->_Headers.erase(field);
+	}
+
+	void HttpHeader::removeHeader(HeaderId id) noexcept
+	{
+		this->_Headers.erase(id);
 	}
 
 	void HttpHeader::setHttpVersion(const HttpHeader::HttpVersionType &version) noexcept
@@ -117,43 +387,49 @@ namespace phase2
 	void HttpHeader::setHttpVersion(HttpHeader::HttpVersionType &&version) noexcept
 	{
 		this->_version = std::move(version);
-		if ((version.first > 0 && version.second >= 0) ||
-			(version.first == 0 && version.second > 0))
-			this->_valid = true;
-		else
-			this->_valid = false;
+		this->_valid   = _is_valid_version(this->_version);
 	}
 
 	void HttpHeader::setHttpVersion(int major, int minor) noexcept
 	{
 		this->_version.first  = major;
 		this->_version.second = minor;
-		if ((major > 0 && minor >= 0) || (major == 0 && minor > 0))
-			this->_valid = true;
-		else
-			this->_valid = false;
+		this->_valid          = _is_valid_version(this->_version);
 	}
 
 	HttpHeader::BufferType HttpHeader::serialize() const
+	{
+		std::vector<iovec> iov;
+		if (!this->serialize(iov))
+			return HttpHeader::BufferType();
+
+		std::size_t size = 0;
+		for (const iovec &segment : iov)
+			size += segment.iov_len;
+		BufferType buf(size);
+		std::uint8_t *out = buf.data();
+		for (const iovec &segment : iov)
+		{
+			std::memcpy(out, segment.iov_base, segment.iov_len);
+			out += segment.iov_len;
+		}
+		return buf;
+	}
+
+	bool HttpHeader::serialize(std::vector<iovec> &iov) const
 	{
 		if (!*this)
-			return HttpRequestHeader::BufferType();
-		BufferType buf;
-		buf.reserve(256);
+			return false;
+		iovec *out = _extend_iov(iov, this->_Headers.size() * 4 + 1);
 		for (const auto &pair : this->_Headers)
-			for (std::string_view value : pair.second)
-			{
-				buf.insert(buf.end(), pair.first.cbegin(), pair.first.cend());
-				buf.push_back(':');
-				buf.push_back(' ');
-				buf.insert(buf.end(), value.begin(), value.end());
-				buf.push_back('\r');
-				buf.push_back('\n');
-			}
-		buf.push_back('\r');
-		buf.push_back('\n');
-
-		return buf;
+		{
+			*out++ = _to_iov(pair.field);
+			*out++ = _to_iov(": ");
+			*out++ = _to_iov(pair.value);
+			*out++ = _to_iov("\r\n");
+		}
+		*out = _to_iov("\r\n");
+		return true;
 	}
 
 	HttpHeader::operator bool() const noexcept
@@ -178,54 +454,13 @@ namespace phase2
 
 	HttpRequestHeader::HttpRequestHeader(std::string_view str,
 										 std::optional<std::reference_wrapper<std::size_t>> body_start) noexcept
-		: HttpHeader{str, body_start}
+		: HttpHeader{}, _type{HttpRequestHeader::RequestType::UNKNOWN}
 	{
-		std::string_view::size_type firstline_end = str.find("\r\n");
-		if (firstline_end == str.npos)
-		{
-#ifndef NDEBUG
-			log_debug << "invalid HTTP request: cannot find \\r\\n";
-#endif
-			this->_valid = false;
-			return;
-		}
-		str.remove_suffix(str.size() - firstline_end);
-
-		std::string_view::size_type first_space = str.find(' ');
-		if (first_space == str.npos)
-		{
-#ifndef NDEBUG
-			log_debug << "invalid HTTP request: cannot find request type";
-#endif
-			this->_valid = false;
-			return;
-		}
-		this->_type = phase2::to_type(str.substr(0, first_space));
-		if (this->_type == HttpRequestHeader::RequestType::UNKNOWN)
-		{
-#ifndef NDEBUG
-			log_debug << "invalid HTTP request: unknown request type";
-#endif
-			this->_valid = false;
+		std::string_view start_line;
+		if (!this->_parseHeader(str, body_start, start_line))
 			return;
-		}
-		str.remove_prefix(first_space + 1);
-
-		std::string_view::size_type second_space = str.find(' ');
-		if (second_space == str.npos)
-		{
-#ifndef NDEBUG
-			log_debug << "invalid HTTP request: cannot find url";
-#endif
-			this->_valid = false;
-			return;
-		}
-		this->setUrl(str.substr(0, second_space));
-		str.remove_prefix(second_space + 1);
-
-		this->setHttpVersion(phase2::to_version(str));
 
-		this->_valid = true;
+		this->_valid = this->_parseStartLine(start_line);
 	}
 
 	HttpRequestHeader::HttpRequestHeader(const BufferType &buf,
@@ -236,12 +471,21 @@ namespace phase2
 										 std::optional<std::reference_wrapper<std::size_t>> body_start) noexcept
 		: HttpRequestHeader{std::string_view{reinterpret_cast<const char *>(buf), size}, body_start} {}
 
+	bool HttpRequestHeader::_parseStartLine(std::string_view line)
+	{
+		std::string_view target;
+		if (!_split_request_line(line, this->_type, target, this->_version))
+			return false;
+		this->setUrl(target);
+		return true;
+	}
+
 	HttpRequestHeader::RequestType HttpRequestHeader::getType() const noexcept
 	{
 		return this->_type;
 	}
 
-	Url HttpRequestHeader::getUrl() const noexcept
+	const Url &HttpRequestHeader::getUrl() const noexcept
 	{
 		return this->_url;
 	}
@@ -265,23 +509,20 @@ namespace phase2
 		return os << req.serialize();
 	}
 
-	HttpRequestHeader::BufferType HttpRequestHeader::serialize() const
+	bool HttpRequestHeader::serialize(std::vector<iovec> &iov) const
 	{
-		if (!*this)
-			return HttpRequestHeader::BufferType();
-		std::string str{phase2::to_string(this->_type)};
-		str += ' ';
-		str += this->_url.string();
-		str += ' ';
-		str += phase2::to_string(this->_version);
-		str += "\r\n";
-
-		HttpRequestHeader::BufferType buf;
-		buf.reserve(512);
-		buf.insert(buf.end(), str.cbegin(), str.cend());
-		HttpRequestHeader::BufferType &&buf2 = HttpHeader::serialize();
-		buf.insert(buf.end(), buf2.cbegin(), buf2.cend());
-		return buf;
+		std::string_view version;
+		if (!*this || !_version_string(this->_version, version))
+			return false;
+
+		iov.push_back(_to_iov(phase2::to_string(this->_type)));
+		iov.push_back(_to_iov(" "));
+		this->_url.serialize(iov);
+		iovec *out = _extend_iov(iov, 3);
+		out[0]     = _to_iov(" ");
+		out[1]     = _to_iov(version);
+		out[2]     = _to_iov("\r\n");
+		return HttpHeader::serialize(iov);
 	}
 
 	HttpResponseHeader::HttpResponseHeader() noexcept
@@ -289,62 +530,13 @@ namespace phase2
 
 	HttpResponseHeader::HttpResponseHeader(std::string_view str,
 										   std::optional<std::reference_wrapper<std::size_t>> body_start) noexcept
-		: HttpHeader{str, body_start}
+		: HttpHeader{}, _status{HttpResponseHeader::StatusCode::unknown}
 	{
-		std::string_view::size_type firstline_end = str.find("\r\n");
-		if (firstline_end == str.npos)
-		{
-#ifndef NDEBUG
-			log_debug << "invalid HTTP request: cannot find \\r\\n";
-#endif
-			this->_valid = false;
-			return;
-		}
-		str.remove_suffix(str.size() - firstline_end);
-
-		std::string_view::size_type first_space = str.find(' ');
-		if (first_space == str.npos)
-		{
-#ifndef NDEBUG
-			log_debug << "invalid HTTP response: cannot find HTTP version";
-#endif
-			this->_valid = false;
-			return;
-		}
-		this->setHttpVersion(phase2::to_version(str.substr(0, first_space)));
-		str.remove_prefix(first_space + 1);
-
-		std::string_view::size_type second_space = str.find(' ');
-		if (second_space == str.npos)
-		{
-#ifndef NDEBUG
-			log_debug << "invalid HTTP response: cannot find status code";
-#endif
-			this->_valid = false;
+		std::string_view start_line;
+		if (!this->_parseHeader(str, body_start, start_line))
 			return;
-		}
 
-		unsigned short status;
-		std::from_chars_result result = std::from_chars(str.begin(), str.begin() + second_space, status);
-		if (result.ec == std::errc::result_out_of_range)
-		{
-#ifndef NDEBUG
-			log_debug << "invalid HTTP response: status code too big";
-#endif
-			this->_valid = false;
-			return;
-		}
-		if (result.ptr != str.begin() + second_space)
-		{
-#ifndef NDEBUG
-			log_debug << "invalid HTTP response: invalid status code";
-#endif
-			this->_valid = false;
-			return;
-		}
-		this->setStatus(static_cast<HttpResponseHeader::StatusCode>(status));
-
-		this->_valid = true;
+		this->_valid = this->_parseStartLine(start_line);
 	}
 
 	HttpResponseHeader::HttpResponseHeader(const BufferType &buf,
@@ -355,6 +547,11 @@ namespace phase2
 										   std::optional<std::reference_wrapper<std::size_t>> body_start) noexcept
 		: HttpResponseHeader{std::string_view{reinterpret_cast<const char *>(buf), size}, body_start} {}
 
+	bool HttpResponseHeader::_parseStartLine(std::string_view line)
+	{
+		return _split_status_line(line, this->_version, this->_status);
+	}
+
 	HttpResponseHeader::StatusCode HttpResponseHeader::getStatus() const noexcept
 	{
 		return this->_status;
@@ -369,23 +566,19 @@ namespace phase2
 			this->_valid = true;
 	}
 
-	HttpResponseHeader::BufferType HttpResponseHeader::serialize() const
+	bool HttpResponseHeader::serialize(std::vector<iovec> &iov) const
 	{
-		if (!*this)
-			return HttpRequestHeader::BufferType();
-		std::string str = phase2::to_string(this->_version);
-		str += ' ';
-		str += std::to_string(static_cast<int>(this->getStatus()));
-		str += ' ';
-		str += phase2::to_string(this->getStatus());
-		str += "\r\n";
-
-		HttpResponseHeader::BufferType buf;
-		buf.reserve(512);
-		buf.insert(buf.end(), str.cbegin(), str.cend());
-		HttpResponseHeader::BufferType &&buf2 = HttpHeader::serialize();
-		buf.insert(buf.end(), buf2.cbegin(), buf2.cend());
-		return buf;
+		std::string_view version;
+		const std::size_t code = static_cast<std::size_t>(this->_status);
+		if (!*this || code >= _STATUS_CODE_STRINGS.size() || !_version_string(this->_version, version))
+			return false;
+
+		iovec *out = _extend_iov(iov, 4);
+		out[0]     = _to_iov(version);
+		out[1]     = iovec{const_cast<char *>(_STATUS_CODE_STRINGS[code].data()), _STATUS_CODE_STRINGS[code].size()};
+		out[2]     = _to_iov(phase2::to_string(this->_status));
+		out[3]     = _to_iov("\r\n");
+		return HttpHeader::serialize(iov);
 	}
 
 	std::ostream &operator<<(std::ostream &os, const HttpResponseHeader &res)
@@ -393,6 +586,148 @@ namespace phase2
 		return os << res.serialize();
 	}
 
+	HttpHeaderView::HttpHeaderView() noexcept : _headers{}, _version{-1, -1}, _valid{false} {}
+
+	HttpHeaderView::HttpHeaderView(std::string_view str,
+								   std::optional<std::reference_wrapper<std::size_t>> body_start) noexcept
+		: _version{-1, -1}
+	{
+		std::string_view start_line;
+		this->_parseHeader(str, body_start, start_line);
+	}
+
+	bool HttpHeaderView::_parseHeader(std::string_view str,
+									  std::optional<std::reference_wrapper<std::size_t>> body_start,
+									  std::string_view &start_line)
+	{
+		std::size_t header_size;
+		this->_valid = _split_header(str, start_line, header_size,
+									 [this](std::string_view line)
+									 {
+										 std::string_view field, value;
+										 if (!_split_field(line, field, value))
+											 return false;
+										 this->_headers.add(field, value);
+										 return true;
+									 });
+		if (this->_valid && body_start)
+			body_start->get() = header_size;
+		return this->_valid;
+	}
+
+	void HttpHeaderView::_copyTo(HttpHeader &header) const
+	{
+		for (const auto &pair : this->_headers)
+			header.addHeader(pair.field, pair.value);
+		header.setHttpVersion(this->_version);
+	}
+
+	std::vector<std::string_view> HttpHeaderView::getHeader(std::string_view field) const
+	{
+		return _get_values<std::vector<std::string_view>>(this->_headers, field);
+	}
+
+	std::vector<std::string_view> HttpHeaderView::getHeader(HeaderId id) const
+	{
+		return _get_values<std::vector<std::string_view>>(this->_headers, id);
+	}
+
+	const HeaderViewMap &HttpHeaderView::getHeaders() const noexcept
+	{
+		return this->_headers;
+	}
+
+	HttpHeaderView::HttpVersionType HttpHeaderView::getHttpVersion() const noexcept
+	{
+		return this->_version;
+	}
+
+	bool HttpHeaderView::isValid() const noexcept
+	{
+		return this->_valid;
+	}
+
+	HttpHeaderView::operator bool() const noexcept
+	{
+		return this->isValid();
+	}
+
+	bool HttpHeaderView::operator!() const noexcept
+	{
+		return !this->isValid();
+	}
+
+	HttpRequestHeaderView::HttpRequestHeaderView() noexcept
+		: HttpHeaderView{}, _type{HttpRequestHeader::RequestType::UNKNOWN}, _target{} {}
+
+	HttpRequestHeaderView::HttpRequestHeaderView(std::string_view str,
+												 std::optional<std::reference_wrapper<std::size_t>> body_start) noexcept
+		: HttpHeaderView{}, _type{HttpRequestHeader::RequestType::UNKNOWN}, _target{}
+	{
+		std::string_view start_line;
+		if (!this->_parseHeader(str, body_start, start_line))
+			return;
+
+		this->_valid = _split_request_line(start_line, this->_type, this->_target, this->_version);
+	}
+
+	HttpRequestHeaderView::RequestType HttpRequestHeaderView::getType() const noexcept
+	{
+		return this->_type;
+	}
+
+	std::string_view HttpRequestHeaderView::getTarget() const noexcept
+	{
+		return this->_target;
+	}
+
+	UrlView HttpRequestHeaderView::getUrl() const noexcept
+	{
+		return UrlView{this->_target};
+	}
+
+	HttpRequestHeader HttpRequestHeaderView::toOwned() const
+	{
+		HttpRequestHeader header;
+		if (!*this)
+			return header;
+
+		this->_copyTo(header);
+		header.setUrl(this->_target);
+		header.setType(this->_type);
+		return header;
+	}
+
+	HttpResponseHeaderView::HttpResponseHeaderView() noexcept
+		: HttpHeaderView{}, _status{HttpResponseHeader::StatusCode::unknown} {}
+
+	HttpResponseHeaderView::HttpResponseHeaderView(std::string_view str,
+												   std::optional<std::reference_wrapper<std::size_t>> body_start) noexcept
+		: HttpHeaderView{}, _status{HttpResponseHeader::StatusCode::unknown}
+	{
+		std::string_view start_line;
+		if (!this->_parseHeader(str, body_start, start_line))
+			return;
+
+		this->_valid = _split_status_line(start_line, this->_version, this->_status);
+	}
+
+	HttpResponseHeaderView::StatusCode HttpResponseHeaderView::getStatus() const noexcept
+	{
+		return this->_status;
+	}
+
+	HttpResponseHeader HttpResponseHeaderView::toOwned() const
+	{
+		HttpResponseHeader header;
+		if (!*this)
+			return header;
+
+		this->_copyTo(header);
+		header.setStatus(this->_status);
+		return header;
+	}
+
 	std::string to_string(const std::pair<int, int> &version)
 	{
 		std::string str = "HTTP/";
@@ -497,41 +832,112 @@ namespace phase2
 	}
 	// clang-format on
 
+	/**
+	 * @brief Pack up to 8 characters into a word with the layout of a memcpy
+	 * load, so start line tokens can be compared as one integer.
+	 */
+	constexpr std::uint64_t _pack_word(std::string_view str) noexcept
+	{
+		std::uint64_t word = 0;
+		for (std::size_t i = 0; i < str.size() && i < 8; ++i)
+		{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			word |= static_cast<std::uint64_t>(static_cast<unsigned char>(str[i])) << (8 * i);
+#else
+			word |= static_cast<std::uint64_t>(static_cast<unsigned char>(str[i])) << (8 * (7 - i));
+#endif
+		}
+		return word;
+	}
+
+	/**
+	 * @brief Load up to 8 bytes of a start line into a word, the missing
+	 * bytes are zero.
+	 */
+	inline std::uint64_t _start_line_word(const char *data, std::size_t size) noexcept
+	{
+		if (size < 4)
+			return _pack_word(std::string_view{data, size});
+
+		// two overlapping loads in registers, a partial copy into a zeroed
+		// word stalls on store forwarding. The shared bytes are equal, so
+		// OR keeps them.
+		std::uint32_t low, high;
+		std::memcpy(&low, data, 4);
+		std::memcpy(&high, data + size - 4, 4);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		return low | static_cast<std::uint64_t>(high) << (8 * (size - 4));
+#else
+		return static_cast<std::uint64_t>(low) << 32 | static_cast<std::uint64_t>(high) << (32 - 8 * (size - 4));
+#endif
+	}
+
+	/**
+	 * @brief Parse an 8-byte "HTTP/x.y" with single digits as one word, the
+	 * letters are case-insensitive.
+	 *
+	 * @return the version, or {-1, -1} if str is not of this form.
+	 */
+	inline std::pair<int, int> _to_version_word(std::string_view str) noexcept
+	{
+		if (str.size() != 8)
+			return std::make_pair(-1, -1);
+
+		// fold "HTTP" to lowercase and clear the digits before comparing
+		const std::uint64_t word = _start_line_word(str.data(), 8);
+		if (((word | _pack_word("    ")) & _pack_word({"\xff\xff\xff\xff\xff\0\xff\0", 8})) !=
+			_pack_word({"http/\0.\0", 8}))
+			return std::make_pair(-1, -1);
+
+		const unsigned int major = static_cast<unsigned char>(str[5]) - '0';
+		const unsigned int minor = static_cast<unsigned char>(str[7]) - '0';
+		if (major > 9 || minor > 9)
+			return std::make_pair(-1, -1);
+		return std::make_pair(static_cast<int>(major), static_cast<int>(minor));
+	}
+
 	HttpRequestHeader::RequestType to_type(std::string_view str)
 	{
 		using RequestType = HttpRequestHeader::RequestType;
-		if (str.length() < 3)
-			return RequestType::UNKNOWN;
 
-		switch (str.at(0))
+		// the length picks the candidates, and a load of a constant size is a
+		// few moves instead of a memcpy call
+		std::uint64_t word;
+		switch (str.size())
 		{
-		case 'G':
-			str.remove_prefix(1);
-			return str == "ET" ? RequestType::GET : RequestType::UNKNOWN;
-		case 'H':
-			str.remove_prefix(1);
-			return str == "EAD" ? RequestType::HEAD : RequestType::UNKNOWN;
-		case 'P':
-			str.remove_prefix(1);
-			if (str == "OST")
-				return RequestType::POST;
-			if (str == "UT")
+		case 3:
+			word = _start_line_word(str.data(), 3);
+			if (word == _pack_word("GET"))
+				return RequestType::GET;
+			if (word == _pack_word("PUT"))
 				return RequestType::PUT;
-			if (str == "ATCH")
+			break;
+		case 4:
+			word = _start_line_word(str.data(), 4);
+			if (word == _pack_word("POST"))
+				return RequestType::POST;
+			if (word == _pack_word("HEAD"))
+				return RequestType::HEAD;
+			break;
+		case 5:
+			word = _start_line_word(str.data(), 5);
+			if (word == _pack_word("PATCH"))
 				return RequestType::PATCH;
-			return RequestType::UNKNOWN;
-		case 'D':
-			str.remove_prefix(1);
-			return str == "ELETE" ? RequestType::DELETE : RequestType::UNKNOWN;
-		case 'C':
-			str.remove_prefix(1);
-			return str == "ONNECT" ? RequestType::CONNECT : RequestType::UNKNOWN;
-		case 'O':
-			str.remove_prefix(1);
-			return str == "PTIONS" ? RequestType::OPTIONS : RequestType::UNKNOWN;
-		case 'T':
-			str.remove_prefix(1);
-			return str == "RACE" ? RequestType::TRACE : RequestType::UNKNOWN;
+			if (word == _pack_word("TRACE"))
+				return RequestType::TRACE;
+			break;
+		case 6:
+			word = _start_line_word(str.data(), 6);
+			if (word == _pack_word("DELETE"))
+				return RequestType::DELETE;
+			break;
+		case 7:
+			word = _start_line_word(str.data(), 7);
+			if (word == _pack_word("CONNECT"))
+				return RequestType::CONNECT;
+			if (word == _pack_word("OPTIONS"))
+				return RequestType::OPTIONS;
+			break;
 		}
 
 		return RequestType::UNKNOWN;
@@ -539,15 +945,18 @@ namespace phase2
 
 	std::pair<int, int> to_version(std::string_view str)
 	{
+		const std::pair<int, int> version = _to_version_word(str);
+		if (version.first >= 0)
+			return version;
+
+		// multi-digit versions and malformed input
 		std::string tmp;
 		tmp.reserve(str.size());
 		for (const char &c : str)
 			tmp.push_back(std::isalpha(static_cast<unsigned char>(c)) ? std::toupper(static_cast<unsigned char>(c)) : c);
 		if (tmp.compare(0, 5, "HTTP/") != 0)
 		{
-#ifndef NDEBUG
-			log_debug << "to_version: invalid HTTP version, default HTTP/1.0";
-#endif
+			PHASE2_LOG(DEBUG, HTTP) << "to_version: invalid HTTP version, default HTTP/1.0";
 			return std::make_pair(-1, -1);
 		}
 
@@ -556,17 +965,13 @@ namespace phase2
 		int major, minor;
 		if (!(ss >> major))
 		{
-#ifndef NDEBUG
-			log_debug << "to_version: invalid HTTP version";
-#endif
+			PHASE2_LOG(DEBUG, HTTP) << "to_version: invalid HTTP version";
 			return std::make_pair(-1, -1);
 		}
 		ss.ignore();
 		if (!(ss >> minor))
 		{
-#ifndef NDEBUG
-			log_debug << "to_version: invalid HTTP version";
-#endif
+			PHASE2_LOG(DEBUG, HTTP) << "to_version: invalid HTTP version";
 			return std::make_pair(-1, -1);
 		}
 
@@ -0,0 +1,619 @@
+#include <phase2/HttpCoroutine.hpp>
+
+#if defined(__cpp_impl_coroutine)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <phase2/Chunked.hpp>
+#include <phase2/Http.hpp>
+#include <phase2/HttpParser.hpp>
+#include <phase2/HttpServer.hpp>
+#include <phase2/utils/HeaderId.hpp>
+#include <phase2/utils/HeaderMap.hpp>
+#include <phase2/utils/Log.hpp>
+
+namespace phase2
+{
+
+	using StatusCode = HttpResponseHeader::StatusCode;
+
+	/**
+	 * @brief The prefix of a frame, its size keeps the frame aligned like
+	 * operator new does.
+	 */
+	struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) _FramePrefix
+	{
+		FramePool *pool;
+		std::size_t size;
+	};
+
+	/**
+	 * @brief The pool of the connection whose coroutine is created or resumed
+	 * on this thread.
+	 */
+	thread_local FramePool *_current_frames = nullptr;
+
+	FramePool::FramePool() noexcept : _free{}, _allocated{0} {}
+
+	FramePool::~FramePool()
+	{
+		for (_Block *block : this->_free)
+			while (block != nullptr)
+				::operator delete(std::exchange(block, block->next));
+	}
+
+	void *FramePool::allocate(std::size_t size)
+	{
+		const std::size_t index = (size + _GRANULE - 1) / _GRANULE;
+		if (index >= _CLASSES)
+			return ::operator new(size);
+		if (this->_free[index] != nullptr)
+			return std::exchange(this->_free[index], this->_free[index]->next);
+		++this->_allocated;
+		return ::operator new(index * _GRANULE);
+	}
+
+	void FramePool::deallocate(void *frame, std::size_t size) noexcept
+	{
+		const std::size_t index = (size + _GRANULE - 1) / _GRANULE;
+		if (index >= _CLASSES)
+		{
+			::operator delete(frame);
+			return;
+		}
+		this->_free[index] = new (frame) _Block{this->_free[index]};
+	}
+
+	std::size_t FramePool::allocated() const noexcept
+	{
+		return this->_allocated;
+	}
+
+	void *HttpTask::promise_type::operator new(std::size_t size)
+	{
+		FramePool *pool = _current_frames;
+		size += sizeof(_FramePrefix);
+		void *block = pool != nullptr ? pool->allocate(size) : ::operator new(size);
+		return new (block) _FramePrefix{pool, size} + 1;
+	}
+
+	void HttpTask::promise_type::operator delete(void *frame) noexcept
+	{
+		_FramePrefix *prefix = static_cast<_FramePrefix *>(frame) - 1;
+		if (prefix->pool != nullptr)
+			prefix->pool->deallocate(prefix, prefix->size);
+		else
+			::operator delete(prefix);
+	}
+
+	HttpTask::HttpTask(std::coroutine_handle<promise_type> handle) noexcept : _handle{handle} {}
+
+	HttpTask::HttpTask(HttpTask &&other) noexcept : _handle{std::exchange(other._handle, nullptr)} {}
+
+	HttpTask &HttpTask::operator=(HttpTask &&other) noexcept
+	{
+		if (this != &other)
+		{
+			if (this->_handle)
+				this->_handle.destroy();
+			this->_handle = std::exchange(other._handle, nullptr);
+		}
+		return *this;
+	}
+
+	HttpTask::~HttpTask()
+	{
+		if (this->_handle)
+			this->_handle.destroy();
+	}
+
+	bool HttpTask::done() const noexcept
+	{
+		return !this->_handle || this->_handle.done();
+	}
+
+	HttpConnection::HttpConnection(int fd, const ServerConfig &config, std::atomic<std::uint64_t> &requests)
+		: _frames{}, _task{}, _fd{fd}, _index{0}, _config{config}, _requests{requests},
+		  _input(config.read_buffer_size, '\0'), _input_begin{0}, _input_end{0}, _parser{config.max_header_size},
+		  _parsed{0}, _request{}, _head{false}, _http10{false}, _in_body{false}, _chunked{false}, _body_left{0},
+		  _body_size{0}, _decoder{}, _iov{}, _iov_first{0}, _output{}, _sending{}, _error{}, _keep_alive{true},
+		  _answered{false}, _closing{false}, _failed{false}, _waiting{}, _retry{nullptr}, _awaiter{nullptr}
+	{
+	}
+
+	HttpConnection::~HttpConnection()
+	{
+		::close(this->_fd);
+	}
+
+	FramePool &HttpConnection::frames() noexcept
+	{
+		return this->_frames;
+	}
+
+	void HttpConnection::_suspend(std::coroutine_handle<> handle, bool (*retry)(void *), void *awaiter) noexcept
+	{
+		this->_waiting = handle;
+		this->_retry   = retry;
+		this->_awaiter = awaiter;
+	}
+
+	void HttpConnection::_start(const std::function<HttpTask(HttpConnection &)> &handler)
+	{
+		FramePool *previous = std::exchange(_current_frames, &this->_frames);
+		this->_task         = handler(*this);
+		if (this->_task._handle)
+			this->_task._handle.resume();
+		_current_frames = previous;
+	}
+
+	void HttpConnection::_resume()
+	{
+		if (!this->_waiting || !this->_retry(this->_awaiter))
+			return;
+		FramePool *previous = std::exchange(_current_frames, &this->_frames);
+		std::exchange(this->_waiting, nullptr).resume();
+		_current_frames = previous;
+	}
+
+	bool HttpConnection::_tryReadRequest(const HttpRequestHeader *&request)
+	{
+		request = nullptr;
+		// skip what the handler did not read of the previous body
+		std::string_view chunk;
+		while (this->_in_body)
+			if (!this->_tryReadBody(chunk))
+				return false;
+		if (this->_closing)
+			return true;
+
+		this->_answered = false;
+		while (true)
+		{
+			const std::string_view rest{this->_input.data() + this->_input_begin,
+										this->_input_end - this->_input_begin};
+			std::size_t header_size = 0;
+			HttpRequestHeaderView header;
+			// the first read of a request tries the whole header, the next ones
+			// feed only their bytes to the parser until it is complete
+			if (this->_parsed == 0)
+				header = HttpRequestHeaderView{rest, header_size};
+			if (!header)
+			{
+				const ParseStatus status = this->_parser.parse(rest.substr(this->_parsed));
+				this->_parsed            = rest.size();
+				if (status == ParseStatus::DONE)
+				{
+					this->_parser.reset();
+					this->_parsed = 0;
+					header        = HttpRequestHeaderView{rest, header_size};
+				}
+				else if (status == ParseStatus::NEED_MORE)
+				{
+					switch (this->_fill())
+					{
+					case _Fill::DATA:
+						continue;
+					case _Fill::AGAIN:
+						this->_flush();
+						return false;
+					case _Fill::END:
+						this->_closing = true;
+						return true;
+					}
+				}
+				if (!header)
+				{
+					this->_reject(StatusCode::bad_request);
+					return true;
+				}
+			}
+
+			std::size_t length;
+			bool chunked;
+			if (header_size > this->_config.max_header_size || !body_framing(header, length, chunked))
+			{
+				this->_reject(StatusCode::bad_request);
+				return true;
+			}
+			if (length > this->_config.max_body_size)
+			{
+				this->_reject(StatusCode::payload_too_large);
+				return true;
+			}
+
+			this->_request    = header.toOwned();
+			this->_head       = header.getType() == HttpRequestHeader::RequestType::HEAD;
+			this->_http10     = header.getHttpVersion() < std::make_pair(1, 1);
+			this->_keep_alive = keep_alive(header);
+			this->_in_body    = chunked || length != 0;
+			this->_chunked    = chunked;
+			this->_body_left  = length;
+			this->_body_size  = 0;
+			this->_decoder.reset();
+			this->_input_begin += header_size;
+			this->_requests.fetch_add(1, std::memory_order_relaxed);
+			request = &this->_request;
+			return true;
+		}
+	}
+
+	bool HttpConnection::_tryReadBody(std::string_view &chunk)
+	{
+		chunk = {};
+		while (this->_in_body)
+		{
+			std::string_view input{this->_input.data() + this->_input_begin, this->_input_end - this->_input_begin};
+			if (!input.empty() && !this->_chunked)
+			{
+				chunk = input.substr(0, this->_body_left);
+				this->_input_begin += chunk.size();
+				this->_body_left -= chunk.size();
+				this->_in_body = this->_body_left != 0;
+				return true;
+			}
+			if (!input.empty())
+			{
+				const std::size_t size = input.size();
+				ParseStatus status;
+				do
+					status = this->_decoder.decode(input, chunk);
+				while (status == ParseStatus::NEED_MORE && chunk.empty() && !input.empty());
+				this->_input_begin += size - input.size();
+
+				this->_body_size += chunk.size();
+				if (status == ParseStatus::ERROR)
+					this->_reject(StatusCode::bad_request);
+				else if (this->_body_size > this->_config.max_body_size)
+					this->_reject(StatusCode::payload_too_large);
+				else if (status == ParseStatus::DONE)
+					this->_in_body = false;
+				if (this->_failed)
+					chunk = {};
+				if (!chunk.empty() || !this->_in_body)
+					return true;
+			}
+
+			switch (this->_fill())
+			{
+			case _Fill::DATA:
+				break;
+			case _Fill::AGAIN:
+				this->_flush();
+				return false;
+			case _Fill::END:
+				// a truncated body, the response cannot be sent
+				this->_in_body = false;
+				this->_closing = true;
+				this->_failed  = true;
+				break;
+			}
+		}
+		return true;
+	}
+
+	bool HttpConnection::_write(HttpResponseHeader &header, std::string_view body, bool &written)
+	{
+		const bool idle = this->_iov.empty();
+		this->_queue(header, body);
+		// the next request is read before anything is sent, so the segments cannot stay borrowed
+		if (idle && !this->_closing && this->_input_begin != this->_input_end &&
+			this->_output.size() < this->_config.read_buffer_size)
+		{
+			for (const iovec &segment : this->_iov)
+				this->_output.append(static_cast<const char *>(segment.iov_base), segment.iov_len);
+			this->_iov.clear();
+			written = true;
+			return true;
+		}
+		return this->_tryWrite(written);
+	}
+
+	bool HttpConnection::_tryWrite(bool &written)
+	{
+		if (!this->_flush())
+			return false;
+		written = !this->_failed;
+		return true;
+	}
+
+	HttpConnection::_Fill HttpConnection::_fill()
+	{
+		if (this->_input_begin != 0)
+		{
+			std::memmove(this->_input.data(), this->_input.data() + this->_input_begin,
+						 this->_input_end - this->_input_begin);
+			this->_input_end -= this->_input_begin;
+			this->_input_begin = 0;
+		}
+		if (this->_input_end == this->_input.size())
+		{
+			const std::size_t limit = this->_config.max_header_size + this->_config.read_buffer_size;
+			if (this->_input.size() >= limit)
+				return _Fill::END;
+			this->_input.resize(std::min(this->_input.size() * 2, limit));
+		}
+
+		while (true)
+		{
+			const ssize_t size = ::read(this->_fd, this->_input.data() + this->_input_end,
+										this->_input.size() - this->_input_end);
+			if (size > 0)
+			{
+				this->_input_end += static_cast<std::size_t>(size);
+				return _Fill::DATA;
+			}
+			if (size == 0)
+				return _Fill::END;
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return _Fill::AGAIN;
+			PHASE2_LOG(DEBUG, SERVER) << "HttpConnection: read failed: " << std::strerror(errno);
+			this->_failed = true;
+			return _Fill::END;
+		}
+	}
+
+	void HttpConnection::_queue(HttpResponseHeader &header, std::string_view body)
+	{
+		if (this->_failed)
+			return;
+		if (header.getStatus() != StatusCode::unknown && header.getHttpVersion().first < 0)
+			header.setHttpVersion(1, 1);
+		if (!header)
+		{
+			PHASE2_LOG(ERROR, SERVER) << "HttpConnection: the handler wrote an invalid response";
+			this->_reject(StatusCode::internal_server_error);
+			return;
+		}
+
+		const HeaderMap &fields = header.getHeaders();
+		if (!fields.contains(HeaderId::CONTENT_LENGTH) && !fields.contains(HeaderId::TRANSFER_ENCODING))
+			header.addHeader(HeaderId::CONTENT_LENGTH, std::to_string(body.size()));
+		if (!this->_keep_alive)
+		{
+			this->_closing = true;
+			header.addHeader(HeaderId::CONNECTION, "close");
+		}
+		else if (this->_http10 && !fields.contains(HeaderId::CONNECTION))
+			header.addHeader(HeaderId::CONNECTION, "keep-alive");
+
+		header.serialize(this->_iov);
+		if (!this->_head && !body.empty())
+			this->_iov.push_back(iovec{const_cast<char *>(body.data()), body.size()});
+		this->_answered = true;
+	}
+
+	void HttpConnection::_reject(HttpResponseHeader::StatusCode status)
+	{
+		PHASE2_LOG(DEBUG, SERVER) << "HttpConnection: rejecting a request with " << static_cast<unsigned>(status);
+		const bool answered = this->_answered || this->_failed;
+		this->_in_body      = false;
+		this->_closing      = true;
+		this->_failed       = true;
+		if (answered)
+			return;
+
+		this->_error = HttpResponseHeader{};
+		this->_error.setHttpVersion(1, 1);
+		this->_error.setStatus(status);
+		this->_error.addHeader(HeaderId::CONTENT_LENGTH, "0");
+		this->_error.addHeader(HeaderId::CONNECTION, "close");
+		this->_error.serialize(this->_iov);
+		this->_answered = true;
+	}
+
+	bool HttpConnection::_flush()
+	{
+		// the copied responses were answered before the queued ones
+		if (!this->_output.empty())
+		{
+			this->_sending.swap(this->_output);
+			this->_iov.insert(this->_iov.begin() + static_cast<std::ptrdiff_t>(this->_iov_first),
+							  iovec{this->_sending.data(), this->_sending.size()});
+		}
+		while (this->_iov_first < this->_iov.size())
+		{
+			msghdr message{};
+			message.msg_iov    = this->_iov.data() + this->_iov_first;
+			message.msg_iovlen = std::min<std::size_t>(1024, this->_iov.size() - this->_iov_first);
+			ssize_t sent       = ::sendmsg(this->_fd, &message, MSG_NOSIGNAL);
+			if (sent < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					return false;
+				PHASE2_LOG(DEBUG, SERVER) << "HttpConnection: write failed: " << std::strerror(errno);
+				this->_closing = true;
+				this->_failed  = true;
+				break;
+			}
+
+			// skip the written segments and cut the partially written one
+			while (sent != 0)
+			{
+				iovec &segment = this->_iov[this->_iov_first];
+				if (static_cast<std::size_t>(sent) < segment.iov_len)
+				{
+					segment.iov_base = static_cast<char *>(segment.iov_base) + sent;
+					segment.iov_len -= static_cast<std::size_t>(sent);
+					break;
+				}
+				sent -= static_cast<ssize_t>(segment.iov_len);
+				++this->_iov_first;
+			}
+		}
+		this->_iov.clear();
+		this->_iov_first = 0;
+		this->_sending.clear();
+		return true;
+	}
+
+	AsyncHttpServer::AsyncHttpServer(Handler handler, ServerConfig config)
+		: _handler{std::move(handler)}, _config{config}, _connections{}, _requests{0}, _stopping{false},
+		  _epoll_fd{::epoll_create1(EPOLL_CLOEXEC)}, _wake_fd{::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)},
+		  _listen_fd{-1}, _port{0}
+	{
+		if (this->_epoll_fd < 0 || this->_wake_fd < 0)
+		{
+			PHASE2_LOG(ERROR, SERVER) << "AsyncHttpServer: cannot create the event loop: " << std::strerror(errno);
+			return;
+		}
+		epoll_event event{};
+		event.events   = EPOLLIN;
+		event.data.ptr = &this->_wake_fd;
+		::epoll_ctl(this->_epoll_fd, EPOLL_CTL_ADD, this->_wake_fd, &event);
+	}
+
+	AsyncHttpServer::~AsyncHttpServer()
+	{
+		this->_connections.clear();
+		for (int fd : {this->_listen_fd, this->_wake_fd, this->_epoll_fd})
+			if (fd >= 0)
+				::close(fd);
+	}
+
+	bool AsyncHttpServer::listen(const std::string &address, std::uint16_t port)
+	{
+		if (this->_epoll_fd < 0 || this->_listen_fd >= 0)
+		{
+			PHASE2_LOG(ERROR, SERVER) << "AsyncHttpServer: cannot listen on " << address;
+			return false;
+		}
+
+		this->_listen_fd = open_listener(address, port, this->_config);
+		if (this->_listen_fd < 0)
+			return false;
+		this->_port = port;
+
+		epoll_event event{};
+		event.events   = EPOLLIN | EPOLLET;
+		event.data.ptr = nullptr;
+		return ::epoll_ctl(this->_epoll_fd, EPOLL_CTL_ADD, this->_listen_fd, &event) == 0;
+	}
+
+	std::uint16_t AsyncHttpServer::port() const noexcept
+	{
+		return this->_port;
+	}
+
+	bool AsyncHttpServer::run()
+	{
+		if (this->_listen_fd < 0)
+			return false;
+
+		epoll_event events[256];
+		while (!this->_stopping.load(std::memory_order_acquire))
+		{
+			const int count = ::epoll_wait(this->_epoll_fd, events, 256, -1);
+			if (count < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				PHASE2_LOG(ERROR, SERVER) << "AsyncHttpServer: epoll_wait failed: " << std::strerror(errno);
+				return false;
+			}
+
+			for (int i = 0; i < count; ++i)
+			{
+				if (events[i].data.ptr == nullptr)
+					this->_accept();
+				else if (events[i].data.ptr != &this->_wake_fd)
+					this->_drive(*static_cast<HttpConnection *>(events[i].data.ptr));
+			}
+		}
+		return true;
+	}
+
+	void AsyncHttpServer::stop() noexcept
+	{
+		this->_stopping.store(true, std::memory_order_release);
+		const std::uint64_t value = 1;
+		if (::write(this->_wake_fd, &value, sizeof(value)) < 0)
+			PHASE2_LOG(ERROR, SERVER) << "AsyncHttpServer: cannot wake the event loop: " << std::strerror(errno);
+	}
+
+	std::uint64_t AsyncHttpServer::requests() const noexcept
+	{
+		return this->_requests.load(std::memory_order_relaxed);
+	}
+
+	void AsyncHttpServer::_accept()
+	{
+		while (true)
+		{
+			const int fd = ::accept4(this->_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (fd < 0)
+			{
+				if (errno == EINTR || errno == ECONNABORTED)
+					continue;
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+					PHASE2_LOG(WARNING, SERVER) << "AsyncHttpServer: accept failed: " << std::strerror(errno);
+				return;
+			}
+			const int nodelay = 1;
+			::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+			HttpConnection &connection = *this->_connections.emplace_back(
+				std::unique_ptr<HttpConnection>{new HttpConnection{fd, this->_config, this->_requests}});
+			connection._index = this->_connections.size() - 1;
+			epoll_event event{};
+			event.events   = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+			event.data.ptr = &connection;
+			if (::epoll_ctl(this->_epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+			{
+				PHASE2_LOG(WARNING, SERVER) << "AsyncHttpServer: cannot watch a connection: " << std::strerror(errno);
+				this->_close(connection);
+				continue;
+			}
+
+			connection._start(this->_handler);
+			this->_drive(connection);
+		}
+	}
+
+	void AsyncHttpServer::_drive(HttpConnection &connection)
+	{
+		connection._resume();
+		// once the coroutine returned, write what is left and close
+		if (connection._task.done() && connection._flush())
+			this->_close(connection);
+	}
+
+	void AsyncHttpServer::_close(HttpConnection &connection)
+	{
+		// move the last connection into the slot of the closed one
+		const std::size_t index = connection._index;
+		if (index + 1 != this->_connections.size())
+		{
+			this->_connections[index]         = std::move(this->_connections.back());
+			this->_connections[index]->_index = index;
+		}
+		this->_connections.pop_back();
+	}
+
+} // namespace phase2
+
+#endif
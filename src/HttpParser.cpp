@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <phase2/Http.hpp>
+#include <phase2/HttpParser.hpp>
+#include <phase2/utils/HeaderId.hpp>
+#include <phase2/utils/HeaderMap.hpp>
+#include <phase2/utils/Log.hpp>
+#include <phase2/utils/Scan.hpp>
+
+namespace phase2
+{
+
+	template <typename HeaderType>
+	BasicHttpParser<HeaderType>::BasicHttpParser(std::size_t max_size) noexcept
+		: _header{}, _line{}, _consumed{0}, _max_size{max_size},
+		  _status{ParseStatus::NEED_MORE}, _start_line_parsed{false} {}
+
+	template <typename HeaderType>
+	ParseStatus BasicHttpParser<HeaderType>::parse(std::string_view chunk,
+												   std::optional<std::reference_wrapper<std::size_t>> consumed)
+	{
+		const char *const begin = chunk.data();
+		const char *const end   = begin + chunk.size();
+		const char *pos         = begin;
+		while (this->_status == ParseStatus::NEED_MORE && pos != end)
+		{
+			// a CR at the end of the previous chunk must be followed by LF
+			const bool pending_cr = !this->_line.empty() && this->_line.back() == '\r';
+			const char *ctl       = pending_cr ? pos : phase2::find_ctl(pos, end);
+			const char *line_end;
+			if (pending_cr && *ctl == '\n')
+				line_end = ctl + 1;
+			else if (!pending_cr && (ctl == end || (*ctl == '\r' && ctl + 1 == end)))
+				line_end = end;
+			else if (!pending_cr && *ctl == '\r' && ctl[1] == '\n')
+				line_end = ctl + 2;
+			else
+			{
+				PHASE2_LOG(DEBUG, HTTP) << "BasicHttpParser: unexpected control character in header";
+				this->_status = ParseStatus::ERROR;
+				break;
+			}
+
+			this->_consumed += line_end - pos;
+			if (this->_consumed > this->_max_size)
+			{
+				PHASE2_LOG(DEBUG, HTTP) << "BasicHttpParser: header exceeds " << this->_max_size << " bytes";
+				this->_status = ParseStatus::ERROR;
+				pos           = line_end;
+				break;
+			}
+
+			const std::string_view piece{pos, static_cast<std::size_t>(line_end - pos)};
+			pos = line_end;
+			if (piece.back() != '\n')
+				this->_line.append(piece);
+			else if (this->_line.empty())
+				this->_status = this->_parseLine(piece);
+			else
+			{
+				this->_line.append(piece);
+				this->_status = this->_parseLine(this->_line);
+				this->_line.clear();
+			}
+		}
+
+		if (consumed)
+			consumed->get() = pos - begin;
+		return this->_status;
+	}
+
+	template <typename HeaderType>
+	ParseStatus BasicHttpParser<HeaderType>::parse(const BufferType &buf,
+												   std::optional<std::reference_wrapper<std::size_t>> consumed)
+	{
+		return this->parse(std::string_view{reinterpret_cast<const char *>(buf.data()), buf.size()}, consumed);
+	}
+
+	template <typename HeaderType>
+	ParseStatus BasicHttpParser<HeaderType>::parse(const std::uint8_t *buf, std::size_t size,
+												   std::optional<std::reference_wrapper<std::size_t>> consumed)
+	{
+		return this->parse(std::string_view{reinterpret_cast<const char *>(buf), size}, consumed);
+	}
+
+	template <typename HeaderType>
+	std::size_t BasicHttpParser<HeaderType>::consumed() const noexcept
+	{
+		return this->_consumed;
+	}
+
+	template <typename HeaderType>
+	const HeaderType &BasicHttpParser<HeaderType>::header() const noexcept
+	{
+		return this->_header;
+	}
+
+	template <typename HeaderType>
+	HeaderType &BasicHttpParser<HeaderType>::header() noexcept
+	{
+		return this->_header;
+	}
+
+	template <typename HeaderType>
+	void BasicHttpParser<HeaderType>::reset() noexcept
+	{
+		this->_header            = HeaderType{};
+		this->_line.clear();
+		this->_consumed          = 0;
+		this->_status            = ParseStatus::NEED_MORE;
+		this->_start_line_parsed = false;
+	}
+
+	template <typename HeaderType>
+	ParseStatus BasicHttpParser<HeaderType>::status() const noexcept
+	{
+		return this->_status;
+	}
+
+	template <typename HeaderType>
+	ParseStatus BasicHttpParser<HeaderType>::_parseLine(std::string_view line)
+	{
+		line.remove_suffix(2);
+
+		if (!this->_start_line_parsed)
+		{
+			if (!this->_header._parseStartLine(line))
+				return ParseStatus::ERROR;
+			this->_start_line_parsed = true;
+			return ParseStatus::NEED_MORE;
+		}
+
+		if (line.empty())
+		{
+			this->_header._valid = true;
+			return ParseStatus::DONE;
+		}
+
+		return this->_header._parseField(line) ? ParseStatus::NEED_MORE : ParseStatus::ERROR;
+	}
+
+	template class BasicHttpParser<HttpRequestHeader>;
+	template class BasicHttpParser<HttpResponseHeader>;
+
+	/**
+	 * @brief Check whether a comma separated header value holds a token.
+	 */
+	bool _has_token(std::string_view value, std::string_view token) noexcept
+	{
+		while (!value.empty())
+		{
+			const std::size_t comma = value.find(',');
+			std::string_view item   = value.substr(0, comma);
+			while (!item.empty() && (item.front() == ' ' || item.front() == '\t'))
+				item.remove_prefix(1);
+			while (!item.empty() && (item.back() == ' ' || item.back() == '\t'))
+				item.remove_suffix(1);
+			if (CaseInsensitiveEqual{}(item, token))
+				return true;
+			if (comma == value.npos)
+				break;
+			value.remove_prefix(comma + 1);
+		}
+		return false;
+	}
+
+	bool keep_alive(const HttpRequestHeaderView &request) noexcept
+	{
+		const HeaderViewMap &fields = request.getHeaders();
+		const bool http11           = request.getHttpVersion() >= std::make_pair(1, 1);
+		for (auto it = fields.find(HeaderId::CONNECTION); it != fields.end();
+			 it = fields.find(HeaderId::CONNECTION, it + 1))
+		{
+			if (_has_token(it->value, "close"))
+				return false;
+			if (!http11 && _has_token(it->value, "keep-alive"))
+				return true;
+		}
+		return http11;
+	}
+
+	HttpRequestPipeline::HttpRequestPipeline(std::string_view buffer, std::size_t max_size) noexcept
+		: _buffer{buffer}, _consumed{0}, _max_size{max_size} {}
+
+	bool body_framing(const HttpRequestHeaderView &header, std::size_t &length, bool &chunked) noexcept
+	{
+		const HeaderViewMap &fields = header.getHeaders();
+		length                      = 0;
+		chunked                     = false;
+
+		auto coding = fields.find(HeaderId::TRANSFER_ENCODING);
+		if (coding != fields.end())
+		{
+			// only the last coding matters, and it must be chunked
+			auto last = coding;
+			while ((coding = fields.find(HeaderId::TRANSFER_ENCODING, coding + 1)) != fields.end())
+				last = coding;
+			std::string_view value  = last->value;
+			const std::size_t comma = value.rfind(',');
+			if (comma != value.npos)
+				value.remove_prefix(comma + 1);
+			while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+				value.remove_prefix(1);
+			chunked = CaseInsensitiveEqual{}(value, "chunked");
+			return chunked;
+		}
+
+		bool found = false;
+		for (auto it = fields.find(HeaderId::CONTENT_LENGTH); it != fields.end();
+			 it = fields.find(HeaderId::CONTENT_LENGTH, it + 1))
+		{
+			std::size_t value;
+			const char *end                     = it->value.data() + it->value.size();
+			const std::from_chars_result result = std::from_chars(it->value.data(), end, value);
+			if (result.ec != std::errc{} || result.ptr != end || it->value.empty() || (found && value != length))
+				return false;
+			length = value;
+			found  = true;
+		}
+		return true;
+	}
+
+	ParseStatus HttpRequestPipeline::next(PipelinedRequest &request) noexcept
+	{
+		const std::string_view rest = this->remaining();
+		request.size                = 0;
+		if (rest.empty())
+			return ParseStatus::NEED_MORE;
+
+		std::size_t header_size = 0;
+		request.header          = HttpRequestHeaderView{rest, header_size};
+		if (!request.header)
+		{
+			// tell an invalid header from one that is not complete yet
+			const std::size_t end = rest.find("\r\n\r\n");
+			if (end == rest.npos && rest.size() <= this->_max_size)
+				return ParseStatus::NEED_MORE;
+			PHASE2_LOG(DEBUG, HTTP) << "HttpRequestPipeline: invalid request at byte " << this->_consumed;
+			return ParseStatus::ERROR;
+		}
+		if (header_size > this->_max_size)
+		{
+			PHASE2_LOG(DEBUG, HTTP) << "HttpRequestPipeline: header exceeds " << this->_max_size << " bytes";
+			return ParseStatus::ERROR;
+		}
+
+		std::size_t length;
+		if (!body_framing(request.header, length, request.chunked))
+		{
+			PHASE2_LOG(DEBUG, HTTP) << "HttpRequestPipeline: invalid body framing at byte " << this->_consumed;
+			return ParseStatus::ERROR;
+		}
+		if (length > std::numeric_limits<std::size_t>::max() - header_size)
+		{
+			PHASE2_LOG(DEBUG, HTTP) << "HttpRequestPipeline: body length overflows at byte " << this->_consumed;
+			return ParseStatus::ERROR;
+		}
+		request.size = header_size + length;
+		if (length > rest.size() - header_size)
+			return ParseStatus::NEED_MORE;
+
+		request.body = rest.substr(header_size, length);
+		this->_consumed += request.size;
+		return ParseStatus::DONE;
+	}
+
+	void HttpRequestPipeline::advance(std::size_t size) noexcept
+	{
+		this->_consumed += std::min(size, this->_buffer.size() - this->_consumed);
+	}
+
+	std::size_t HttpRequestPipeline::consumed() const noexcept
+	{
+		return this->_consumed;
+	}
+
+	std::string_view HttpRequestPipeline::remaining() const noexcept
+	{
+		return this->_buffer.substr(this->_consumed);
+	}
+
+} // namespace phase2
@@ -0,0 +1,1045 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <phase2/Chunked.hpp>
+#include <phase2/Http.hpp>
+#include <phase2/HttpParser.hpp>
+#include <phase2/HttpServer.hpp>
+#include <phase2/utils/HeaderId.hpp>
+#include <phase2/utils/HeaderMap.hpp>
+#include <phase2/utils/IoUring.hpp>
+#include <phase2/utils/Log.hpp>
+#include <phase2/utils/WorkStealingExecutor.hpp>
+
+namespace phase2
+{
+
+	using StatusCode = HttpResponseHeader::StatusCode;
+
+	/**
+	 * @brief The maximum number of segments of a sendmsg call, IOV_MAX on Linux.
+	 */
+	constexpr std::size_t _MAX_SEGMENTS = 1024;
+
+	/**
+	 * @brief The number of submission entries of the io_uring backend.
+	 */
+	constexpr unsigned _RING_ENTRIES = 1024;
+
+	/**
+	 * @brief The maximum number of read buffers a server keeps for new
+	 * connections.
+	 */
+	constexpr std::size_t _MAX_SPARE_BUFFERS = 256;
+
+	/**
+	 * @brief The number of completed offloaded requests the queue to the
+	 * event loop holds, the executor waits when it is full.
+	 */
+	constexpr std::size_t _COMPLETION_QUEUE_SIZE = 4096;
+
+	// clang-format off
+	/**
+	 * @brief The operation of an io_uring completion, in the low bits of its
+	 * user data. The other bits hold the connection, if any.
+	 */
+	constexpr std::uint64_t _OP_ACCEPT = 0;
+	constexpr std::uint64_t _OP_WAKE   = 1;
+	constexpr std::uint64_t _OP_CANCEL = 2;
+	constexpr std::uint64_t _OP_RECV   = 3;
+	constexpr std::uint64_t _OP_SEND   = 4;
+	constexpr std::uint64_t _OP_MASK   = 7;
+	// clang-format on
+
+	/**
+	 * @brief The buffer group of the receive buffers.
+	 */
+	constexpr std::uint16_t _BUFFER_GROUP = 0;
+
+	std::string_view to_string(ServerBackend backend) noexcept
+	{
+		switch (backend)
+		{
+		case ServerBackend::EPOLL:
+			return "epoll";
+		case ServerBackend::IO_URING:
+			return "io_uring";
+		default:
+			return "auto";
+		}
+	}
+
+	HttpServer::HttpServer(Handler handler, ServerConfig config)
+		: _handler{std::move(handler)}, _config{config}, _connections{}, _spare_buffers{}, _requests{0},
+		  _stopping{false}, _completions{_COMPLETION_QUEUE_SIZE}, _offloaded{0}, _ring{}, _deferred{},
+		  _accept_deferred{false}, _wake_deferred{false}, _backend{config.backend},
+		  _epoll_fd{::epoll_create1(EPOLL_CLOEXEC)}, _wake_fd{::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)},
+		  _listen_fd{-1}, _port{0}
+	{
+		if (this->_backend == ServerBackend::AUTO)
+			this->_backend = IoUring::supported() ? ServerBackend::IO_URING : ServerBackend::EPOLL;
+		if (this->_epoll_fd < 0 || this->_wake_fd < 0)
+		{
+			PHASE2_LOG(ERROR, SERVER) << "HttpServer: cannot create the event loop: " << std::strerror(errno);
+			return;
+		}
+		epoll_event event{};
+		event.events   = EPOLLIN;
+		event.data.ptr = &this->_wake_fd;
+		::epoll_ctl(this->_epoll_fd, EPOLL_CTL_ADD, this->_wake_fd, &event);
+	}
+
+	HttpServer::~HttpServer()
+	{
+		// the offloaded requests refer to the connections and the eventfd
+		while (this->_offloaded.load(std::memory_order_acquire) != 0)
+			std::this_thread::yield();
+		_Completion completion{};
+		while (this->_completions.tryPop(completion))
+			completion.connection->offloaded = false;
+
+		while (!this->_connections.empty())
+			this->_close(*this->_connections.back());
+		for (int fd : {this->_listen_fd, this->_wake_fd, this->_epoll_fd})
+			if (fd >= 0)
+				::close(fd);
+	}
+
+	int open_listener(const std::string &address, std::uint16_t &port, const ServerConfig &config)
+	{
+		sockaddr_in addr{};
+		addr.sin_family = AF_INET;
+		addr.sin_port   = htons(port);
+		if (::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+		{
+			PHASE2_LOG(ERROR, SERVER) << "cannot listen on " << address;
+			return -1;
+		}
+
+		const int fd    = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		const int reuse = 1;
+		socklen_t size  = sizeof(addr);
+		if (fd < 0 || ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+			(config.reuse_port && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) != 0) ||
+			::bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0 ||
+			::listen(fd, config.backlog) != 0 || ::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &size) != 0)
+		{
+			PHASE2_LOG(ERROR, SERVER) << "cannot listen on " << address << ':' << port << ": " << std::strerror(errno);
+			if (fd >= 0)
+				::close(fd);
+			return -1;
+		}
+
+		port = ntohs(addr.sin_port);
+		PHASE2_LOG(INFO, SERVER) << "listening on " << address << ':' << port;
+		return fd;
+	}
+
+	bool HttpServer::listen(const std::string &address, std::uint16_t port)
+	{
+		if (this->_epoll_fd < 0 || this->_listen_fd >= 0)
+		{
+			PHASE2_LOG(ERROR, SERVER) << "HttpServer: cannot listen on " << address;
+			return false;
+		}
+
+		this->_listen_fd = open_listener(address, port, this->_config);
+		if (this->_listen_fd < 0)
+			return false;
+		this->_port = port;
+		return true;
+	}
+
+	std::uint16_t HttpServer::port() const noexcept
+	{
+		return this->_port;
+	}
+
+	ServerBackend HttpServer::backend() const noexcept
+	{
+		return this->_backend;
+	}
+
+	bool HttpServer::run()
+	{
+		if (this->_listen_fd < 0)
+			return false;
+		if (this->_config.cpu >= 0)
+		{
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(this->_config.cpu, &set);
+			const int error = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+			if (error != 0)
+				PHASE2_LOG(WARNING, SERVER) << "HttpServer: cannot pin the loop to CPU " << this->_config.cpu << ": "
+											<< std::strerror(error);
+		}
+		PHASE2_LOG(INFO, SERVER) << "HttpServer: running on " << to_string(this->_backend);
+		return this->_backend == ServerBackend::IO_URING ? this->_runUring() : this->_runEpoll();
+	}
+
+	bool HttpServer::_runEpoll()
+	{
+		epoll_event event{};
+		event.events   = EPOLLIN | EPOLLET;
+		event.data.ptr = nullptr;
+		if (::epoll_ctl(this->_epoll_fd, EPOLL_CTL_ADD, this->_listen_fd, &event) != 0 && errno != EEXIST)
+		{
+			PHASE2_LOG(ERROR, SERVER) << "HttpServer: cannot watch the listening socket: " << std::strerror(errno);
+			return false;
+		}
+
+		epoll_event events[256];
+		while (!this->_stopping.load(std::memory_order_acquire))
+		{
+			const int count = ::epoll_wait(this->_epoll_fd, events, 256, -1);
+			if (count < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				PHASE2_LOG(ERROR, SERVER) << "HttpServer: epoll_wait failed: " << std::strerror(errno);
+				return false;
+			}
+
+			bool woken = false;
+			for (int i = 0; i < count; ++i)
+			{
+				const epoll_event &event = events[i];
+				if (event.data.ptr == nullptr)
+					this->_accept();
+				else if (event.data.ptr == &this->_wake_fd)
+					woken = true;
+				else
+				{
+					_Connection &connection = *static_cast<_Connection *>(event.data.ptr);
+					if ((event.events & (EPOLLERR | EPOLLHUP)) != 0)
+						this->_close(connection);
+					else
+					{
+						if ((event.events & (EPOLLIN | EPOLLRDHUP)) != 0)
+							connection.readable = true;
+						this->_drive(connection);
+					}
+				}
+			}
+
+			// a completion may close a connection whose event is later in the batch
+			if (woken)
+			{
+				std::uint64_t value;
+				while (::read(this->_wake_fd, &value, sizeof(value)) > 0)
+					;
+				this->_complete();
+			}
+		}
+		return true;
+	}
+
+	void HttpServer::stop() noexcept
+	{
+		this->_stopping.store(true, std::memory_order_release);
+		this->_wake();
+	}
+
+	void HttpServer::_wake() noexcept
+	{
+		const std::uint64_t value = 1;
+		if (::write(this->_wake_fd, &value, sizeof(value)) < 0)
+			PHASE2_LOG(ERROR, SERVER) << "HttpServer: cannot wake the event loop: " << std::strerror(errno);
+	}
+
+	std::uint64_t HttpServer::requests() const noexcept
+	{
+		return this->_requests.load(std::memory_order_relaxed);
+	}
+
+	HttpServer::_Connection &HttpServer::_open(int fd)
+	{
+		const int nodelay = 1;
+		::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+		std::string input;
+		if (this->_spare_buffers.empty())
+			input.resize(this->_config.read_buffer_size);
+		else
+		{
+			input = std::move(this->_spare_buffers.back());
+			this->_spare_buffers.pop_back();
+		}
+
+		auto connection = std::unique_ptr<_Connection>{
+			new _Connection{fd, this->_connections.size(), std::move(input), 0,
+							HttpRequestParser{this->_config.max_header_size}, 0, 0, {}, {}, 0, 0, ChunkedDecoder{},
+							HttpRequestHeader{}, {}, false, true, false, false, false, false, {}, msghdr{}, false,
+							false, false, false, false}};
+		return *this->_connections.emplace_back(std::move(connection));
+	}
+
+	void HttpServer::_accept()
+	{
+		while (true)
+		{
+			const int fd = ::accept4(this->_listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (fd < 0)
+			{
+				if (errno == EINTR || errno == ECONNABORTED)
+					continue;
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+					PHASE2_LOG(WARNING, SERVER) << "HttpServer: accept failed: " << std::strerror(errno);
+				return;
+			}
+
+			_Connection &connection = this->_open(fd);
+			epoll_event event{};
+			event.events   = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+			event.data.ptr = &connection;
+			if (::epoll_ctl(this->_epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+			{
+				PHASE2_LOG(WARNING, SERVER) << "HttpServer: cannot watch a connection: " << std::strerror(errno);
+				this->_close(connection);
+			}
+		}
+	}
+
+	void HttpServer::_drive(_Connection &connection)
+	{
+		if (connection.closed)
+			return;
+		while (true)
+		{
+			const bool progress = this->_process(connection);
+			if (!this->_flush(connection))
+				return;
+			// the socket is full, EPOLLOUT resumes the connection
+			if (connection.output_size != 0)
+				return;
+			// the completion of the offloaded request resumes the connection
+			if (connection.offloaded)
+				return;
+			if (connection.closing || (connection.eof && !progress))
+			{
+				this->_close(connection);
+				return;
+			}
+			if (progress)
+				continue;
+			if (!connection.readable || !this->_read(connection))
+				return;
+		}
+	}
+
+	bool HttpServer::_read(_Connection &connection)
+	{
+		if (connection.input_size == connection.input.size())
+		{
+			const std::size_t limit = this->_config.max_header_size + this->_config.max_body_size;
+			if (connection.input.size() >= limit)
+			{
+				this->_reject(connection, StatusCode::payload_too_large);
+				return true;
+			}
+			connection.input.resize(std::min(connection.input.size() * 2, limit));
+		}
+
+		const std::size_t space = connection.input.size() - connection.input_size;
+		const ssize_t size      = ::read(connection.fd, connection.input.data() + connection.input_size, space);
+		if (size > 0)
+		{
+			connection.input_size += static_cast<std::size_t>(size);
+			// a short read drained the socket, the next bytes raise a new edge
+			if (static_cast<std::size_t>(size) < space)
+				connection.readable = false;
+			return true;
+		}
+		if (size == 0)
+		{
+			connection.readable = false;
+			connection.eof      = true;
+			return true;
+		}
+		if (errno == EINTR)
+			return true;
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+			connection.readable = false;
+			return true;
+		}
+		PHASE2_LOG(DEBUG, SERVER) << "HttpServer: read failed: " << std::strerror(errno);
+		this->_close(connection);
+		return false;
+	}
+
+	bool HttpServer::_process(_Connection &connection)
+	{
+		HttpRequestPipeline pipeline{std::string_view{connection.input.data(), connection.input_size},
+									 this->_config.max_header_size};
+		bool handled = false;
+		while (!connection.closing && !connection.offloaded &&
+			   connection.output_size < this->_config.max_pending_output)
+		{
+			if (connection.in_chunked)
+			{
+				std::string_view input = pipeline.remaining();
+				const std::size_t size = input.size();
+				std::string_view data;
+				ParseStatus status;
+				do
+				{
+					status = connection.decoder.decode(input, data);
+					connection.chunked_body.append(data);
+				} while (status == ParseStatus::NEED_MORE && !input.empty());
+				pipeline.advance(size - input.size());
+
+				if (status == ParseStatus::ERROR)
+					this->_reject(connection, StatusCode::bad_request);
+				else if (connection.chunked_body.size() > this->_config.max_body_size)
+					this->_reject(connection, StatusCode::payload_too_large);
+				else if (status == ParseStatus::DONE)
+				{
+					connection.in_chunked = false;
+					this->_respond(connection, std::move(connection.chunked_request), connection.chunked_body);
+					handled = true;
+					continue;
+				}
+				break;
+			}
+
+			// a request split over reads is not parsed again from its start
+			const std::string_view rest = pipeline.remaining();
+			if (rest.size() < connection.needed)
+				break;
+			if (connection.parsed != 0)
+			{
+				const ParseStatus status = connection.parser.parse(rest.substr(connection.parsed));
+				connection.parsed        = rest.size();
+				if (status == ParseStatus::NEED_MORE)
+					break;
+				if (status == ParseStatus::ERROR)
+				{
+					this->_reject(connection, StatusCode::bad_request);
+					break;
+				}
+				connection.parser.reset();
+				connection.parsed = 0;
+			}
+
+			PipelinedRequest request;
+			const ParseStatus status = pipeline.next(request);
+			if (status == ParseStatus::NEED_MORE)
+			{
+				// wait for the body, or for the end of the header, but refuse
+				// a body that is too large before it arrives
+				std::size_t length;
+				bool chunked;
+				if (request.size != 0 && body_framing(request.header, length, chunked) &&
+					length > this->_config.max_body_size)
+				{
+					this->_reject(connection, StatusCode::payload_too_large);
+					break;
+				}
+				connection.needed = request.size;
+				if (request.size == 0 && !rest.empty())
+				{
+					connection.parsed = rest.size();
+					if (connection.parser.parse(rest) == ParseStatus::ERROR)
+						this->_reject(connection, StatusCode::bad_request);
+				}
+				break;
+			}
+			connection.needed = 0;
+			if (status == ParseStatus::ERROR)
+			{
+				this->_reject(connection, StatusCode::bad_request);
+				break;
+			}
+
+			connection.keep_alive = keep_alive(request.header);
+			if (request.chunked)
+			{
+				connection.chunked_request = request.header.toOwned();
+				connection.chunked_body.clear();
+				connection.decoder.reset();
+				connection.in_chunked = true;
+				continue;
+			}
+			if (request.body.size() > this->_config.max_body_size)
+			{
+				this->_reject(connection, StatusCode::payload_too_large);
+				break;
+			}
+			this->_respond(connection, request.header.toOwned(), request.body);
+			handled = true;
+		}
+
+		// keep the unfinished request at the front of the buffer
+		const std::size_t consumed = pipeline.consumed();
+		if (connection.closing)
+			connection.input_size = 0;
+		else if (consumed != 0)
+		{
+			std::memmove(connection.input.data(), connection.input.data() + consumed,
+						 connection.input_size - consumed);
+			connection.input_size -= consumed;
+		}
+		return handled || connection.output_size >= this->_config.max_pending_output;
+	}
+
+	void HttpServer::_respond(_Connection &connection, HttpRequestHeader request, std::string_view body)
+	{
+		if (!connection.keep_alive)
+			connection.closing = true;
+		const bool head   = request.getType() == HttpRequestHeader::RequestType::HEAD;
+		const bool http10 = request.getHttpVersion() < std::make_pair(1, 1);
+		if (this->_config.executor == nullptr)
+		{
+			this->_finish(connection, this->_handler(request, body), head, http10);
+			return;
+		}
+
+		// the body is copied, the read buffer moves on before the handler runs
+		connection.offloaded = true;
+		this->_offloaded.fetch_add(1, std::memory_order_relaxed);
+		this->_config.executor->submit(
+			[this, &connection, request = std::move(request), body = std::string{body}, head, http10]
+			{
+				_Completion completion{&connection, this->_handler(request, body), head, http10};
+				while (!this->_completions.tryPush(std::move(completion)))
+					std::this_thread::yield();
+				this->_wake();
+				this->_offloaded.fetch_sub(1, std::memory_order_release);
+			});
+	}
+
+	void HttpServer::_finish(_Connection &connection, HttpResponse &&response, bool head, bool http10)
+	{
+		HttpResponse &queued = connection.responses.emplace_back(std::move(response));
+		this->_requests.fetch_add(1, std::memory_order_relaxed);
+		if (!connection.closing && http10 && !queued.header.getHeaders().contains(HeaderId::CONNECTION))
+			queued.header.addHeader(HeaderId::CONNECTION, "keep-alive");
+		this->_queue(connection, queued, head);
+	}
+
+	void HttpServer::_complete()
+	{
+		_Completion completion{};
+		while (this->_completions.tryPop(completion))
+		{
+			_Connection &connection = *completion.connection;
+			connection.offloaded    = false;
+			if (connection.closed)
+			{
+				this->_close(connection);
+				continue;
+			}
+			this->_finish(connection, std::move(completion.response), completion.head, completion.http10);
+			if (this->_ring != nullptr)
+				this->_driveUring(connection);
+			else
+				this->_drive(connection);
+		}
+	}
+
+	void HttpServer::_reject(_Connection &connection, HttpResponseHeader::StatusCode status)
+	{
+		PHASE2_LOG(DEBUG, SERVER) << "HttpServer: rejecting a request with " << static_cast<unsigned>(status);
+		HttpResponse &response = connection.responses.emplace_back();
+		response.header.setStatus(status);
+		connection.closing = true;
+		this->_queue(connection, response, false);
+	}
+
+	void HttpServer::_queue(_Connection &connection, HttpResponse &response, bool head)
+	{
+		HttpResponseHeader &header = response.header;
+		if (header.getStatus() != StatusCode::unknown && header.getHttpVersion().first < 0)
+			header.setHttpVersion(1, 1);
+		if (!header)
+		{
+			PHASE2_LOG(ERROR, SERVER) << "HttpServer: the handler returned an invalid response";
+			header = HttpResponseHeader{};
+			header.setHttpVersion(1, 1);
+			header.setStatus(StatusCode::internal_server_error);
+			response.body.clear();
+			connection.closing = true;
+		}
+
+		const HeaderMap &fields = header.getHeaders();
+		if (!fields.contains(HeaderId::CONTENT_LENGTH) && !fields.contains(HeaderId::TRANSFER_ENCODING))
+			header.addHeader(HeaderId::CONTENT_LENGTH, std::to_string(response.body.size()));
+		if (connection.closing)
+			header.addHeader(HeaderId::CONNECTION, "close");
+
+		const std::size_t first = connection.iov.size();
+		header.serialize(connection.iov);
+		if (!head && !response.body.empty())
+			connection.iov.push_back(iovec{response.body.data(), response.body.size()});
+		for (std::size_t i = first; i < connection.iov.size(); ++i)
+			connection.output_size += connection.iov[i].iov_len;
+	}
+
+	bool HttpServer::_flush(_Connection &connection)
+	{
+		while (connection.iov_first < connection.iov.size())
+		{
+			msghdr message{};
+			message.msg_iov    = connection.iov.data() + connection.iov_first;
+			message.msg_iovlen = std::min(_MAX_SEGMENTS, connection.iov.size() - connection.iov_first);
+			const ssize_t sent = ::sendmsg(connection.fd, &message, MSG_NOSIGNAL);
+			if (sent < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					return true;
+				PHASE2_LOG(DEBUG, SERVER) << "HttpServer: write failed: " << std::strerror(errno);
+				this->_close(connection);
+				return false;
+			}
+
+			this->_consume(connection, static_cast<std::size_t>(sent));
+		}
+		return true;
+	}
+
+	void HttpServer::_consume(_Connection &connection, std::size_t size)
+	{
+		// skip the written segments and cut the partially written one
+		connection.output_size -= size;
+		while (size != 0)
+		{
+			iovec &segment = connection.iov[connection.iov_first];
+			if (size < segment.iov_len)
+			{
+				segment.iov_base = static_cast<char *>(segment.iov_base) + size;
+				segment.iov_len -= size;
+				break;
+			}
+			size -= segment.iov_len;
+			++connection.iov_first;
+		}
+
+		if (connection.iov_first == connection.iov.size())
+		{
+			connection.iov.clear();
+			connection.iov_first = 0;
+			connection.responses.clear();
+		}
+	}
+
+	bool HttpServer::_close(_Connection &connection)
+	{
+		if (connection.recv_armed || connection.sending || connection.offloaded || connection.deferred)
+		{
+			// the completions of the operations in flight come back first
+			if (!connection.closed)
+				::shutdown(connection.fd, SHUT_RDWR);
+			connection.closed = true;
+			return false;
+		}
+		::close(connection.fd);
+		// a grown buffer is dropped, so the spare ones stay small
+		if (connection.input.size() == this->_config.read_buffer_size &&
+			this->_spare_buffers.size() < _MAX_SPARE_BUFFERS)
+			this->_spare_buffers.push_back(std::move(connection.input));
+
+		// move the last connection into the slot of the closed one
+		const std::size_t index = connection.index;
+		if (index + 1 != this->_connections.size())
+		{
+			this->_connections[index]        = std::move(this->_connections.back());
+			this->_connections[index]->index = index;
+		}
+		this->_connections.pop_back();
+		return true;
+	}
+
+	bool HttpServer::_runUring()
+	{
+		this->_ring = std::make_unique<IoUring>(_RING_ENTRIES);
+		if (!*this->_ring ||
+			!this->_ring->registerBuffers(_BUFFER_GROUP, this->_config.ring_buffers, this->_config.read_buffer_size))
+		{
+			PHASE2_LOG(WARNING, SERVER) << "HttpServer: cannot set up io_uring, falling back to epoll";
+			this->_ring.reset();
+			this->_backend = ServerBackend::EPOLL;
+			return this->_runEpoll();
+		}
+
+		IoUring &ring = *this->_ring;
+		this->_armAccept();
+		this->_armWake();
+
+		bool result = true;
+		while (!this->_stopping.load(std::memory_order_acquire))
+		{
+			// deferred operations only wait for the completions already there
+			const bool deferred = this->_accept_deferred || this->_wake_deferred || !this->_deferred.empty();
+			if (ring.submit(deferred ? 0 : 1) < 0 && errno != EINTR && errno != EBUSY)
+			{
+				PHASE2_LOG(ERROR, SERVER) << "HttpServer: io_uring_enter failed: " << std::strerror(errno);
+				result = false;
+				break;
+			}
+
+			for (const io_uring_cqe *cqe = ring.peekCqe(); cqe != nullptr; cqe = ring.peekCqe())
+			{
+				const std::uint64_t data = cqe->user_data;
+				const int res            = cqe->res;
+				const unsigned flags     = cqe->flags;
+				ring.seenCqe();
+
+				_Connection *connection = reinterpret_cast<_Connection *>(data & ~_OP_MASK);
+				switch (data & _OP_MASK)
+				{
+				case _OP_ACCEPT:
+					if (res >= 0)
+						this->_armRecv(this->_open(res));
+					else if (res != -ECANCELED)
+						PHASE2_LOG(WARNING, SERVER) << "HttpServer: accept failed: " << std::strerror(-res);
+					if ((flags & IORING_CQE_F_MORE) == 0 && !this->_stopping.load(std::memory_order_relaxed))
+						this->_armAccept();
+					break;
+				case _OP_WAKE:
+					if (!this->_stopping.load(std::memory_order_relaxed))
+					{
+						// drain the eventfd before the queue, a later completion wakes again
+						std::uint64_t value;
+						while (::read(this->_wake_fd, &value, sizeof(value)) > 0)
+							;
+						this->_complete();
+						this->_armWake();
+					}
+					break;
+				case _OP_RECV:
+					this->_onRecv(*connection, res, flags);
+					break;
+				case _OP_SEND:
+					this->_onSend(*connection, res);
+					break;
+				default:
+					break;
+				}
+			}
+			this->_retryDeferred();
+		}
+
+		// closing the ring cancels the operations in flight
+		this->_ring.reset();
+		for (const std::unique_ptr<_Connection> &connection : this->_connections)
+			connection->recv_armed = connection->sending = connection->deferred = false;
+		this->_deferred.clear();
+		this->_accept_deferred = this->_wake_deferred = false;
+		return result;
+	}
+
+	void HttpServer::_armAccept()
+	{
+		io_uring_sqe *sqe = this->_ring->getSqe();
+		if (sqe == nullptr)
+		{
+			this->_accept_deferred = true;
+			return;
+		}
+		sqe->opcode       = IORING_OP_ACCEPT;
+		sqe->fd           = this->_listen_fd;
+		sqe->ioprio       = IORING_ACCEPT_MULTISHOT;
+		sqe->accept_flags = SOCK_CLOEXEC;
+		sqe->user_data    = _OP_ACCEPT;
+	}
+
+	void HttpServer::_armWake()
+	{
+		// the eventfd is non-blocking, so it is polled rather than read
+		io_uring_sqe *sqe = this->_ring->getSqe();
+		if (sqe == nullptr)
+		{
+			this->_wake_deferred = true;
+			return;
+		}
+		sqe->opcode        = IORING_OP_POLL_ADD;
+		sqe->fd            = this->_wake_fd;
+		sqe->poll32_events = POLLIN;
+		sqe->user_data     = _OP_WAKE;
+	}
+
+	void HttpServer::_armRecv(_Connection &connection)
+	{
+		io_uring_sqe *sqe = this->_ring->getSqe();
+		if (sqe == nullptr)
+		{
+			this->_defer(connection);
+			return;
+		}
+		sqe->opcode       = IORING_OP_RECV;
+		sqe->fd           = connection.fd;
+		sqe->ioprio       = IORING_RECV_MULTISHOT;
+		sqe->flags        = IOSQE_BUFFER_SELECT;
+		sqe->buf_group    = _BUFFER_GROUP;
+		sqe->user_data    = reinterpret_cast<std::uintptr_t>(&connection) | _OP_RECV;
+
+		connection.recv_armed = true;
+		connection.paused     = false;
+	}
+
+	void HttpServer::_cancelRecv(_Connection &connection)
+	{
+		io_uring_sqe *sqe = this->_ring->getSqe();
+		if (sqe == nullptr)
+		{
+			this->_defer(connection);
+			return;
+		}
+		sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+		sqe->addr         = reinterpret_cast<std::uintptr_t>(&connection) | _OP_RECV;
+		sqe->user_data    = _OP_CANCEL;
+
+		connection.paused = true;
+	}
+
+	void HttpServer::_send(_Connection &connection)
+	{
+		io_uring_sqe *sqe = this->_ring->getSqe();
+		if (sqe == nullptr)
+		{
+			this->_defer(connection);
+			return;
+		}
+
+		// the kernel reads the segments of a copy, the queue may grow meanwhile
+		const std::size_t count = std::min(_MAX_SEGMENTS, connection.iov.size() - connection.iov_first);
+		connection.sending_iov.assign(connection.iov.begin() + connection.iov_first,
+									  connection.iov.begin() + connection.iov_first + count);
+		connection.message            = msghdr{};
+		connection.message.msg_iov    = connection.sending_iov.data();
+		connection.message.msg_iovlen = count;
+
+		sqe->opcode       = IORING_OP_SENDMSG;
+		sqe->fd           = connection.fd;
+		sqe->addr         = reinterpret_cast<std::uintptr_t>(&connection.message);
+		sqe->msg_flags    = MSG_NOSIGNAL;
+		sqe->user_data    = reinterpret_cast<std::uintptr_t>(&connection) | _OP_SEND;
+
+		connection.sending = true;
+	}
+
+	void HttpServer::_defer(_Connection &connection)
+	{
+		if (connection.deferred)
+			return;
+		connection.deferred = true;
+		this->_deferred.push_back(&connection);
+	}
+
+	void HttpServer::_retryDeferred()
+	{
+		if (std::exchange(this->_accept_deferred, false))
+			this->_armAccept();
+		if (std::exchange(this->_wake_deferred, false))
+			this->_armWake();
+
+		// the connections deferred again go to the next round
+		std::vector<_Connection *> deferred;
+		deferred.swap(this->_deferred);
+		for (_Connection *connection : deferred)
+		{
+			connection->deferred = false;
+			this->_driveUring(*connection);
+		}
+	}
+
+	void HttpServer::_onRecv(_Connection &connection, int result, unsigned flags)
+	{
+		if ((flags & IORING_CQE_F_MORE) == 0)
+			connection.recv_armed = false;
+
+		if (result > 0)
+		{
+			const std::uint16_t id  = static_cast<std::uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+			const std::size_t size  = connection.input_size + static_cast<std::size_t>(result);
+			const std::size_t limit = this->_config.max_header_size + this->_config.max_body_size;
+			if (size > limit && !connection.closing)
+				this->_reject(connection, StatusCode::payload_too_large);
+			else if (!connection.closing && !connection.closed)
+			{
+				if (size > connection.input.size())
+					connection.input.resize(std::min(std::max(connection.input.size() * 2, size), limit));
+				std::memcpy(connection.input.data() + connection.input_size, this->_ring->buffer(id),
+							static_cast<std::size_t>(result));
+				connection.input_size = size;
+			}
+			this->_ring->recycleBuffer(id);
+		}
+		else if (result == 0)
+			connection.eof = true;
+		else if (result != -ENOBUFS && result != -ECANCELED)
+		{
+			PHASE2_LOG(DEBUG, SERVER) << "HttpServer: recv failed: " << std::strerror(-result);
+			if (this->_close(connection))
+				return;
+		}
+		this->_driveUring(connection);
+	}
+
+	void HttpServer::_onSend(_Connection &connection, int result)
+	{
+		connection.sending = false;
+		if (result < 0)
+		{
+			PHASE2_LOG(DEBUG, SERVER) << "HttpServer: send failed: " << std::strerror(-result);
+			if (this->_close(connection))
+				return;
+		}
+		else
+			this->_consume(connection, static_cast<std::size_t>(result));
+		this->_driveUring(connection);
+	}
+
+	void HttpServer::_driveUring(_Connection &connection)
+	{
+		if (connection.closed)
+		{
+			this->_close(connection);
+			return;
+		}
+
+		this->_process(connection);
+		if (connection.iov_first < connection.iov.size())
+		{
+			if (!connection.sending)
+				this->_send(connection);
+		}
+		else if ((connection.closing || connection.eof) && !connection.offloaded)
+		{
+			this->_close(connection);
+			return;
+		}
+
+		// pause receiving above the high-water mark, or while the next requests
+		// wait for an offloaded one, and resume below it
+		if (connection.output_size >= this->_config.max_pending_output ||
+			(connection.offloaded && connection.input_size >= this->_config.read_buffer_size))
+		{
+			if (connection.recv_armed && !connection.paused)
+				this->_cancelRecv(connection);
+		}
+		else if (!connection.recv_armed && !connection.eof && !connection.closing)
+			this->_armRecv(connection);
+	}
+
+	/**
+	 * @brief Get the CPUs the calling thread may run on.
+	 */
+	std::vector<int> _allowed_cpus()
+	{
+		std::vector<int> cpus;
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (::sched_getaffinity(0, sizeof(set), &set) == 0)
+			for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+				if (CPU_ISSET(cpu, &set))
+					cpus.push_back(cpu);
+		return cpus;
+	}
+
+	ShardedHttpServer::ShardedHttpServer(HttpServer::Handler handler, ServerConfig config, std::size_t shards,
+										 bool pin_cpus)
+		: _servers{}
+	{
+		const std::vector<int> cpus = _allowed_cpus();
+		if (shards == 0)
+			shards = std::max<std::size_t>(cpus.size(), 1);
+
+		config.reuse_port = true;
+		for (std::size_t i = 0; i < shards; ++i)
+		{
+			if (pin_cpus && !cpus.empty())
+				config.cpu = cpus[i % cpus.size()];
+			this->_servers.push_back(std::make_unique<HttpServer>(handler, config));
+		}
+	}
+
+	bool ShardedHttpServer::listen(const std::string &address, std::uint16_t port)
+	{
+		// the first shard picks the port if it is 0, the others join it
+		for (const std::unique_ptr<HttpServer> &server : this->_servers)
+		{
+			if (!server->listen(address, port))
+				return false;
+			port = server->port();
+		}
+		return true;
+	}
+
+	std::uint16_t ShardedHttpServer::port() const noexcept
+	{
+		return this->_servers.front()->port();
+	}
+
+	std::size_t ShardedHttpServer::shards() const noexcept
+	{
+		return this->_servers.size();
+	}
+
+	HttpServer &ShardedHttpServer::shard(std::size_t index) noexcept
+	{
+		return *this->_servers[index];
+	}
+
+	bool ShardedHttpServer::run()
+	{
+		std::vector<std::thread> threads;
+		std::vector<char> results(this->_servers.size(), false);
+		// a failed shard stops the others, so run() returns and reports it
+		for (std::size_t i = 1; i < this->_servers.size(); ++i)
+			threads.emplace_back(
+				[this, &results, i]
+				{
+					results[i] = this->_servers[i]->run();
+					if (!results[i])
+						this->stop();
+				});
+		results[0] = this->_servers[0]->run();
+		if (!results[0])
+			this->stop();
+		for (std::thread &thread : threads)
+			thread.join();
+		return std::all_of(results.begin(), results.end(), [](char result) { return result != 0; });
+	}
+
+	void ShardedHttpServer::stop() noexcept
+	{
+		for (const std::unique_ptr<HttpServer> &server : this->_servers)
+			server->stop();
+	}
+
+	std::uint64_t ShardedHttpServer::requests() const noexcept
+	{
+		std::uint64_t requests = 0;
+		for (const std::unique_ptr<HttpServer> &server : this->_servers)
+			requests += server->requests();
+		return requests;
+	}
+
+} // namespace phase2
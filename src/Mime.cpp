@@ -1,289 +1,320 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include <magic.h>
 
 #include <phase2/Mime.hpp>
-#ifndef NDEBUG
+#include <phase2/utils/HeaderMap.hpp>
 #include <phase2/utils/Log.hpp>
-#endif
 
 namespace phase2
 {
 
-	// clang-format off
 	/**
-	 * @brief Convert the binary file extension to its MIME type.
-	 * 
-	 * @param ext the extension of the file, without the dot.
-	 * @return The MIME type of the file extension.
+	 * @brief An entry of the extension table.
 	 */
-    std::string _check_binary_mime(std::string_view ext)
-    {
-        switch (ext.size())
-        {
-        case 2:
-            switch (ext.front())
-            {
-			case '7':
-				if (ext[1] == 'z')                  return "application/x-7z-compressed";
-				break; 
-			case 'r':
-				if (ext[1] == 'a')                  return "audio/x-realaudio";
-				break;
-            case 't':
-                if (ext[1] == 's')                  return "video/mp2t";
-                break;
-            default:
-                break;
-            }
-			break;
-        case 3:
-            switch (ext.front())
-            {
-			case '3':
-				if (ext[1] == 'g')
-				{
-					if (ext[2] == 'p')              return "video/3gpp";
-					if (ext[2] == '2')              return "video/3gpp2";
-				}
-				break;
-            case 'a':
-                if (ext[1] == 'a' && ext[2] == 'c') return "audio/aac";
-                break;
-            case 'b':
-				if (ext[1] == 'b' && ext[2] == 'p') return "image/bmp";
-                if (ext[1] == 'z' && ext[2] == '2') return "application/x-bzip2";
-				break;
-			case 'f':
-				if (ext[1] == 'l' && ext[2] == 'v') return "video/x-flv";
-				break;
-            case 'g':
-                if (ext[1] == 'i' && ext[2] == 'f') return "image/gif";
-				break;
-			case 'i':
-				if (ext[1] == 'c' && ext[2] == 'o') return "image/x-icon";
-				break;
-            case 'j':
-				if (ext[1] == 'a' && ext[2] == 'r') return "application/java-archive";
-                if (ext[1] == 'p' && ext[2] == 'g') return "image/jpeg";
-				break;
-            case 'm':
-				if (ext[1] == '4' && ext[2] == 'a') return "audio/mp4";
-                if (ext[1] == 'i' && ext[2] == 'd') return "audio/midi";
-				if (ext[1] == 'k' && ext[2] == 'v') return "video/x-matroska";
-				if (ext[1] == 'o' && ext[2] == 'v') return "video/quicktime";
-                if (ext[1] == 'p')
-                {
-                    if (ext[2] == '3')              return "audio/mpeg";
-                    if (ext[2] == '4')              return "video/mp4";
-                }
-                break;
-            case 'o':
-                if (ext[1] == 'g')
-                {
-                    if (ext[2] == 'a')              return "audio/ogg";
-                    if (ext[2] == 'g')              return "vidio/ogg";
-                    if (ext[2] == 'v')              return "vidio/ogg";
-                }
-				break;
-			case 'p':
-				if (ext[1] == 'd' && ext[2] == 'f') return "application/pdf";
-				break;
-			case 'r':
-				if (ext[1] == 'a' && ext[2] == 'r') return "application/vnd.rar";
-				break;
-			case 's':
-				if (ext[1] == 'w' && ext[2] == 'f') return "application/x-shockwave-flash";
-				break;
-			case 't':
-				if (ext[1] == 'a' && ext[2] == 'r') return "application/x-tar";
-				if (ext[1] == 'i' && ext[2] == 'f') return "image/tiff";
-				if (ext[1] == 't' && ext[2] == 'f') return "font/ttf";
-				break;
-			case 'w':
-				if (ext[1] == 'a' && ext[2] == 'v') return "audio/wav";
-				if (ext[1] == 'm' && ext[2] == 'v') return "video/x-ms-wmv";
-				break;
-			case 'x':
-				if (ext[1] == 'b' && ext[2] == 'm') return "image/xbm";
-				break;
-			case 'z':
-				if (ext[1] == 'i' && ext[2] == 'p') return "application/zip";
-				break;
-			default:
-				break;
-            }
-			break;
-		case 4:
-			switch (ext.front())
-			{
-			case 'a':
-				if (ext.substr(1) == "png")         return "image/apng";
-				if (ext.substr(1) == "vif")         return "image/avif";
-				break;
-			case 'e':
-				if (ext.substr(1) == "pub")         return "application/epub+zip";
-				break;
-			case 'j':
-				if (ext.substr(1) == "peg")         return "image/jpeg";
-				break;
-			case 'm':
-				if (ext.substr(1) == "idi")         return "audio/midi";
-				if (ext.substr(1) == "peg")         return "video/mpeg";
-				if (ext.substr(1) == "pkg")         return "application/vnd.apple.installer+xml";
-				break;
-			case 'o':
-				if (ext.substr(1) == "pus")         return "audio/opus";
-				break;
-			case 't':
-				if (ext.substr(1) == "iff")         return "image/tiff";
-				break;
-			case 'w':
-				if (ext[1] == 'e' && ext[2] == 'b')
-				{
-					if (ext[3] =='a')               return "audio/webm";
-					if (ext[3] =='m')               return "video/webm";
-					if (ext[3] =='p')               return "audio/webp";
-				}
-				if (ext.substr(1) == "off")         return "font/woff";
-				break;
-			default:
-				break;
-			}
-			break;
-		case 5:
-			if (ext == "woff2")                     return "font/woff2";
-			break;
-		default:
-			break;
-        }
-
-		return "";
-    }
-
-    /**
-     * @brief Convert the text file extension to its MIME type.
-     *
-     * @param ext the extension of the file, without the dot.
-     * @return The MIME type of the file extension.
-     */
-    std::string _check_text_mime(std::string_view ext)
-    {
-        switch (ext.size())
-        {
-		case 2:
-			switch(ext.front())
+	struct _MimeEntry
+	{
+		std::string_view extension;
+		std::string_view type;
+		bool textual;
+	};
+
+	/**
+	 * @brief The extension table, generated from data/mime.types at build time.
+	 */
+	constexpr _MimeEntry _mime_entries[] = {
+#include "MimeTypes.inc"
+	};
+
+	constexpr std::size_t _MIME_ENTRY_COUNT = sizeof(_mime_entries) / sizeof(_mime_entries[0]);
+	constexpr unsigned int _MIME_HASH_BITS  = 12;
+
+	/**
+	 * @brief Hash an extension with FNV-1a, folding ASCII letters to lowercase.
+	 */
+	constexpr std::uint32_t _mime_key(std::string_view extension) noexcept
+	{
+		std::uint32_t key = 2166136261u;
+		for (char c : extension)
+			key = (key ^ static_cast<unsigned char>(c >= 'A' && c <= 'Z' ? c | 0x20 : c)) * 16777619u;
+		return key;
+	}
+
+	constexpr std::uint32_t _mime_slot(std::uint32_t key, std::uint32_t seed) noexcept
+	{
+		return (key * seed) >> (32 - _MIME_HASH_BITS);
+	}
+
+	/**
+	 * @brief Search a multiplier that maps every extension to a distinct slot.
+	 *
+	 * @return the multiplier, or 0 if none is found.
+	 */
+	constexpr std::uint32_t _find_mime_seed() noexcept
+	{
+		for (std::uint32_t seed = 0x9e3779b1; seed < 0x9e3779b1 + 0x2000; seed += 2)
+		{
+			bool used[1 << _MIME_HASH_BITS]{};
+			bool perfect = true;
+			for (std::size_t i = 0; i < _MIME_ENTRY_COUNT && perfect; ++i)
 			{
-			case 'j':
-				if (ext[1] == 's')                  return "application/javascript";
-				break;
-			case 's':
-				if (ext[1] == 'h')                  return "application/x-sh";
-				break;
-			case 't':
-				if (ext[1] == 's')                  return "application/typescript";
-				break;
-			default:
-				break;
+				std::uint32_t slot = _mime_slot(_mime_key(_mime_entries[i].extension), seed);
+				perfect            = !used[slot];
+				used[slot]         = true;
 			}
-			break;
-		case 3:
-			switch(ext.front())
+			if (perfect)
+				return seed;
+		}
+		return 0;
+	}
+
+	constexpr std::uint32_t _mime_seed = _find_mime_seed();
+	static_assert(_mime_seed != 0, "no perfect hash for data/mime.types, widen _MIME_HASH_BITS");
+
+	/**
+	 * @brief Slots of the extension table, storing the entry index + 1, 0 for
+	 * empty slots.
+	 */
+	constexpr std::array<std::uint16_t, 1 << _MIME_HASH_BITS> _make_mime_table() noexcept
+	{
+		std::array<std::uint16_t, 1 << _MIME_HASH_BITS> table{};
+		for (std::size_t i = 0; i < _MIME_ENTRY_COUNT; ++i)
+			table[_mime_slot(_mime_key(_mime_entries[i].extension), _mime_seed)] = static_cast<std::uint16_t>(i + 1);
+		return table;
+	}
+
+	constexpr std::array<std::uint16_t, 1 << _MIME_HASH_BITS> _mime_table = _make_mime_table();
+
+	/**
+	 * @brief Find the entry of an extension.
+	 *
+	 * @param extension the extension of the file, without the dot.
+	 * @return the entry, or nullptr if the extension is unknown.
+	 */
+	const _MimeEntry *_find_mime_entry(std::string_view extension) noexcept
+	{
+		if (extension.empty())
+			return nullptr;
+
+		const std::uint16_t index = _mime_table[_mime_slot(_mime_key(extension), _mime_seed)];
+		if (index == 0 || !CaseInsensitiveEqual{}(extension, _mime_entries[index - 1].extension))
+			return nullptr;
+		return &_mime_entries[index - 1];
+	}
+
+	/**
+	 * @brief Get the extension of a path without the dot.
+	 */
+	std::string_view _extension_of(const std::filesystem::path &path) noexcept
+	{
+		std::string_view native = path.native();
+		const std::size_t dot   = native.find_last_of("./");
+		if (dot == native.npos || native[dot] != '.' || dot == 0 || native[dot - 1] == '/')
+			return {};
+		return native.substr(dot + 1);
+	}
+
+	std::string_view get_mime_by_extension(std::string_view extension) noexcept
+	{
+		const _MimeEntry *entry = _find_mime_entry(extension);
+		return entry != nullptr ? entry->type : std::string_view{};
+	}
+
+	/**
+	 * @brief The database selected by init_mime, empty for the default one.
+	 */
+	std::string _database_path;
+	std::mutex _database_mutex;
+
+	/**
+	 * @brief Bumped every time the database changes, so the handles know when
+	 * to reload. Handles start at 0, which forces the first load.
+	 */
+	std::atomic<unsigned> _database_generation{1};
+
+	/**
+	 * @brief Open a libmagic cookie and load a database into it.
+	 *
+	 * @param database the path of the database, empty for the default one.
+	 * @return the cookie, or nullptr if the database cannot be loaded.
+	 */
+	::magic_t _open_magic(const std::string &database)
+	{
+		::magic_t cookie = ::magic_open(MAGIC_MIME_TYPE);
+		if (cookie == nullptr)
+		{
+			PHASE2_LOG(ERROR, MIME) << "get_mime: unable to initialize magic library";
+			return nullptr;
+		}
+		if (::magic_load(cookie, database.empty() ? nullptr : database.c_str()) < 0)
+		{
+			PHASE2_LOG(ERROR, MIME) << "get_mime: unable to load magic database "
+									<< (database.empty() ? "(default)" : database);
+			::magic_close(cookie);
+			return nullptr;
+		}
+		return cookie;
+	}
+
+	/**
+	 * @brief A libmagic cookie owned by one thread. libmagic cookies are not
+	 * thread-safe, so every thread loads its own copy of the database.
+	 */
+	class _MagicHandle
+	{
+	public:
+		_MagicHandle() noexcept : _cookie{nullptr}, _generation{0} {}
+
+		_MagicHandle(const _MagicHandle &)            = delete;
+		_MagicHandle &operator=(const _MagicHandle &) = delete;
+
+		~_MagicHandle()
+		{
+			if (this->_cookie != nullptr)
+				::magic_close(this->_cookie);
+		}
+
+		/**
+		 * @brief Get the cookie, loading the selected database first if the
+		 * handle is not loaded yet or the database has changed. A database
+		 * that fails to load is not tried again until it changes.
+		 *
+		 * @return the cookie, or nullptr if the database cannot be loaded.
+		 */
+		::magic_t get()
+		{
+			if (this->_generation == _database_generation.load(std::memory_order_acquire))
+				return this->_cookie;
+
+			std::string database;
+			unsigned generation;
 			{
-			case 'c':
-				if (ext[1] == 's')
-				{
-					if (ext[2] == 's')              return "text/css";
-					if (ext[2] == 'v')              return "text/csv";
-				}
-				break;
-			case 'h':
-				if (ext[1] == 't' && ext[2] == 'm') return "text/html";
-				break;
-			case 'm':
-				if (ext[1] == 'j' && ext[2] == 's') return "application/javascript";
-				break;
-			case 's':
-				if (ext[1] == 'v' && ext[2] == 'v') return "image/svg+xml";
-				break;
-			case 't':
-				if (ext[1] == 'x' && ext[2] == 't') return "text/plain";
-				break;
-			case 'x':
-				if (ext[1] == 'm' && ext[2] == 'l') return "application/xml";
-				break;
+				std::lock_guard<std::mutex> lock{_database_mutex};
+				database   = _database_path;
+				generation = _database_generation.load(std::memory_order_relaxed);
 			}
-			break;
-		case 4:
-			if (ext == "json")                      return "application/json";
-			break;
-        default:
-            break;
-        }
-
-		return "";
-    }
-	// clang-format on
-
-	std::string get_mime(const std::filesystem::path &path)
+			this->reset(_open_magic(database), generation);
+			return this->_cookie;
+		}
+
+		/**
+		 * @brief Replace the cookie by one loaded with a database.
+		 *
+		 * @param cookie the cookie, or nullptr if the database cannot be loaded.
+		 * @param generation the generation of the database.
+		 */
+		void reset(::magic_t cookie, unsigned generation) noexcept
+		{
+			if (this->_cookie != nullptr)
+				::magic_close(this->_cookie);
+			this->_cookie     = cookie;
+			this->_generation = generation;
+		}
+
+	private:
+		::magic_t _cookie;
+		unsigned _generation;
+	};
+
+	/**
+	 * @brief Get the libmagic handle of the calling thread.
+	 */
+	_MagicHandle &_thread_magic_handle()
 	{
-		::magic_t cookie = ::magic_open(MAGIC_MIME_TYPE);
+		thread_local _MagicHandle handle;
+		return handle;
+	}
+
+	bool init_mime(const std::filesystem::path &database)
+	{
+		// the database is published only once it loads, the handles keep the old one otherwise
+		::magic_t cookie = _open_magic(database.string());
 		if (cookie == nullptr)
+			return false;
+
+		unsigned generation;
 		{
-#ifndef NDEBUG
-			log_error << "get_mime: unable to initialize magic library";
-#endif
-			return "";
+			std::lock_guard<std::mutex> lock{_database_mutex};
+			_database_path = database.string();
+			generation     = _database_generation.fetch_add(1, std::memory_order_release) + 1;
 		}
+		_thread_magic_handle().reset(cookie, generation);
+		return true;
+	}
 
-		if (::magic_load(cookie, nullptr) < 0)
+	/**
+	 * @brief Replace a generic libmagic result by the type of the extension,
+	 * if the extension is of the same kind (binary or text).
+	 *
+	 * @param result the result of libmagic.
+	 * @param extension the extension of the file, without the dot.
+	 * @return The MIME type in string.
+	 */
+	std::string _refine_by_extension(std::string_view result, std::string_view extension)
+	{
+		const bool binary = result == "application/octet-stream";
+		if (binary || result == "text/plain")
 		{
-#ifndef NDEBUG
-			log_error << "get_mime: unable to load default magic database";
-#endif
-			::magic_close(cookie);
-			return "";
+			PHASE2_LOG(DEBUG, MIME) << "get_mime: result is unknown " << (binary ? "binary" : "text")
+									<< " form, start second decision by extension";
+			const _MimeEntry *entry = _find_mime_entry(extension);
+			if (entry != nullptr && entry->textual != binary)
+				result = entry->type;
+		}
+		return std::string{result};
+	}
+
+	std::string get_mime(const std::filesystem::path &path, MimeMode mode)
+	{
+		const std::string_view extension = _extension_of(path);
+		if (mode == MimeMode::EXTENSION)
+		{
+			const _MimeEntry *entry = _find_mime_entry(extension);
+			return std::string{entry != nullptr ? entry->type : "application/octet-stream"};
 		}
 
+		::magic_t cookie = _thread_magic_handle().get();
+		if (cookie == nullptr)
+			return "";
+
 		const char *result = ::magic_file(cookie, path.c_str());
 		if (result == nullptr)
 		{
-#ifndef NDEBUG
-			log_error << "get_mime: result is NULL";
-#endif
-			::magic_close(cookie);
+			PHASE2_LOG(ERROR, MIME) << "get_mime: result is NULL";
 			return "";
 		}
 
-		std::string result_str = result;
-		::magic_close(cookie);
+		return _refine_by_extension(result, extension);
+	}
 
-		if (path.has_extension())
+	std::string get_mime(const std::uint8_t *buf, std::size_t size, std::string_view extension)
+	{
+		::magic_t cookie = _thread_magic_handle().get();
+		if (cookie == nullptr)
+			return "";
+
+		const char *result = ::magic_buffer(cookie, buf, std::min(size, MIME_SNIFF_SIZE));
+		if (result == nullptr)
 		{
-			std::string_view extension{path.extension().string()};
-			extension.remove_prefix(1);
-			std::string result2;
-			if (result_str == "application/octet-stream")
-			{
-#ifndef NDEBUG
-				log_debug << "get_mime: result is unknown binary form, start second decision by extension";
-#endif
-				result2 = _check_binary_mime(extension);
-			}
-			else if (result_str == "text/plain")
-			{
-#ifndef NDEBUG
-				log_debug << "get_mime: result is unknown text form, start second decision by extension";
-#endif
-				result2 = _check_text_mime(extension);
-			}
-			if (!result2.empty())
-				result_str = std::move(result2);
+			PHASE2_LOG(ERROR, MIME) << "get_mime: result is NULL";
+			return "";
 		}
 
-		return result_str;
+		return _refine_by_extension(result, extension);
+	}
+
+	std::string get_mime(const std::vector<std::uint8_t> &buf, std::string_view extension)
+	{
+		return phase2::get_mime(buf.data(), buf.size(), extension);
 	}
 
 } // namespace phase2
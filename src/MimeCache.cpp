@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include <sys/stat.h>
+
+#include <phase2/Mime.hpp>
+#include <phase2/MimeCache.hpp>
+#include <phase2/utils/Log.hpp>
+
+namespace phase2
+{
+
+	MimeCache::MimeCache(std::size_t capacity, std::size_t shards)
+		: _shards{}, _shard_capacity{std::max<std::size_t>(capacity / std::max<std::size_t>(shards, 1), 1)}
+	{
+		shards = std::max<std::size_t>(shards, 1);
+		this->_shards.reserve(shards);
+		for (std::size_t i = 0; i < shards; ++i)
+			this->_shards.push_back(std::make_unique<_Shard>());
+	}
+
+	bool MimeCache::_Key::operator==(const _Key &other) const noexcept
+	{
+		return this->dev == other.dev && this->ino == other.ino && this->mtime_sec == other.mtime_sec &&
+			   this->mtime_nsec == other.mtime_nsec && this->size == other.size &&
+			   this->extension_type == other.extension_type;
+	}
+
+	std::size_t MimeCache::_KeyHash::operator()(const _Key &key) const noexcept
+	{
+		std::uint64_t hash = 0x9e3779b97f4a7c15;
+		for (std::uint64_t word : {static_cast<std::uint64_t>(key.dev), static_cast<std::uint64_t>(key.ino),
+								   static_cast<std::uint64_t>(key.mtime_sec), static_cast<std::uint64_t>(key.mtime_nsec),
+								   static_cast<std::uint64_t>(key.size),
+								   static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key.extension_type))})
+		{
+			hash = (hash ^ word) * 0xff51afd7ed558ccd;
+			hash ^= hash >> 32;
+		}
+		return static_cast<std::size_t>(hash);
+	}
+
+	MimeCache::_Shard &MimeCache::_shardOf(const _Key &key) noexcept
+	{
+		// the low bits of the hash pick the bucket inside the shard
+		return *this->_shards[(_KeyHash{}(key) >> 32) % this->_shards.size()];
+	}
+
+	std::string MimeCache::getMime(const std::filesystem::path &path)
+	{
+		struct ::stat st;
+		if (::stat(path.c_str(), &st) != 0)
+		{
+			PHASE2_LOG(DEBUG, MIME) << "MimeCache: unable to stat " << path.string() << ", skip the cache";
+			return phase2::get_mime(path);
+		}
+
+		const std::filesystem::path extension = path.extension();
+		std::string_view name                 = extension.native();
+		if (!name.empty())
+			name.remove_prefix(1);
+		const std::string_view type = get_mime_by_extension(name);
+		const _Key key{st.st_dev, st.st_ino, st.st_mtim.tv_sec, st.st_mtim.tv_nsec, st.st_size,
+					   type.empty() ? nullptr : type.data()};
+		_Shard &shard = this->_shardOf(key);
+		{
+			std::lock_guard<std::mutex> lock{shard.mutex};
+			auto it = shard.entries.find(key);
+			if (it != shard.entries.end())
+			{
+				shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+				shard.hits.fetch_add(1, std::memory_order_relaxed);
+				return it->second->second;
+			}
+		}
+
+		// sniff the file without holding the lock, another thread may insert
+		// the same file meanwhile
+		shard.misses.fetch_add(1, std::memory_order_relaxed);
+		std::string mime = phase2::get_mime(path);
+		if (mime.empty())
+			return mime;
+
+		std::lock_guard<std::mutex> lock{shard.mutex};
+		if (shard.entries.find(key) != shard.entries.end())
+			return mime;
+		if (shard.lru.size() >= this->_shard_capacity)
+		{
+			shard.entries.erase(shard.lru.back().first);
+			shard.lru.pop_back();
+		}
+		shard.lru.emplace_front(key, mime);
+		shard.entries.emplace(key, shard.lru.begin());
+		return mime;
+	}
+
+	void MimeCache::clear() noexcept
+	{
+		for (auto &shard : this->_shards)
+		{
+			std::lock_guard<std::mutex> lock{shard->mutex};
+			shard->entries.clear();
+			shard->lru.clear();
+		}
+	}
+
+	std::uint64_t MimeCache::getHits() const noexcept
+	{
+		std::uint64_t hits = 0;
+		for (const auto &shard : this->_shards)
+			hits += shard->hits.load(std::memory_order_relaxed);
+		return hits;
+	}
+
+	std::uint64_t MimeCache::getMisses() const noexcept
+	{
+		std::uint64_t misses = 0;
+		for (const auto &shard : this->_shards)
+			misses += shard->misses.load(std::memory_order_relaxed);
+		return misses;
+	}
+
+	std::size_t MimeCache::size() const noexcept
+	{
+		std::size_t size = 0;
+		for (const auto &shard : this->_shards)
+		{
+			std::lock_guard<std::mutex> lock{shard->mutex};
+			size += shard->lru.size();
+		}
+		return size;
+	}
+
+} // namespace phase2
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <phase2/Mime.hpp>
+#include <phase2/MimeCache.hpp>
+#include <phase2/MimeService.hpp>
+
+namespace phase2
+{
+
+	MimeService::MimeService(std::size_t threads, MimeCache *cache)
+		: _mutex{}, _cv{}, _jobs{}, _stopping{false}, _cache{cache}, _workers{}
+	{
+		threads = std::max<std::size_t>(threads, 1);
+		this->_workers.reserve(threads);
+		for (std::size_t i = 0; i < threads; ++i)
+			this->_workers.emplace_back(&MimeService::_run, this);
+	}
+
+	MimeService::~MimeService()
+	{
+		{
+			std::lock_guard<std::mutex> lock{this->_mutex};
+			this->_stopping = true;
+		}
+		this->_cv.notify_all();
+		for (std::thread &worker : this->_workers)
+			worker.join();
+	}
+
+	std::future<std::string> MimeService::submit(std::filesystem::path path)
+	{
+		_Job job{std::move(path), std::promise<std::string>{}, nullptr};
+		std::future<std::string> future = job.promise->get_future();
+		{
+			std::lock_guard<std::mutex> lock{this->_mutex};
+			this->_jobs.push_back(std::move(job));
+		}
+		this->_cv.notify_one();
+		return future;
+	}
+
+	std::vector<std::future<std::string>> MimeService::submit(const std::vector<std::filesystem::path> &paths)
+	{
+		std::vector<std::future<std::string>> futures;
+		futures.reserve(paths.size());
+		{
+			std::lock_guard<std::mutex> lock{this->_mutex};
+			for (const std::filesystem::path &path : paths)
+			{
+				this->_jobs.push_back(_Job{path, std::promise<std::string>{}, nullptr});
+				futures.push_back(this->_jobs.back().promise->get_future());
+			}
+		}
+		this->_cv.notify_all();
+		return futures;
+	}
+
+	void MimeService::submit(std::filesystem::path path, Callback callback)
+	{
+		{
+			std::lock_guard<std::mutex> lock{this->_mutex};
+			this->_jobs.push_back(_Job{std::move(path), std::nullopt, std::make_shared<Callback>(std::move(callback))});
+		}
+		this->_cv.notify_one();
+	}
+
+	void MimeService::submit(const std::vector<std::filesystem::path> &paths, Callback callback)
+	{
+		auto shared = std::make_shared<Callback>(std::move(callback));
+		{
+			std::lock_guard<std::mutex> lock{this->_mutex};
+			for (const std::filesystem::path &path : paths)
+				this->_jobs.push_back(_Job{path, std::nullopt, shared});
+		}
+		this->_cv.notify_all();
+	}
+
+	std::size_t MimeService::pending() const
+	{
+		std::lock_guard<std::mutex> lock{this->_mutex};
+		return this->_jobs.size();
+	}
+
+	void MimeService::_run()
+	{
+		while (true)
+		{
+			_Job job;
+			{
+				std::unique_lock<std::mutex> lock{this->_mutex};
+				this->_cv.wait(lock, [this] { return this->_stopping || !this->_jobs.empty(); });
+				if (this->_jobs.empty())
+					return;
+				job = std::move(this->_jobs.front());
+				this->_jobs.pop_front();
+			}
+
+			std::string mime =
+				this->_cache != nullptr ? this->_cache->getMime(job.path) : phase2::get_mime(job.path);
+			if (job.callback != nullptr)
+				(*job.callback)(job.path, std::move(mime));
+			else
+				job.promise->set_value(std::move(mime));
+		}
+	}
+
+} // namespace phase2
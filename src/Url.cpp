@@ -1,51 +1,324 @@
-#include <filesystem>
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <string>
 #include <utility>
+#include <vector>
 
-#include <phase2/Url.hpp>
+#include <sys/uio.h>
 
-#ifndef NDEBUG
+#include <phase2/Url.hpp>
 #include <phase2/utils/Log.hpp>
-#endif
+#include <phase2/utils/Scan.hpp>
 
 namespace phase2
 {
 
-	Url::Url() noexcept : _valid(false) {}
+	constexpr char _HEX_DIGITS[] = "0123456789ABCDEF";
 
-	Url::Url(std::string_view raw)
+	/**
+	 * @brief Convert a hexadecimal digit.
+	 *
+	 * @return the value, or -1 if c is not a hexadecimal digit.
+	 */
+	int _hex_value(char c) noexcept
 	{
-		std::size_t pos = raw.find('?');
-		if (pos == raw.npos)
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		c = static_cast<char>(c | 0x20);
+		if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		return -1;
+	}
+
+	bool percent_decode(std::string_view str, std::string &out, bool plus_as_space)
+	{
+		const char *first  = str.data();
+		const char *last   = first + str.size();
+		const char *escape = phase2::find_url_escape(first, last);
+		if (escape == last)
+		{
+			out.append(first, last);
+			return true;
+		}
+
+		// the decoded string is never longer than the encoded one
+		const std::size_t start = out.size();
+		out.resize(start + str.size());
+		char *dest = out.data() + start;
+		while (true)
+		{
+			std::memcpy(dest, first, static_cast<std::size_t>(escape - first));
+			dest += escape - first;
+			if (escape == last)
+				break;
+
+			if (*escape == '+')
+			{
+				*dest++ = plus_as_space ? ' ' : '+';
+				first   = escape + 1;
+			}
+			else
+			{
+				const int high = last - escape >= 3 ? _hex_value(escape[1]) : -1;
+				const int low  = high >= 0 ? _hex_value(escape[2]) : -1;
+				if (low < 0)
+				{
+					out.resize(static_cast<std::size_t>(dest - out.data()));
+					return false;
+				}
+				*dest++ = static_cast<char>(high << 4 | low);
+				first   = escape + 3;
+			}
+			escape = phase2::find_url_escape(first, last);
+		}
+		out.resize(static_cast<std::size_t>(dest - out.data()));
+		return true;
+	}
+
+	void percent_encode(std::string_view str, std::string &out, bool path)
+	{
+		const char *first  = str.data();
+		const char *last   = first + str.size();
+		const char *unsafe = phase2::find_url_unsafe(first, last, path);
+		if (unsafe == last)
 		{
-			this->_path  = raw;
-			this->_valid = true;
+			out.append(first, last);
 			return;
 		}
 
-		this->_path = raw.substr(0, pos);
-		raw.remove_prefix(pos + 1);
+		const std::size_t start = out.size();
+		out.resize(start + str.size() * 3);
+		char *dest = out.data() + start;
+		while (true)
+		{
+			std::memcpy(dest, first, static_cast<std::size_t>(unsafe - first));
+			dest += unsafe - first;
+			if (unsafe == last)
+				break;
 
-		while ((pos = raw.find('&')) != raw.npos)
+			const unsigned char c = static_cast<unsigned char>(*unsafe);
+			dest[0]               = '%';
+			dest[1]               = _HEX_DIGITS[c >> 4];
+			dest[2]               = _HEX_DIGITS[c & 0x0f];
+			dest += 3;
+			first  = unsafe + 1;
+			unsafe = phase2::find_url_unsafe(first, last, path);
+		}
+		out.resize(static_cast<std::size_t>(dest - out.data()));
+	}
+
+	/**
+	 * @brief The escapes of every byte, "%00%01...%FF", which the segments of
+	 * Url::serialize point into.
+	 */
+	constexpr std::array<char, 256 * 3> _ESCAPES = []
+	{
+		std::array<char, 256 * 3> escapes{};
+		for (std::size_t c = 0; c < 256; ++c)
 		{
-			std::string_view param = raw.substr(0, pos);
-			std::size_t equal      = param.find('=');
-			if (equal == param.npos)
-			{
-				this->_valid = false;
+			escapes[c * 3]     = '%';
+			escapes[c * 3 + 1] = _HEX_DIGITS[c >> 4];
+			escapes[c * 3 + 2] = _HEX_DIGITS[c & 0x0f];
+		}
+		return escapes;
+	}();
+
+	/**
+	 * @brief Append a string percent encoded as iovec segments, the runs of
+	 * safe bytes point into the string and every escape into _ESCAPES.
+	 */
+	void _append_encoded(std::string_view str, bool path, std::vector<iovec> &iov)
+	{
+		const char *first  = str.data();
+		const char *last   = first + str.size();
+		const char *unsafe = phase2::find_url_unsafe(first, last, path);
+		while (true)
+		{
+			if (unsafe != first)
+				iov.push_back(iovec{const_cast<char *>(first), static_cast<std::size_t>(unsafe - first)});
+			if (unsafe == last)
 				return;
-			}
-			this->setParam(param.substr(0, equal), param.substr(equal + 1));
-			raw.remove_prefix(pos + 1);
+			const char *escape = _ESCAPES.data() + static_cast<unsigned char>(*unsafe) * 3;
+			iov.push_back(iovec{const_cast<char *>(escape), 3});
+			first  = unsafe + 1;
+			unsafe = phase2::find_url_unsafe(first, last, path);
+		}
+	}
+
+	/**
+	 * @brief Check whether a path holds an escape of '/' or NUL, which would
+	 * change the segments of the path or cut it once decoded.
+	 */
+	bool _has_unsafe_escape(std::string_view path) noexcept
+	{
+		for (std::size_t pos = path.find('%'); pos != path.npos; pos = path.find('%', pos + 1))
+		{
+			const std::string_view escape = path.substr(pos + 1, 2);
+			if (escape == "00" || escape == "2F" || escape == "2f")
+				return true;
 		}
+		return false;
+	}
+
+	UrlView::ParamIterator::ParamIterator() noexcept : _rest{}, _param{}, _more{false}, _end{true} {}
+
+	UrlView::ParamIterator::ParamIterator(std::string_view query) noexcept
+		: _rest{query}, _param{}, _more{!query.empty()}, _end{false}
+	{
+		this->_parse();
+	}
+
+	UrlView::ParamIterator::reference UrlView::ParamIterator::operator*() const noexcept
+	{
+		return this->_param;
+	}
+
+	UrlView::ParamIterator::pointer UrlView::ParamIterator::operator->() const noexcept
+	{
+		return &this->_param;
+	}
+
+	UrlView::ParamIterator &UrlView::ParamIterator::operator++() noexcept
+	{
+		this->_parse();
+		return *this;
+	}
+
+	UrlView::ParamIterator UrlView::ParamIterator::operator++(int) noexcept
+	{
+		ParamIterator old = *this;
+		this->_parse();
+		return old;
+	}
+
+	bool UrlView::ParamIterator::operator==(const ParamIterator &other) const noexcept
+	{
+		// the name of a parameter points into the query string, so it tells the position
+		if (this->_end || other._end)
+			return this->_end == other._end;
+		return this->_param.name.data() == other._param.name.data();
+	}
 
-		std::size_t equal = raw.find('=');
-		if (equal == raw.npos)
+	bool UrlView::ParamIterator::operator!=(const ParamIterator &other) const noexcept
+	{
+		return !(*this == other);
+	}
+
+	void UrlView::ParamIterator::_parse() noexcept
+	{
+		if (!this->_more)
 		{
-			this->_valid = false;
+			this->_end = true;
 			return;
 		}
-		this->setParam(raw.substr(0, equal), raw.substr(equal + 1));
+
+		std::string_view param;
+		const std::size_t pos = this->_rest.find('&');
+		if (pos == this->_rest.npos)
+		{
+			param       = this->_rest;
+			this->_rest = {};
+			this->_more = false;
+		}
+		else
+		{
+			param = this->_rest.substr(0, pos);
+			this->_rest.remove_prefix(pos + 1);
+		}
+
+		const std::size_t equal = param.find('=');
+		if (equal == param.npos)
+			this->_param = Param{param, param.substr(param.size())};
+		else
+			this->_param = Param{param.substr(0, equal), param.substr(equal + 1)};
+	}
+
+	UrlView::UrlView() noexcept : _path{}, _query{} {}
+
+	UrlView::UrlView(std::string_view raw) noexcept : _path{raw}, _query{}
+	{
+		const std::size_t pos = raw.find('?');
+		if (pos == raw.npos)
+			return;
+
+		this->_path  = raw.substr(0, pos);
+		this->_query = raw.substr(pos + 1);
+	}
+
+	std::string_view UrlView::path() const noexcept
+	{
+		return this->_path;
+	}
+
+	std::string_view UrlView::query() const noexcept
+	{
+		return this->_query;
+	}
+
+	std::string_view UrlView::getParam(std::string_view param) const noexcept
+	{
+		for (const Param &p : this->params())
+		{
+			if (p.name == param)
+				return p.value;
+		}
+		return {};
+	}
+
+	UrlView::ParamRange UrlView::params() const noexcept
+	{
+		return ParamRange{ParamIterator{this->_query}, ParamIterator{}};
+	}
+
+	bool UrlView::isValid() const noexcept
+	{
+		std::string_view rest = this->_query;
+		while (!rest.empty())
+		{
+			const std::size_t pos        = rest.find('&');
+			const std::string_view param = rest.substr(0, pos);
+			if (param.find('=') == param.npos)
+				return false;
+			if (pos == rest.npos)
+				break;
+			rest.remove_prefix(pos + 1);
+			if (rest.empty())
+				return false;
+		}
+		return true;
+	}
+
+	Url UrlView::toOwned() const
+	{
+		return Url{*this};
+	}
+
+	Url::Url() noexcept : _valid(false) {}
+
+	Url::Url(std::string_view raw) : Url{UrlView{raw}} {}
+
+	Url::Url(const UrlView &view) : _valid{false}, _path{view.path()}, _params{}
+	{
+		if (_has_unsafe_escape(view.path()))
+		{
+			PHASE2_LOG(DEBUG, URL) << "escaped '/' or NUL in path " << view.path();
+			return;
+		}
+		std::string path;
+		if (!view.isValid() || !percent_decode(view.path(), path, false))
+			return;
+		this->_path = std::move(path);
+
+		for (const UrlView::Param &param : view.params())
+		{
+			Param &entry = this->_params.emplace_back();
+			if (!percent_decode(param.name, entry.name) || !percent_decode(param.value, entry.value))
+			{
+				PHASE2_LOG(DEBUG, URL) << "malformed percent escape in parameter " << param.name;
+				return;
+			}
+		}
 		this->_valid = true;
 	}
 
@@ -54,13 +327,30 @@ namespace phase2
 		this->_params.clear();
 	}
 
-	std::string Url::getParam(std::string_view param) const
+	std::string_view Url::getParam(std::string_view param) const noexcept
 	{
-		auto result = this->_params.find(std::string{param});
-		if (result == this->_params.cend())
-			return "";
+		for (const Param &entry : this->_params)
+		{
+			if (entry.name == param)
+				return entry.value;
+		}
+		return {};
+	}
 
-		return result->second;
+	std::vector<std::string_view> Url::getParams(std::string_view param) const
+	{
+		std::vector<std::string_view> values;
+		for (const Param &entry : this->_params)
+		{
+			if (entry.name == param)
+				values.emplace_back(entry.value);
+		}
+		return values;
+	}
+
+	const Url::ParamList &Url::getParams() const noexcept
+	{
+		return this->_params;
 	}
 
 	bool Url::isValid() const
@@ -70,43 +360,73 @@ namespace phase2
 
 	void Url::removeParam(std::string_view param)
 	{
-		auto result = this->_params.find(std::string{param});
-		if (result != this->_params.cend())
-			this->_params.erase(result);
+		auto it = std::remove_if(this->_params.begin(), this->_params.end(),
+								 [param](const Param &entry) { return entry.name == param; });
+		this->_params.erase(it, this->_params.end());
 	}
 
 	void Url::setParam(std::string_view param, std::string_view value)
 	{
-		this->_params[std::string{param}] = value;
+		auto it = std::find_if(this->_params.begin(), this->_params.end(),
+							   [param](const Param &entry) { return entry.name == param; });
+		if (it == this->_params.end())
+		{
+			this->addParam(param, value);
+			return;
+		}
+
+		it->value = value;
+		auto rest = std::remove_if(it + 1, this->_params.end(), [param](const Param &entry) { return entry.name == param; });
+		this->_params.erase(rest, this->_params.end());
+	}
+
+	void Url::addParam(std::string_view param, std::string_view value)
+	{
+		this->_params.emplace_back(Param{std::string{param}, std::string{value}});
 	}
 
-	std::filesystem::path Url::path() const noexcept
+	const std::string &Url::path() const noexcept
 	{
 		return this->_path;
 	}
 
-	void Url::path(const std::filesystem::path &p)
+	void Url::path(std::string_view p)
 	{
-		this->_valid = p.string().find('&') == std::string::npos;
+		this->_valid = p.find('&') == p.npos;
 		this->_path  = p;
 	}
 
 	std::string Url::string() const
 	{
-		std::string result = this->_path;
-		if (!this->_params.empty())
-			result.push_back('?');
-		for (const auto &param : this->_params)
+		std::string result;
+		percent_encode(this->_path, result, true);
+
+		char separator = '?';
+		for (const Param &param : this->_params)
 		{
-			result += param.first;
+			result.push_back(separator);
+			percent_encode(param.name, result);
 			result.push_back('=');
-			result += param.second;
-			result.push_back('&');
+			percent_encode(param.value, result);
+			separator = '&';
 		}
-		if (this->_params.size() > 1)
-			result.pop_back();
 
 		return result;
 	}
 
+	void Url::serialize(std::vector<iovec> &iov) const
+	{
+		_append_encoded(this->_path, true, iov);
+
+		const char *separator = "?";
+		for (const Param &param : this->_params)
+		{
+			iov.push_back(iovec{const_cast<char *>(separator), 1});
+			_append_encoded(param.name, false, iov);
+			iov.push_back(iovec{const_cast<char *>("="), 1});
+			_append_encoded(param.value, false, iov);
+			separator = "&";
+		}
+	}
+
 } // namespace phase2
@@ -0,0 +1,149 @@
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include <phase2/utils/HeaderId.hpp>
+#include <phase2/utils/HeaderMap.hpp>
+
+namespace phase2
+{
+
+	/**
+	 * @brief Canonical field names, indexed by HeaderId.
+	 */
+	constexpr std::array<std::string_view, HEADER_ID_COUNT> _header_names{
+		"",
+		"Accept",
+		"Accept-Charset",
+		"Accept-Encoding",
+		"Accept-Language",
+		"Accept-Ranges",
+		"Access-Control-Allow-Origin",
+		"Age",
+		"Allow",
+		"Authorization",
+		"Cache-Control",
+		"Connection",
+		"Content-Disposition",
+		"Content-Encoding",
+		"Content-Language",
+		"Content-Length",
+		"Content-Location",
+		"Content-Range",
+		"Content-Type",
+		"Cookie",
+		"Date",
+		"ETag",
+		"Expect",
+		"Expires",
+		"Forwarded",
+		"From",
+		"Host",
+		"If-Match",
+		"If-Modified-Since",
+		"If-None-Match",
+		"If-Range",
+		"If-Unmodified-Since",
+		"Keep-Alive",
+		"Last-Modified",
+		"Link",
+		"Location",
+		"Origin",
+		"Pragma",
+		"Proxy-Authenticate",
+		"Proxy-Authorization",
+		"Range",
+		"Referer",
+		"Retry-After",
+		"Server",
+		"Set-Cookie",
+		"Strict-Transport-Security",
+		"TE",
+		"Trailer",
+		"Transfer-Encoding",
+		"Upgrade",
+		"Upgrade-Insecure-Requests",
+		"User-Agent",
+		"Vary",
+		"Via",
+		"WWW-Authenticate",
+		"X-Forwarded-For",
+		"X-Forwarded-Proto",
+		"X-Requested-With",
+	};
+
+	constexpr unsigned int _HEADER_HASH_BITS = 8;
+
+	/**
+	 * @brief Pack the length and the first, middle and last bytes of a field
+	 * name into a key. Setting bit 5 folds ASCII letters to lowercase, other
+	 * bytes that collide are told apart by the final comparison.
+	 */
+	constexpr std::uint32_t _header_key(std::string_view field) noexcept
+	{
+		return static_cast<std::uint32_t>(field.size() & 0xff) |
+			   static_cast<std::uint32_t>(static_cast<unsigned char>(field.front()) | 0x20) << 8 |
+			   static_cast<std::uint32_t>(static_cast<unsigned char>(field[field.size() / 2]) | 0x20) << 16 |
+			   static_cast<std::uint32_t>(static_cast<unsigned char>(field.back()) | 0x20) << 24;
+	}
+
+	constexpr std::uint32_t _header_slot(std::uint32_t key, std::uint32_t seed) noexcept
+	{
+		return (key * seed) >> (32 - _HEADER_HASH_BITS);
+	}
+
+	/**
+	 * @brief Search a multiplier that maps every standard field name to a
+	 * distinct slot.
+	 *
+	 * @return the multiplier, or 0 if none is found.
+	 */
+	constexpr std::uint32_t _find_header_seed() noexcept
+	{
+		for (std::uint32_t seed = 0x9e3779b1; seed < 0x9e3779b1 + 0x20000; seed += 2)
+		{
+			bool used[1 << _HEADER_HASH_BITS]{};
+			bool perfect = true;
+			for (std::size_t id = 1; id < HEADER_ID_COUNT && perfect; ++id)
+			{
+				std::uint32_t slot = _header_slot(_header_key(_header_names[id]), seed);
+				perfect            = !used[slot];
+				used[slot]         = true;
+			}
+			if (perfect)
+				return seed;
+		}
+		return 0;
+	}
+
+	constexpr std::uint32_t _header_seed = _find_header_seed();
+	static_assert(_header_seed != 0, "no perfect hash for the standard header names, widen _HEADER_HASH_BITS");
+
+	constexpr std::array<HeaderId, 1 << _HEADER_HASH_BITS> _make_header_table() noexcept
+	{
+		std::array<HeaderId, 1 << _HEADER_HASH_BITS> table{};
+		for (std::size_t id = 1; id < HEADER_ID_COUNT; ++id)
+			table[_header_slot(_header_key(_header_names[id]), _header_seed)] = static_cast<HeaderId>(id);
+		return table;
+	}
+
+	constexpr std::array<HeaderId, 1 << _HEADER_HASH_BITS> _header_table = _make_header_table();
+
+	HeaderId to_header_id(std::string_view field) noexcept
+	{
+		if (field.empty())
+			return HeaderId::UNKNOWN;
+
+		HeaderId id = _header_table[_header_slot(_header_key(field), _header_seed)];
+		if (id == HeaderId::UNKNOWN || !CaseInsensitiveEqual{}(field, _header_names[static_cast<std::size_t>(id)]))
+			return HeaderId::UNKNOWN;
+		return id;
+	}
+
+	std::string_view to_string(HeaderId id) noexcept
+	{
+		return static_cast<std::size_t>(id) < HEADER_ID_COUNT ? _header_names[static_cast<std::size_t>(id)] : "";
+	}
+
+} // namespace phase2
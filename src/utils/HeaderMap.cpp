@@ -1,31 +1,88 @@
-#include <algorithm>
-#include <cctype>
-#include <functional>
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
 
 #include <phase2/utils/HeaderMap.hpp>
 
 namespace phase2
 {
 
+	constexpr std::uint64_t _ONES = 0x0101010101010101;
+
+	/**
+	 * @brief Load up to 8 bytes into a word, the missing bytes are zero.
+	 */
+	inline std::uint64_t _load_word(const char *data, std::size_t size) noexcept
+	{
+		std::uint64_t word = 0;
+		std::memcpy(&word, data, size);
+		return word;
+	}
+
+	/**
+	 * @brief Convert the ASCII uppercase letters in a word to lowercase,
+	 * 8 bytes at a time. Other bytes, including non-ASCII ones, are kept.
+	 */
+	inline std::uint64_t _ascii_lower(std::uint64_t word) noexcept
+	{
+		const std::uint64_t heptets  = word & (0x7f * _ONES);
+		const std::uint64_t above_z  = heptets + (0x7f - 'Z') * _ONES; // high bit set if > 'Z'
+		const std::uint64_t from_a   = heptets + (0x80 - 'A') * _ONES; // high bit set if >= 'A'
+		const std::uint64_t is_upper = ~word & (above_z ^ from_a) & (0x80 * _ONES);
+		return word | (is_upper >> 2);
+	}
+
+	inline bool _iequal_word(std::uint64_t lhs, std::uint64_t rhs) noexcept
+	{
+		return lhs == rhs || _ascii_lower(lhs) == _ascii_lower(rhs);
+	}
+
+	inline std::uint64_t _hash_word(std::uint64_t hash, std::uint64_t word) noexcept
+	{
+		hash = (hash ^ _ascii_lower(word)) * 0xff51afd7ed558ccd;
+		return hash ^ (hash >> 32);
+	}
+
 	bool CaseInsensitiveEqual::operator()(std::string_view lhs, std::string_view rhs) const
 	{
 		if (lhs.size() != rhs.size())
 			return false;
-		for (std::size_t i = 0; i < lhs.size(); ++i)
-			if (std::tolower(static_cast<unsigned char>(lhs.at(i))) !=
-				std::tolower(static_cast<unsigned char>(rhs.at(i))))
+
+		const char *a    = lhs.data();
+		const char *b    = rhs.data();
+		std::size_t size = lhs.size();
+		for (; size >= 16; a += 16, b += 16, size -= 16)
+			if (!_iequal_word(_load_word(a, 8), _load_word(b, 8)) ||
+				!_iequal_word(_load_word(a + 8, 8), _load_word(b + 8, 8)))
 				return false;
-		return true;
+		if (size >= 8)
+		{
+			if (!_iequal_word(_load_word(a, 8), _load_word(b, 8)))
+				return false;
+			a += 8, b += 8, size -= 8;
+		}
+		return _iequal_word(_load_word(a, size), _load_word(b, size));
 	}
 
 	std::size_t CaseInsensitiveHash::operator()(std::string_view str) const
 	{
-		std::string tmp;
-		tmp.reserve(str.size());
-		for (const char &c : str)
-			tmp.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
-		return std::hash<std::string>()(tmp);
+		const char *data   = str.data();
+		std::size_t size   = str.size();
+		std::uint64_t hash = 0x9e3779b97f4a7c15 ^ size;
+		for (; size >= 16; data += 16, size -= 16)
+			hash = _hash_word(_hash_word(hash, _load_word(data, 8)), _load_word(data + 8, 8));
+		if (size >= 8)
+		{
+			hash = _hash_word(hash, _load_word(data, 8));
+			data += 8, size -= 8;
+		}
+		hash = _hash_word(hash, _load_word(data, size));
+
+		hash ^= hash >> 33;
+		hash *= 0xc4ceb9fe1a85ec53;
+		hash ^= hash >> 33;
+		return static_cast<std::size_t>(hash);
 	}
 
 } // namespace phase2
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <phase2/utils/IoUring.hpp>
+#include <phase2/utils/Log.hpp>
+
+namespace phase2
+{
+
+	/**
+	 * @brief Map a region of the ring instance.
+	 *
+	 * @return the region, or nullptr on failure.
+	 */
+	void *_map_ring(int fd, std::size_t size, off_t offset) noexcept
+	{
+		void *addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+		return addr == MAP_FAILED ? nullptr : addr;
+	}
+
+	/**
+	 * @brief Set up an instance, without IORING_SETUP_DEFER_TASKRUN on
+	 * kernels older than 6.1.
+	 */
+	int _setup_ring(unsigned entries, io_uring_params &params) noexcept
+	{
+		for (unsigned flags : {IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN, IORING_SETUP_SINGLE_ISSUER})
+		{
+			std::memset(&params, 0, sizeof(params));
+			params.flags = flags;
+			const int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+			if (fd >= 0 || errno != EINVAL)
+				return fd;
+		}
+		return -1;
+	}
+
+	IoUring::IoUring(unsigned entries) noexcept
+		: _fd{-1}, _ring{nullptr}, _ring_size{0}, _cq_ring{nullptr}, _cq_ring_size{0}, _sqes{nullptr},
+		  _sqes_size{0}, _sq_head{nullptr}, _sq_tail{nullptr}, _sq_mask{0}, _sq_entries{0}, _sq_local_tail{0},
+		  _cq_head{nullptr}, _cq_tail{nullptr}, _cqes{nullptr}, _cq_mask{0}, _buf_ring{nullptr}, _buf_ring_size{0},
+		  _buffers{nullptr}, _buffer_size{0}, _buffer_count{0}, _buffer_tail{0}
+	{
+		io_uring_params params;
+		this->_fd = _setup_ring(entries, params);
+		if (this->_fd < 0)
+		{
+			PHASE2_LOG(DEBUG, SERVER) << "IoUring: io_uring_setup failed: " << std::strerror(errno);
+			return;
+		}
+		if (!this->_map(params))
+		{
+			PHASE2_LOG(DEBUG, SERVER) << "IoUring: cannot map the rings: " << std::strerror(errno);
+			::close(this->_fd);
+			this->_fd = -1;
+		}
+	}
+
+	IoUring::~IoUring()
+	{
+		// closing the instance first cancels the operations using the buffers
+		if (this->_fd >= 0)
+			::close(this->_fd);
+		if (this->_buf_ring != nullptr)
+			::munmap(this->_buf_ring, this->_buf_ring_size);
+		if (this->_sqes != nullptr)
+			::munmap(this->_sqes, this->_sqes_size);
+		if (this->_cq_ring != nullptr && this->_cq_ring != this->_ring)
+			::munmap(this->_cq_ring, this->_cq_ring_size);
+		if (this->_ring != nullptr)
+			::munmap(this->_ring, this->_ring_size);
+	}
+
+	bool IoUring::supported() noexcept
+	{
+		// IORING_SETUP_SINGLE_ISSUER and multishot recv both came with 6.0,
+		// provided-buffer rings and multishot accept with 5.19
+		static const bool result = []
+		{
+			IoUring ring{4};
+			return ring.isValid() && ring.registerBuffers(0, 2, 4096);
+		}();
+		return result;
+	}
+
+	bool IoUring::isValid() const noexcept
+	{
+		return this->_fd >= 0;
+	}
+
+	io_uring_sqe *IoUring::getSqe() noexcept
+	{
+		if (this->_sq_local_tail - __atomic_load_n(this->_sq_head, __ATOMIC_ACQUIRE) >= this->_sq_entries &&
+			(this->submit() < 0 ||
+			 this->_sq_local_tail - __atomic_load_n(this->_sq_head, __ATOMIC_ACQUIRE) >= this->_sq_entries))
+			return nullptr;
+
+		io_uring_sqe *sqe = &this->_sqes[this->_sq_local_tail++ & this->_sq_mask];
+		std::memset(sqe, 0, sizeof(*sqe));
+		return sqe;
+	}
+
+	int IoUring::submit(unsigned wait) noexcept
+	{
+		__atomic_store_n(this->_sq_tail, this->_sq_local_tail, __ATOMIC_RELEASE);
+		const unsigned pending = this->_sq_local_tail - __atomic_load_n(this->_sq_head, __ATOMIC_ACQUIRE);
+		return static_cast<int>(::syscall(__NR_io_uring_enter, this->_fd, pending, wait,
+										  wait != 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+	}
+
+	const io_uring_cqe *IoUring::peekCqe() const noexcept
+	{
+		const unsigned head = *this->_cq_head;
+		if (head == __atomic_load_n(this->_cq_tail, __ATOMIC_ACQUIRE))
+			return nullptr;
+		return &this->_cqes[head & this->_cq_mask];
+	}
+
+	void IoUring::seenCqe() noexcept
+	{
+		__atomic_store_n(this->_cq_head, *this->_cq_head + 1, __ATOMIC_RELEASE);
+	}
+
+	bool IoUring::registerBuffers(std::uint16_t group, std::uint16_t count, std::size_t size) noexcept
+	{
+		if (this->_buf_ring != nullptr || count == 0 || (count & (count - 1)) != 0)
+			return false;
+
+		// the ring of buffer descriptors, then the buffers, in one mapping
+		const std::size_t ring_size = (count * sizeof(io_uring_buf) + 4095) & ~std::size_t{4095};
+		const std::size_t total     = ring_size + count * size;
+		void *addr = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (addr == MAP_FAILED)
+			return false;
+
+		io_uring_buf_reg reg{};
+		reg.ring_addr    = reinterpret_cast<std::uintptr_t>(addr);
+		reg.ring_entries = count;
+		reg.bgid         = group;
+		if (::syscall(__NR_io_uring_register, this->_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0)
+		{
+			PHASE2_LOG(DEBUG, SERVER) << "IoUring: cannot register the buffer ring: " << std::strerror(errno);
+			::munmap(addr, total);
+			return false;
+		}
+
+		this->_buf_ring      = static_cast<io_uring_buf *>(addr);
+		this->_buf_ring_size = total;
+		this->_buffers       = static_cast<char *>(addr) + ring_size;
+		this->_buffer_size   = size;
+		this->_buffer_count  = count;
+		for (std::uint16_t id = 0; id < count; ++id)
+			this->recycleBuffer(id);
+		return true;
+	}
+
+	char *IoUring::buffer(std::uint16_t id) const noexcept
+	{
+		return this->_buffers + id * this->_buffer_size;
+	}
+
+	void IoUring::recycleBuffer(std::uint16_t id) noexcept
+	{
+		// the ring is indexed as a plain array: io_uring_buf_ring::bufs is
+		// shifted in C++, where the empty struct before it takes a byte, and
+		// the tail overlays the resv field of the first entry
+		io_uring_buf &buf = this->_buf_ring[this->_buffer_tail & (this->_buffer_count - 1)];
+		buf.addr          = reinterpret_cast<std::uintptr_t>(this->buffer(id));
+		buf.len           = static_cast<std::uint32_t>(this->_buffer_size);
+		buf.bid           = id;
+		__atomic_store_n(&this->_buf_ring[0].resv, ++this->_buffer_tail, __ATOMIC_RELEASE);
+	}
+
+	bool IoUring::_map(const io_uring_params &params) noexcept
+	{
+		this->_ring_size    = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		this->_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+			this->_ring_size = this->_cq_ring_size = std::max(this->_ring_size, this->_cq_ring_size);
+
+		this->_ring = _map_ring(this->_fd, this->_ring_size, IORING_OFF_SQ_RING);
+		if (this->_ring == nullptr)
+			return false;
+		this->_cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) != 0
+							 ? this->_ring
+							 : _map_ring(this->_fd, this->_cq_ring_size, IORING_OFF_CQ_RING);
+		this->_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+		this->_sqes      = static_cast<io_uring_sqe *>(_map_ring(this->_fd, this->_sqes_size, IORING_OFF_SQES));
+		if (this->_cq_ring == nullptr || this->_sqes == nullptr)
+			return false;
+
+		char *sq             = static_cast<char *>(this->_ring);
+		char *cq             = static_cast<char *>(this->_cq_ring);
+		this->_sq_head       = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+		this->_sq_tail       = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+		this->_sq_mask       = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+		this->_sq_entries    = params.sq_entries;
+		this->_sq_local_tail = *this->_sq_tail;
+		this->_cq_head       = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+		this->_cq_tail       = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+		this->_cq_mask       = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+		this->_cqes          = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+		// every submission slot maps to the entry of the same index
+		unsigned *array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+		for (unsigned i = 0; i < params.sq_entries; ++i)
+			array[i] = i;
+		return true;
+	}
+
+} // namespace phase2
@@ -1,10 +1,24 @@
+#include <array>
+#include <atomic>
+#include <cerrno>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
 #include <exception>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include <unistd.h>
 
 #include <phase2/utils/Log.hpp>
+#include <phase2/utils/MpscQueue.hpp>
 
 namespace phase2
 {
@@ -33,4 +47,322 @@ namespace phase2
 		std::terminate();
 	}
 
+	std::array<std::atomic<LogLevel>, LOG_MODULE_COUNT> _log_levels{
+		_global_level,
+		_global_level,
+		_global_level,
+		_global_level,
+		_global_level,
+	};
+
+	std::string_view to_string(LogModule module) noexcept
+	{
+		switch (module)
+		{
+		case LogModule::HTTP:
+			return "http";
+		case LogModule::MIME:
+			return "mime";
+		case LogModule::URL:
+			return "url";
+		case LogModule::SERVER:
+			return "server";
+		default:
+			return "general";
+		}
+	}
+
+	void set_log_level(LogModule module, LogLevel level) noexcept
+	{
+		_log_levels[static_cast<std::size_t>(module)].store(level, std::memory_order_relaxed);
+	}
+
+	LogRecord::LogRecord(LogLevel level, LogModule module) : _line{to_string(level)}
+	{
+		this->_line.reserve(128);
+		this->_line += ' ';
+		this->_line += log_time();
+		this->_line += " | ";
+		this->_line += to_string(module);
+		this->_line += ": ";
+	}
+
+	LogRecord::~LogRecord()
+	{
+		this->_line += '\n';
+		write_log(std::move(this->_line));
+	}
+
+	std::atomic<std::uint64_t> _dropped_logs{0};
+
+	/**
+	 * @brief The background writer of the asynchronous logger. Producers push
+	 * records into a lock-free queue, the writer thread concatenates them and
+	 * writes up to _BATCH_SIZE bytes with one write call.
+	 */
+	class _AsyncLogWriter
+	{
+	public:
+		_AsyncLogWriter(int fd, std::size_t capacity, LogOverflow overflow)
+			: _queue{capacity}, _fd{fd}, _overflow{overflow}, _stopping{false}, _sleeping{false}
+		{
+			this->_thread = std::thread{&_AsyncLogWriter::_run, this};
+		}
+
+		~_AsyncLogWriter()
+		{
+			{
+				std::lock_guard<std::mutex> lock{this->_mutex};
+				this->_stopping.store(true, std::memory_order_release);
+			}
+			this->_cv.notify_one();
+			this->_thread.join();
+		}
+
+		void push(std::string &&line)
+		{
+			while (!this->_queue.tryPush(std::move(line)))
+			{
+				if (this->_overflow == LogOverflow::DROP)
+				{
+					_dropped_logs.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				this->_wake();
+				std::this_thread::yield();
+			}
+			this->_wake();
+		}
+
+	private:
+		static constexpr std::size_t _BATCH_SIZE = 64 * 1024;
+
+		/**
+		 * @brief Wake the writer if it is waiting for records. Producers only
+		 * touch the mutex when the writer is idle.
+		 */
+		void _wake()
+		{
+			if (this->_sleeping.load(std::memory_order_seq_cst))
+			{
+				std::lock_guard<std::mutex> lock{this->_mutex};
+				this->_cv.notify_one();
+			}
+		}
+
+		void _write(const std::string &batch) noexcept
+		{
+			const char *data = batch.data();
+			std::size_t size = batch.size();
+			while (size != 0)
+			{
+				const ssize_t written = ::write(this->_fd, data, size);
+				if (written < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					return;
+				}
+				data += written;
+				size -= static_cast<std::size_t>(written);
+			}
+		}
+
+		void _run()
+		{
+			std::string batch;
+			batch.reserve(_BATCH_SIZE);
+			std::string line;
+			while (true)
+			{
+				while (batch.size() < _BATCH_SIZE && this->_queue.tryPop(line))
+					batch += line;
+				if (!batch.empty())
+				{
+					this->_write(batch);
+					batch.clear();
+					continue;
+				}
+				if (this->_stopping.load(std::memory_order_acquire))
+					return;
+
+				// the timeout bounds the delay of a wake-up that raced with going to sleep
+				std::unique_lock<std::mutex> lock{this->_mutex};
+				this->_sleeping.store(true, std::memory_order_seq_cst);
+				if (this->_queue.empty() && !this->_stopping.load(std::memory_order_acquire))
+					this->_cv.wait_for(lock, std::chrono::milliseconds{10});
+				this->_sleeping.store(false, std::memory_order_relaxed);
+			}
+		}
+
+		MpscQueue<std::string> _queue;
+		int _fd;
+		LogOverflow _overflow;
+		std::atomic<bool> _stopping;
+		std::atomic<bool> _sleeping;
+		std::mutex _mutex;
+		std::condition_variable _cv;
+		std::thread _thread;
+	};
+
+	std::unique_ptr<_AsyncLogWriter> _async_writer;
+	std::atomic<_AsyncLogWriter *> _async_log{nullptr};
+
+	/**
+	 * @brief Orders start and stop, and the records of exiting threads.
+	 */
+	std::mutex _async_mutex;
+
+	/**
+	 * @brief Where a producer publishes the writer it pushes to, so
+	 * stop_async_log frees it only once no slot holds it. Every thread owns a
+	 * slot on its own cache line, slots are never freed and are reused once
+	 * their thread exits.
+	 */
+	struct alignas(64) _HazardSlot
+	{
+		std::atomic<_AsyncLogWriter *> writer{nullptr};
+		std::atomic<bool> used{true};
+		_HazardSlot *next = nullptr;
+	};
+
+	std::atomic<_HazardSlot *> _hazard_slots{nullptr};
+
+	/**
+	 * @brief Take a slot returned by an exited thread, or add a new one.
+	 */
+	_HazardSlot *_acquire_hazard_slot()
+	{
+		for (_HazardSlot *slot = _hazard_slots.load(std::memory_order_acquire); slot != nullptr; slot = slot->next)
+		{
+			bool used = false;
+			if (slot->used.compare_exchange_strong(used, true, std::memory_order_acquire))
+				return slot;
+		}
+		_HazardSlot *slot = new _HazardSlot;
+		slot->next        = _hazard_slots.load(std::memory_order_relaxed);
+		while (!_hazard_slots.compare_exchange_weak(slot->next, slot, std::memory_order_release,
+													std::memory_order_relaxed))
+			;
+		return slot;
+	}
+
+	thread_local _HazardSlot *_hazard_slot = nullptr;
+	thread_local bool _hazard_released     = false;
+
+	/**
+	 * @brief Returns the slot of a thread when it exits.
+	 */
+	struct _HazardRelease
+	{
+		~_HazardRelease()
+		{
+			_hazard_slot->used.store(false, std::memory_order_release);
+			_hazard_slot     = nullptr;
+			_hazard_released = true;
+		}
+	};
+
+	/**
+	 * @brief Get the slot of the calling thread, nullptr once it has been
+	 * returned at thread exit.
+	 */
+	_HazardSlot *_get_hazard_slot()
+	{
+		if (_hazard_slot == nullptr && !_hazard_released)
+		{
+			_hazard_slot = _acquire_hazard_slot();
+			thread_local _HazardRelease release;
+		}
+		return _hazard_slot;
+	}
+
+	/**
+	 * @brief Stops the asynchronous logger at exit, so queued records are written.
+	 */
+	struct _AsyncLogGuard
+	{
+		~_AsyncLogGuard() { stop_async_log(); }
+	} _async_log_guard;
+
+	bool start_async_log(int fd, std::size_t capacity, LogOverflow overflow)
+	{
+		std::lock_guard<std::mutex> lock{_async_mutex};
+		if (_async_writer != nullptr)
+			return false;
+		_async_writer = std::make_unique<_AsyncLogWriter>(fd, capacity, overflow);
+		_async_log.store(_async_writer.get(), std::memory_order_release);
+		return true;
+	}
+
+	void stop_async_log()
+	{
+		std::lock_guard<std::mutex> lock{_async_mutex};
+		if (_async_writer == nullptr)
+			return;
+		// a producer publishes the writer before checking it is still on, so
+		// once it is unpublished only the slots holding it can still use it
+		_async_log.store(nullptr, std::memory_order_seq_cst);
+		for (_HazardSlot *slot = _hazard_slots.load(std::memory_order_acquire); slot != nullptr; slot = slot->next)
+			while (slot->writer.load(std::memory_order_seq_cst) == _async_writer.get())
+				std::this_thread::yield();
+		_async_writer.reset();
+	}
+
+	std::uint64_t get_dropped_logs() noexcept
+	{
+		return _dropped_logs.load(std::memory_order_relaxed);
+	}
+
+	std::string_view log_time()
+	{
+		thread_local std::time_t cached_time = -1;
+		thread_local char time_buf[32];
+		thread_local std::size_t time_size = 0;
+
+		const std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+		if (now != cached_time)
+		{
+			std::tm local;
+			::localtime_r(&now, &local);
+			time_size   = std::strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", &local);
+			cached_time = now;
+		}
+		return std::string_view{time_buf, time_size};
+	}
+
+	void write_log(std::string line)
+	{
+		// synchronous logging only reads _async_log, producers write nothing shared
+		_AsyncLogWriter *writer = _async_log.load(std::memory_order_seq_cst);
+		if (writer != nullptr)
+		{
+			_HazardSlot *slot = _get_hazard_slot();
+			if (slot == nullptr)
+			{
+				// the thread is exiting, hold off stop_async_log instead
+				std::lock_guard<std::mutex> lock{_async_mutex};
+				writer = _async_log.load(std::memory_order_relaxed);
+				if (writer != nullptr)
+					writer->push(std::move(line));
+			}
+			else
+			{
+				// publish the writer, then check it is still on
+				slot->writer.store(writer, std::memory_order_seq_cst);
+				for (_AsyncLogWriter *current; (current = _async_log.load(std::memory_order_seq_cst)) != writer;
+					 writer = current)
+					slot->writer.store(current, std::memory_order_seq_cst);
+				if (writer != nullptr)
+					writer->push(std::move(line));
+				slot->writer.store(nullptr, std::memory_order_release);
+			}
+			if (writer != nullptr)
+				return;
+		}
+
+		std::lock_guard<std::mutex> guard{log_lock};
+		std::cerr << line;
+	}
+
 };
@@ -0,0 +1,377 @@
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+#include <phase2/utils/Scan.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PHASE2_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace phase2
+{
+
+	// clang-format off
+	/**
+	 * @brief Check whether a byte is a token character (RFC 7230 tchar).
+	 */
+	constexpr bool _is_token(unsigned char c)
+	{
+		switch (c)
+		{
+		case '!': case '#': case '$': case '%': case '&': case '\'': case '*':
+		case '+': case '-': case '.': case '^': case '_': case '`': case '|': case '~':
+			return true;
+		default:
+			return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+		}
+	}
+	// clang-format on
+
+	/**
+	 * @brief Check whether a byte is a control character other than HTAB.
+	 */
+	constexpr bool _is_ctl(unsigned char c)
+	{
+		return (c < 0x20 && c != '\t') || c == 0x7f;
+	}
+
+	// clang-format off
+	/**
+	 * @brief Check whether a byte is kept by percent_encode in a query
+	 * parameter, the unreserved characters and the few others kept by
+	 * JavaScript's encodeURIComponent.
+	 */
+	constexpr bool _is_query_safe(unsigned char c)
+	{
+		switch (c)
+		{
+		case '-': case '.': case '_': case '~': case '!': case '\'': case '(': case ')': case '*':
+			return true;
+		default:
+			return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+		}
+	}
+
+	/**
+	 * @brief Check whether a byte is kept by percent_encode in a path, the
+	 * RFC 3986 pchar without '%' plus the slash.
+	 */
+	constexpr bool _is_path_safe(unsigned char c)
+	{
+		switch (c)
+		{
+		case '-': case '.': case '_': case '~': case '!': case '$': case '&': case '\'': case '(': case ')':
+		case '*': case '+': case ',': case ';': case '=': case ':': case '@': case '/':
+			return true;
+		default:
+			return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+		}
+	}
+	// clang-format on
+
+	/**
+	 * @brief A set of ASCII characters for the lookups. Byte i of the bitmap
+	 * has bit h set when the character (h << 4 | i) is in the set, characters
+	 * with the high bit set never match because their high nibble is at least 8.
+	 */
+	struct _ByteSet
+	{
+		alignas(16) std::array<std::uint8_t, 16> bitmap;
+		std::array<bool, 256> table;
+	};
+
+	constexpr _ByteSet _make_byte_set(bool (*contains)(unsigned char))
+	{
+		_ByteSet set{};
+		for (unsigned int c = 0; c < 128; ++c)
+		{
+			if (!contains(static_cast<unsigned char>(c)))
+				continue;
+			set.bitmap[c & 0x0f] |= static_cast<std::uint8_t>(1u << (c >> 4));
+			set.table[c] = true;
+		}
+		return set;
+	}
+
+	constexpr _ByteSet _token_set      = _make_byte_set(_is_token);
+	constexpr _ByteSet _query_safe_set = _make_byte_set(_is_query_safe);
+	constexpr _ByteSet _path_safe_set  = _make_byte_set(_is_path_safe);
+	alignas(16) constexpr std::array<std::uint8_t, 16> _high_nibble_bit{
+		0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0, 0, 0, 0, 0, 0, 0, 0};
+
+	template <const _ByteSet &set>
+	const char *_find_outside_scalar(const char *first, const char *last) noexcept
+	{
+		while (first != last && set.table[static_cast<unsigned char>(*first)])
+			++first;
+		return first;
+	}
+
+	const char *_find_ctl_scalar(const char *first, const char *last) noexcept
+	{
+		while (first != last && !_is_ctl(static_cast<unsigned char>(*first)))
+			++first;
+		return first;
+	}
+
+	const char *_find_url_escape_scalar(const char *first, const char *last) noexcept
+	{
+		while (first != last && *first != '%' && *first != '+')
+			++first;
+		return first;
+	}
+
+#ifdef PHASE2_SCAN_X86
+
+	template <const _ByteSet &set>
+	__attribute__((target("sse4.2"))) const char *_find_outside_sse42(const char *first, const char *last) noexcept
+	{
+		const __m128i bitmap   = _mm_load_si128(reinterpret_cast<const __m128i *>(set.bitmap.data()));
+		const __m128i high_bit = _mm_load_si128(reinterpret_cast<const __m128i *>(_high_nibble_bit.data()));
+		const __m128i nibble   = _mm_set1_epi8(0x0f);
+		while (last - first >= 16)
+		{
+			const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+			const __m128i low  = _mm_shuffle_epi8(bitmap, _mm_and_si128(data, nibble));
+			const __m128i high = _mm_shuffle_epi8(high_bit, _mm_and_si128(_mm_srli_epi16(data, 4), nibble));
+			const int mask     = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(low, high), _mm_setzero_si128()));
+			if (mask != 0)
+				return first + __builtin_ctz(static_cast<unsigned int>(mask));
+			first += 16;
+		}
+		return _find_outside_scalar<set>(first, last);
+	}
+
+	__attribute__((target("sse4.2"))) const char *_find_ctl_sse42(const char *first, const char *last) noexcept
+	{
+		// 0x00-0x08, 0x0a-0x1f and 0x7f, i.e. every control character except HTAB
+		const __m128i ranges = _mm_setr_epi8(0x00, 0x08, 0x0a, 0x1f, 0x7f, 0x7f,
+											 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+		while (last - first >= 16)
+		{
+			const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+			const int index    = _mm_cmpestri(ranges, 6, data, 16,
+											  _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+			if (index != 16)
+				return first + index;
+			first += 16;
+		}
+		return _find_ctl_scalar(first, last);
+	}
+
+	__attribute__((target("sse4.2"))) const char *_find_url_escape_sse42(const char *first, const char *last) noexcept
+	{
+		const __m128i percent = _mm_set1_epi8('%');
+		const __m128i plus    = _mm_set1_epi8('+');
+		while (last - first >= 16)
+		{
+			const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+			const int mask     = _mm_movemask_epi8(
+				_mm_or_si128(_mm_cmpeq_epi8(data, percent), _mm_cmpeq_epi8(data, plus)));
+			if (mask != 0)
+				return first + __builtin_ctz(static_cast<unsigned int>(mask));
+			first += 16;
+		}
+		return _find_url_escape_scalar(first, last);
+	}
+
+	template <const _ByteSet &set>
+	__attribute__((target("avx2"))) const char *_find_outside_avx2(const char *first, const char *last) noexcept
+	{
+		const __m256i bitmap   = _mm256_broadcastsi128_si256(
+			_mm_load_si128(reinterpret_cast<const __m128i *>(set.bitmap.data())));
+		const __m256i high_bit = _mm256_broadcastsi128_si256(
+			_mm_load_si128(reinterpret_cast<const __m128i *>(_high_nibble_bit.data())));
+		const __m256i nibble   = _mm256_set1_epi8(0x0f);
+		while (last - first >= 32)
+		{
+			const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+			const __m256i low  = _mm256_shuffle_epi8(bitmap, _mm256_and_si256(data, nibble));
+			const __m256i high = _mm256_shuffle_epi8(high_bit, _mm256_and_si256(_mm256_srli_epi16(data, 4), nibble));
+			const unsigned int mask = static_cast<unsigned int>(
+				_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(low, high), _mm256_setzero_si256())));
+			if (mask != 0)
+				return first + __builtin_ctz(mask);
+			first += 32;
+		}
+		return _find_outside_sse42<set>(first, last);
+	}
+
+	__attribute__((target("avx2"))) const char *_find_ctl_avx2(const char *first, const char *last) noexcept
+	{
+		const __m256i max_ctl = _mm256_set1_epi8(0x1f);
+		const __m256i tab     = _mm256_set1_epi8('\t');
+		const __m256i del     = _mm256_set1_epi8(0x7f);
+		while (last - first >= 32)
+		{
+			const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+			const __m256i ctl  = _mm256_cmpeq_epi8(_mm256_min_epu8(data, max_ctl), data);
+			const __m256i hit  = _mm256_or_si256(_mm256_andnot_si256(_mm256_cmpeq_epi8(data, tab), ctl),
+												 _mm256_cmpeq_epi8(data, del));
+			const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(hit));
+			if (mask != 0)
+				return first + __builtin_ctz(mask);
+			first += 32;
+		}
+		return _find_ctl_sse42(first, last);
+	}
+
+	__attribute__((target("avx2"))) const char *_find_url_escape_avx2(const char *first, const char *last) noexcept
+	{
+		const __m256i percent = _mm256_set1_epi8('%');
+		const __m256i plus    = _mm256_set1_epi8('+');
+		while (last - first >= 32)
+		{
+			const __m256i data      = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+			const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(
+				_mm256_or_si256(_mm256_cmpeq_epi8(data, percent), _mm256_cmpeq_epi8(data, plus))));
+			if (mask != 0)
+				return first + __builtin_ctz(mask);
+			first += 32;
+		}
+		return _find_url_escape_sse42(first, last);
+	}
+
+#endif
+
+	/**
+	 * @brief The scanning functions of one backend.
+	 */
+	struct _ScanFunctions
+	{
+		ScanBackend backend;
+		const char *(*find_non_token)(const char *, const char *) noexcept;
+		const char *(*find_ctl)(const char *, const char *) noexcept;
+		const char *(*find_url_escape)(const char *, const char *) noexcept;
+		const char *(*find_query_unsafe)(const char *, const char *) noexcept;
+		const char *(*find_path_unsafe)(const char *, const char *) noexcept;
+	};
+
+	// clang-format off
+	constexpr _ScanFunctions _scan_scalar{ScanBackend::SCALAR,
+										  _find_outside_scalar<_token_set>,
+										  _find_ctl_scalar,
+										  _find_url_escape_scalar,
+										  _find_outside_scalar<_query_safe_set>,
+										  _find_outside_scalar<_path_safe_set>};
+#ifdef PHASE2_SCAN_X86
+	constexpr _ScanFunctions _scan_sse42{ScanBackend::SSE42,
+										 _find_outside_sse42<_token_set>,
+										 _find_ctl_sse42,
+										 _find_url_escape_sse42,
+										 _find_outside_sse42<_query_safe_set>,
+										 _find_outside_sse42<_path_safe_set>};
+	constexpr _ScanFunctions _scan_avx2{ScanBackend::AVX2,
+										_find_outside_avx2<_token_set>,
+										_find_ctl_avx2,
+										_find_url_escape_avx2,
+										_find_outside_avx2<_query_safe_set>,
+										_find_outside_avx2<_path_safe_set>};
+#endif
+	// clang-format on
+
+	std::atomic<const _ScanFunctions *> _scan_functions{nullptr};
+
+	bool _scan_supported(ScanBackend backend) noexcept
+	{
+		switch (backend)
+		{
+		case ScanBackend::SCALAR:
+			return true;
+#ifdef PHASE2_SCAN_X86
+		case ScanBackend::SSE42:
+			return __builtin_cpu_supports("sse4.2");
+		case ScanBackend::AVX2:
+			return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2");
+#endif
+		default:
+			return false;
+		}
+	}
+
+	const _ScanFunctions *_get_scan_functions() noexcept
+	{
+		const _ScanFunctions *functions = _scan_functions.load(std::memory_order_relaxed);
+		if (functions != nullptr)
+			return functions;
+
+		functions = &_scan_scalar;
+#ifdef PHASE2_SCAN_X86
+		__builtin_cpu_init();
+		if (_scan_supported(ScanBackend::AVX2))
+			functions = &_scan_avx2;
+		else if (_scan_supported(ScanBackend::SSE42))
+			functions = &_scan_sse42;
+#endif
+		_scan_functions.store(functions, std::memory_order_relaxed);
+		return functions;
+	}
+
+	ScanBackend get_scan_backend() noexcept
+	{
+		return _get_scan_functions()->backend;
+	}
+
+	bool set_scan_backend(ScanBackend backend) noexcept
+	{
+#ifdef PHASE2_SCAN_X86
+		__builtin_cpu_init();
+#endif
+		if (!_scan_supported(backend))
+			return false;
+
+		switch (backend)
+		{
+#ifdef PHASE2_SCAN_X86
+		case ScanBackend::SSE42:
+			_scan_functions.store(&_scan_sse42, std::memory_order_relaxed);
+			break;
+		case ScanBackend::AVX2:
+			_scan_functions.store(&_scan_avx2, std::memory_order_relaxed);
+			break;
+#endif
+		default:
+			_scan_functions.store(&_scan_scalar, std::memory_order_relaxed);
+			break;
+		}
+		return true;
+	}
+
+	const char *find_non_token(const char *first, const char *last) noexcept
+	{
+		return _get_scan_functions()->find_non_token(first, last);
+	}
+
+	const char *find_ctl(const char *first, const char *last) noexcept
+	{
+		return _get_scan_functions()->find_ctl(first, last);
+	}
+
+	const char *find_url_escape(const char *first, const char *last) noexcept
+	{
+		return _get_scan_functions()->find_url_escape(first, last);
+	}
+
+	const char *find_url_unsafe(const char *first, const char *last, bool path) noexcept
+	{
+		const _ScanFunctions *functions = _get_scan_functions();
+		return path ? functions->find_path_unsafe(first, last) : functions->find_query_unsafe(first, last);
+	}
+
+	std::string_view to_string(ScanBackend backend) noexcept
+	{
+		switch (backend)
+		{
+		case ScanBackend::SSE42:
+			return "SSE4.2";
+		case ScanBackend::AVX2:
+			return "AVX2";
+		default:
+			return "scalar";
+		}
+	}
+
+} // namespace phase2
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <phase2/utils/WorkStealingExecutor.hpp>
+
+namespace phase2
+{
+
+	/**
+	 * @brief The executor and the index of the worker running on this thread.
+	 */
+	thread_local const WorkStealingExecutor *_current_executor = nullptr;
+	thread_local std::size_t _current_worker                   = 0;
+
+	/**
+	 * @brief The next deque this thread submits to. It starts at a different
+	 * deque in every thread, so the event loops do not share a counter.
+	 */
+	thread_local std::size_t _submit_cursor = std::hash<std::thread::id>{}(std::this_thread::get_id());
+
+	WorkStealingExecutor::WorkStealingExecutor(std::size_t threads)
+		: _workers{}, _pending{0}, _steals{0}, _executed{0}, _sleepers{0}, _stopping{false}, _idle_mutex{}, _idle_cv{}
+	{
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		this->_workers.reserve(threads);
+		for (std::size_t i = 0; i < threads; ++i)
+		{
+			this->_workers.push_back(std::make_unique<_Worker>());
+			this->_workers.back()->depth.store(0, std::memory_order_relaxed);
+		}
+		// every deque exists before a worker may steal from it
+		for (std::size_t i = 0; i < threads; ++i)
+			this->_workers[i]->thread = std::thread{&WorkStealingExecutor::_run, this, i};
+	}
+
+	WorkStealingExecutor::~WorkStealingExecutor()
+	{
+		{
+			std::lock_guard<std::mutex> lock{this->_idle_mutex};
+			this->_stopping.store(true, std::memory_order_seq_cst);
+		}
+		this->_idle_cv.notify_all();
+		for (const std::unique_ptr<_Worker> &worker : this->_workers)
+			worker->thread.join();
+	}
+
+	void WorkStealingExecutor::submit(Task task)
+	{
+		// a worker keeps its subtasks, the idle workers steal them if it is busy
+		const std::size_t index =
+			_current_executor == this ? _current_worker : _submit_cursor++ % this->_workers.size();
+		_Worker &worker = *this->_workers[index];
+		// counted before it is pushed, so a worker taking it never makes _pending wrap
+		this->_pending.fetch_add(1, std::memory_order_seq_cst);
+		{
+			std::lock_guard<std::mutex> lock{worker.mutex};
+			worker.tasks.push_back(std::move(task));
+			worker.depth.store(worker.tasks.size(), std::memory_order_relaxed);
+		}
+
+		// a worker going to sleep counts itself before checking _pending
+		if (this->_sleepers.load(std::memory_order_seq_cst) != 0)
+		{
+			std::lock_guard<std::mutex> lock{this->_idle_mutex};
+			this->_idle_cv.notify_one();
+		}
+	}
+
+	std::size_t WorkStealingExecutor::threads() const noexcept
+	{
+		return this->_workers.size();
+	}
+
+	std::size_t WorkStealingExecutor::pending() const noexcept
+	{
+		return this->_pending.load(std::memory_order_relaxed);
+	}
+
+	std::size_t WorkStealingExecutor::pending(std::size_t worker) const noexcept
+	{
+		return this->_workers[worker]->depth.load(std::memory_order_relaxed);
+	}
+
+	std::uint64_t WorkStealingExecutor::steals() const noexcept
+	{
+		return this->_steals.load(std::memory_order_relaxed);
+	}
+
+	std::uint64_t WorkStealingExecutor::executed() const noexcept
+	{
+		return this->_executed.load(std::memory_order_relaxed);
+	}
+
+	bool WorkStealingExecutor::_take(std::size_t index, Task &task)
+	{
+		const std::size_t count = this->_workers.size();
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			_Worker &worker = *this->_workers[(index + i) % count];
+			if (worker.depth.load(std::memory_order_relaxed) == 0)
+				continue;
+
+			std::lock_guard<std::mutex> lock{worker.mutex};
+			if (worker.tasks.empty())
+				continue;
+			// the owner runs its tasks in order, a thief takes the one the owner would reach last
+			if (i == 0)
+			{
+				task = std::move(worker.tasks.front());
+				worker.tasks.pop_front();
+			}
+			else
+			{
+				task = std::move(worker.tasks.back());
+				worker.tasks.pop_back();
+				this->_steals.fetch_add(1, std::memory_order_relaxed);
+			}
+			worker.depth.store(worker.tasks.size(), std::memory_order_relaxed);
+			this->_pending.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	}
+
+	void WorkStealingExecutor::_run(std::size_t index)
+	{
+		_current_executor = this;
+		_current_worker   = index;
+
+		Task task;
+		while (true)
+		{
+			if (this->_take(index, task))
+			{
+				task();
+				task = nullptr;
+				this->_executed.fetch_add(1, std::memory_order_relaxed);
+				continue;
+			}
+			// a counted task is being pushed
+			if (this->_pending.load(std::memory_order_relaxed) != 0)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock{this->_idle_mutex};
+			this->_sleepers.fetch_add(1, std::memory_order_seq_cst);
+			while (this->_pending.load(std::memory_order_seq_cst) == 0 &&
+				   !this->_stopping.load(std::memory_order_relaxed))
+				this->_idle_cv.wait(lock);
+			this->_sleepers.fetch_sub(1, std::memory_order_relaxed);
+			if (this->_pending.load(std::memory_order_relaxed) == 0 && this->_stopping.load(std::memory_order_relaxed))
+				return;
+		}
+	}
+
+} // namespace phase2
@@ -1,9 +1,36 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <list>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <phase2/Chunked.hpp>
 #include <phase2/Http.hpp>
+#include <phase2/HttpCoroutine.hpp>
+#include <phase2/HttpParser.hpp>
+#include <phase2/HttpServer.hpp>
 #include <phase2/Mime.hpp>
+#include <phase2/MimeCache.hpp>
+#include <phase2/MimeService.hpp>
 #include <phase2/Url.hpp>
+#include <phase2/utils/HeaderId.hpp>
+#include <phase2/utils/HeaderMap.hpp>
+#include <phase2/utils/Log.hpp>
+#include <phase2/utils/Scan.hpp>
+#include <phase2/utils/WorkStealingExecutor.hpp>
 
 int main(int argc, char const *argv[])
 {
@@ -31,7 +58,7 @@ int main(int argc, char const *argv[])
 				  << to_string(request1.getHttpVersion()) << '\n';
 	else if (request1.getUrl().path() != "/")
 		std::cerr << "HttpRequestHeader test1 failed, url path = "
-				  << request1.getUrl().path().string() << '\n';
+				  << request1.getUrl().path() << '\n';
 	else if (request1.getHeader("aCCepT-LAnGuaGE").front() != "en-US")
 		std::cerr << "HttpRequestHeader test1 failed, Accept-Language = "
 				  << request1.getHeader("AcCEpT-lANGuAge").front() << '\n';
@@ -46,7 +73,7 @@ int main(int argc, char const *argv[])
 				  << to_string(request2.getHttpVersion()) << '\n';
 	else if (request2.getUrl().path() != "/")
 		std::cerr << "HttpRequestHeader test2 failed, url path = "
-				  << request2.getUrl().path().string() << '\n';
+				  << request2.getUrl().path() << '\n';
 	else if (request1.getType() != HttpRequestHeader::RequestType::POST)
 		std::cerr << "HttpRequestHeader test1 failed, request type = "
 				  << to_string(request1.getType()) << '\n';
@@ -61,7 +88,7 @@ int main(int argc, char const *argv[])
 				  << request3.getUrl().getParam("veryFASTparam2") << "\n";
 	else if (request3.getUrl().path() != "/test48763")
 		std::cerr << "HttpRequestHeader test3 failed, url path = "
-				  << request3.getUrl().path().string() << '\n';
+				  << request3.getUrl().path() << '\n';
 	else if (request3.getHttpVersion() != std::make_pair(1, 1))
 		std::cerr << "HttpRequestHeader test3 failed, HTTP version = "
 				  << to_string(request3.getHttpVersion()) << '\n';
@@ -89,16 +116,797 @@ int main(int argc, char const *argv[])
 		std::cerr << "HttpResponseHeader test2 success\n";
 
 	HttpResponseHeader response3{"HTTP/1.1 404 Not Found\r\n\r\n", body_start};
+	std::size_t empty_status_start = 0;
+	HttpResponseHeader empty_status{"HTTP/1.1  OK\r\n\r\n", empty_status_start};
 	if (!response3 || body_start != 26)
 		std::cerr << "HttpResponseHeader test3 failed, body_start = " << body_start << "\n";
+	else if (empty_status)
+		std::cerr << "HttpResponseHeader test3 failed, empty status code accepted\n";
 	else
 		std::cerr << "HttpResponseHeader test3 success\n";
 
+	std::vector<iovec> iov;
+	std::string gathered;
+	if (response1.serialize(iov))
+		for (const iovec &segment : iov)
+			gathered.append(static_cast<const char *>(segment.iov_base), segment.iov_len);
+	if (gathered.compare(0, 17, "HTTP/1.1 200 OK\r\n") != 0 || gathered.size() != 96)
+		std::cerr << "HttpResponseHeader test4 failed, iovec = " << gathered << '\n';
+	else if (iov[4].iov_base != response1.getHeaders().begin()->field.data())
+		std::cerr << "HttpResponseHeader test4 failed, field is copied\n";
+	else
+		std::cerr << "HttpResponseHeader test4 success\n";
+
+	std::string_view raw4 =
+		"GET /index.html HTTP/1.1\r\n"
+		"Host: localhost:8080\r\n"
+		"Accept: text/html,application/xhtml+xml\r\n"
+		"Accept-Encoding: gzip, deflate, br\r\n"
+		"\r\n"
+		"body";
+	HttpRequestParser parser1;
+	ParseStatus status = ParseStatus::NEED_MORE;
+	std::size_t consumed;
+	body_start = 0;
+	for (std::size_t i = 0; i < raw4.size() && status == ParseStatus::NEED_MORE; i += 5)
+	{
+		status = parser1.parse(raw4.substr(i, 5), consumed);
+		body_start += consumed;
+	}
+	if (status != ParseStatus::DONE || body_start != raw4.size() - 4 || parser1.consumed() != body_start)
+		std::cerr << "HttpRequestParser test1 failed, body_start = " << body_start << "\n";
+	else if (!parser1.header() || parser1.header().getType() != HttpRequestHeader::RequestType::GET)
+		std::cerr << "HttpRequestParser test1 failed, request type = "
+				  << to_string(parser1.header().getType()) << '\n';
+	else if (parser1.header().getHeader("accept-encoding").front() != "gzip, deflate, br")
+		std::cerr << "HttpRequestParser test1 failed, Accept-Encoding = "
+				  << parser1.header().getHeader("accept-encoding").front() << '\n';
+	else
+		std::cerr << "HttpRequestParser test1 success\n";
+
+	HttpResponseParser parser2;
+	status = parser2.parse("HTTP/1.1 404 Not Found\r\nServer: Apache\r\n", consumed);
+	if (status != ParseStatus::NEED_MORE || consumed != 40)
+		std::cerr << "HttpResponseParser test1 failed, consumed = " << consumed << "\n";
+	else if ((status = parser2.parse("\r\n", consumed)) != ParseStatus::DONE || parser2.consumed() != 42)
+		std::cerr << "HttpResponseParser test1 failed, consumed = " << parser2.consumed() << "\n";
+	else if (parser2.header().getStatus() != HttpResponseHeader::StatusCode::not_found)
+		std::cerr << "HttpResponseParser test1 failed, status = "
+				  << to_string(parser2.header().getStatus()) << '\n';
+	else if (parser2.parse("\r\n", consumed) != ParseStatus::DONE || consumed != 0)
+		std::cerr << "HttpResponseParser test1 failed, parser does not stop after header\n";
+	else
+		std::cerr << "HttpResponseParser test1 success\n";
+
+	HttpRequestParser parser3;
+	if (parser3.parse("GET / HTTP/1.1\r\nHost localhost\r\n") != ParseStatus::ERROR)
+		std::cerr << "HttpRequestParser test2 failed, invalid field accepted\n";
+	else
+		std::cerr << "HttpRequestParser test2 success\n";
+
+	const std::string_view pipelined =
+		"GET /a HTTP/1.1\r\nHost: localhost\r\n\r\n"
+		"POST /b HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello"
+		"POST /c HTTP/1.1\r\nTransfer-Encoding: gzip, chunked\r\n\r\n"
+		"GET /d HTTP/1.1\r\nContent-Length: 10\r\n\r\npartial";
+	HttpRequestPipeline pipeline{pipelined};
+	PipelinedRequest pipelined_request;
+	if (pipeline.next(pipelined_request) != ParseStatus::DONE || pipelined_request.header.getTarget() != "/a" ||
+		!pipelined_request.body.empty() || pipelined_request.size != 36)
+		std::cerr << "HttpRequestPipeline test1 failed, first request size = " << pipelined_request.size << '\n';
+	else if (pipeline.next(pipelined_request) != ParseStatus::DONE || pipelined_request.body != "hello" ||
+			 pipelined_request.body.data() != pipelined.data() + 36 + 39)
+		std::cerr << "HttpRequestPipeline test1 failed, body = " << pipelined_request.body << '\n';
+	else if (pipeline.next(pipelined_request) != ParseStatus::DONE || !pipelined_request.chunked ||
+			 pipelined_request.header.getTarget() != "/c")
+		std::cerr << "HttpRequestPipeline test1 failed, chunked request is not flagged\n";
+	else if (pipeline.next(pipelined_request) != ParseStatus::NEED_MORE || pipeline.remaining().substr(0, 6) != "GET /d" ||
+			 pipeline.consumed() + pipeline.remaining().size() != pipelined.size() || pipelined_request.size != 49)
+		std::cerr << "HttpRequestPipeline test1 failed, remaining = " << pipeline.remaining() << '\n';
+	else if (HttpRequestPipeline{"GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\nab"}.next(
+				 pipelined_request) != ParseStatus::ERROR ||
+			 HttpRequestPipeline{"GET / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n"}.next(pipelined_request) !=
+				 ParseStatus::ERROR ||
+			 HttpRequestPipeline{"GET / HTTP/1.1\r\nContent-Length: 18446744073709551615\r\n\r\nabc"}.next(
+				 pipelined_request) != ParseStatus::ERROR ||
+			 HttpRequestPipeline{"GET / HTTP/1.1\r\nHost: loc"}.next(pipelined_request) != ParseStatus::NEED_MORE ||
+			 pipelined_request.size != 0)
+		std::cerr << "HttpRequestPipeline test1 failed, framing\n";
+	else
+		std::cerr << "HttpRequestPipeline test1 success\n";
+
+	const std::string_view chunked_body = "5;name=value\r\nhello\r\n"
+										  "7\r\n, world\r\n"
+										  "0\r\n"
+										  "Expires: never\r\n"
+										  "X-Checksum:  48763 \r\n"
+										  "\r\n"
+										  "GET /next";
+	bool chunked_ok = true;
+	for (std::size_t step : {1, 3, 7, 64})
+	{
+		ChunkedDecoder decoder;
+		std::string decoded;
+		ParseStatus chunked_status = ParseStatus::NEED_MORE;
+		std::size_t offset         = 0;
+		std::string_view input, data;
+		while (chunked_status == ParseStatus::NEED_MORE && offset < chunked_body.size())
+		{
+			input = chunked_body.substr(offset, step);
+			offset += input.size();
+			do
+			{
+				chunked_status = decoder.decode(input, data);
+				decoded += data;
+			} while (chunked_status == ParseStatus::NEED_MORE && !input.empty());
+		}
+		chunked_ok = chunked_ok && chunked_status == ParseStatus::DONE && decoded == "hello, world" &&
+					 decoder.size() == 12 && offset - input.size() == chunked_body.size() - 9 &&
+					 decoder.trailers().find("x-checksum") != decoder.trailers().end() &&
+					 decoder.trailers().find("x-checksum")->value == "48763";
+	}
+
+	std::vector<iovec> chunked_iov;
+	ChunkedEncoder encoder;
+	HeaderMap trailers;
+	trailers.add("X-Checksum", "48763");
+	encoder.encode("hello", chunked_iov);
+	encoder.encode("", chunked_iov);
+	encoder.encode(", world", chunked_iov);
+	encoder.finish(chunked_iov, trailers);
+	std::string chunked_encoded;
+	for (const iovec &segment : chunked_iov)
+		chunked_encoded.append(static_cast<const char *>(segment.iov_base), segment.iov_len);
+
+	for (std::string_view input : {"g\r\n", "5\r\nhelloXX", "\r\n", "5\nhello\r\n", "0\r\nX-Checksum\r\n\r\n"})
+	{
+		ChunkedDecoder decoder;
+		std::string_view data;
+		ParseStatus chunked_status;
+		do
+			chunked_status = decoder.decode(input, data);
+		while (chunked_status == ParseStatus::NEED_MORE && !input.empty());
+		chunked_ok = chunked_ok && chunked_status == ParseStatus::ERROR;
+	}
+
+	// a zero-padded size never overflows, it fails before the line ends
+	const std::string padded_size(8192, '0');
+	{
+		ChunkedDecoder decoder;
+		std::string_view input = padded_size;
+		std::string_view data;
+		ParseStatus chunked_status;
+		do
+			chunked_status = decoder.decode(input, data);
+		while (chunked_status == ParseStatus::NEED_MORE && !input.empty());
+		chunked_ok = chunked_ok && chunked_status == ParseStatus::ERROR;
+	}
+
+	if (!chunked_ok)
+		std::cerr << "chunked test failed, decoder\n";
+	else if (chunked_encoded != "5\r\nhello\r\n7\r\n, world\r\n0\r\nX-Checksum: 48763\r\n\r\n" ||
+			 chunked_iov.size() != 10)
+		std::cerr << "chunked test failed, encoded = " << chunked_encoded << '\n';
+	else
+		std::cerr << "chunked test success\n";
+
+	std::string server_failure;
+	for (ServerBackend backend : {ServerBackend::EPOLL, ServerBackend::IO_URING})
+	{
+		ServerConfig server_config;
+		server_config.backend = backend;
+		HttpServer server{[](const HttpRequestHeader &request, std::string_view body)
+						  {
+							  HttpResponse response;
+							  response.header.setStatus(HttpResponseHeader::StatusCode::ok);
+							  response.body = std::string{to_string(request.getType())} + ' ' +
+											  request.getUrl().path() + ' ' + std::string{body};
+							  return response;
+						  },
+						  server_config};
+		std::string server_output[3];
+		if (!server.listen("127.0.0.1", 0))
+		{
+			server_failure = "listen failed";
+			break;
+		}
+
+		std::thread server_thread{[&server] { server.run(); }};
+		const std::string_view server_input[3] = {
+			"GET /a HTTP/1.1\r\nHost: x\r\n\r\n"
+			"POST /b HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n"
+			"HEAD /c HTTP/1.1\r\n\r\n"
+			"GET /d HTTP/1.0\r\n\r\n",
+			// rejected before the end of the header
+			"BAD\r\n",
+			// rejected before the body arrives
+			"POST /e HTTP/1.1\r\nContent-Length: 10000000000\r\n\r\n",
+		};
+		for (std::size_t i = 0; i < 3; ++i)
+		{
+			sockaddr_in addr{};
+			addr.sin_family      = AF_INET;
+			addr.sin_port        = htons(server.port());
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			const int fd         = ::socket(AF_INET, SOCK_STREAM, 0);
+			bool sent            = ::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) == 0;
+			// the first header arrives in two reads
+			const std::size_t split = i == 0 ? 10 : 0;
+			for (std::string_view part : {server_input[i].substr(0, split), server_input[i].substr(split)})
+			{
+				sent = sent && ::write(fd, part.data(), part.size()) == static_cast<ssize_t>(part.size());
+				std::this_thread::sleep_for(std::chrono::milliseconds{20});
+			}
+			if (sent)
+			{
+				// the server closes both connections after the last response
+				char buf[4096];
+				ssize_t n;
+				while ((n = ::read(fd, buf, sizeof(buf))) > 0)
+					server_output[i].append(buf, n);
+			}
+			::close(fd);
+		}
+		server.stop();
+		server_thread.join();
+
+		if (server_output[0] != "HTTP/1.1 200 OK\r\nContent-Length: 7\r\n\r\nGET /a "
+								"HTTP/1.1 200 OK\r\nContent-Length: 11\r\n\r\nPOST /b abc"
+								"HTTP/1.1 200 OK\r\nContent-Length: 8\r\n\r\n"
+								"HTTP/1.1 200 OK\r\nContent-Length: 7\r\nConnection: close\r\n\r\nGET /d " ||
+			server.requests() != 4)
+			server_failure = std::string{to_string(server.backend())} + ", output = " + server_output[0];
+		else if (server_output[1] != "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n")
+			server_failure = std::string{to_string(server.backend())} + ", output = " + server_output[1];
+		else if (server_output[2] !=
+				 "HTTP/1.1 413 Payload Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n")
+			server_failure = std::string{to_string(server.backend())} + ", output = " + server_output[2];
+	}
+	if (!server_failure.empty())
+		std::cerr << "HttpServer test1 failed, " << server_failure << '\n';
+	else
+		std::cerr << "HttpServer test1 success\n";
+
+	ShardedHttpServer sharded_server{[](const HttpRequestHeader &request, std::string_view)
+									 {
+										 HttpResponse response;
+										 response.header.setStatus(HttpResponseHeader::StatusCode::ok);
+										 response.body = request.getUrl().path();
+										 return response;
+									 },
+									 {}, 3, true};
+	std::size_t sharded_ok = 0;
+	if (sharded_server.listen("127.0.0.1", 0))
+	{
+		std::thread server_thread{[&sharded_server] { sharded_server.run(); }};
+		for (std::size_t i = 0; i < 16; ++i)
+		{
+			sockaddr_in addr{};
+			addr.sin_family                 = AF_INET;
+			addr.sin_port                   = htons(sharded_server.port());
+			addr.sin_addr.s_addr            = htonl(INADDR_LOOPBACK);
+			const int fd                    = ::socket(AF_INET, SOCK_STREAM, 0);
+			const std::string path          = "/" + std::to_string(i);
+			const std::string sharded_input = "GET " + path + " HTTP/1.1\r\nConnection: close\r\n\r\n";
+			std::string sharded_output;
+			if (::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) == 0 &&
+				::write(fd, sharded_input.data(), sharded_input.size()) == static_cast<ssize_t>(sharded_input.size()))
+			{
+				char buf[4096];
+				ssize_t n;
+				while ((n = ::read(fd, buf, sizeof(buf))) > 0)
+					sharded_output.append(buf, n);
+			}
+			::close(fd);
+			if (sharded_output.size() > path.size() &&
+				sharded_output.compare(sharded_output.size() - path.size(), path.size(), path) == 0)
+				++sharded_ok;
+		}
+		sharded_server.stop();
+		server_thread.join();
+	}
+	if (sharded_ok != 16 || sharded_server.requests() != 16 || sharded_server.shards() != 3)
+		std::cerr << "ShardedHttpServer test1 failed, " << sharded_ok << " responses\n";
+	else
+		std::cerr << "ShardedHttpServer test1 success\n";
+
+	std::atomic<std::size_t> executor_sum{0};
+	std::uint64_t executor_steals = 0;
+	{
+		WorkStealingExecutor executor{3};
+		// a busy worker keeps its subtasks, the idle ones must steal them
+		executor.submit(
+			[&executor, &executor_sum]
+			{
+				for (std::size_t i = 1; i <= 100; ++i)
+					executor.submit([&executor_sum, i] { executor_sum.fetch_add(i); });
+				std::this_thread::sleep_for(std::chrono::milliseconds{50});
+			});
+		while (executor.executed() != 101)
+			std::this_thread::sleep_for(std::chrono::milliseconds{1});
+		executor_steals = executor.steals();
+		if (executor.pending() != 0)
+			executor_steals = 0;
+	}
+	if (executor_sum != 5050 || executor_steals == 0)
+		std::cerr << "WorkStealingExecutor test1 failed, sum = " << executor_sum << ", steals = " << executor_steals
+				  << '\n';
+	else
+		std::cerr << "WorkStealingExecutor test1 success\n";
+
+	server_failure.clear();
+	WorkStealingExecutor server_executor{2};
+	for (ServerBackend backend : {ServerBackend::EPOLL, ServerBackend::IO_URING})
+	{
+		ServerConfig server_config;
+		server_config.backend  = backend;
+		server_config.executor = &server_executor;
+		HttpServer server{[](const HttpRequestHeader &request, std::string_view body)
+						  {
+							  // a blocking handler, the later requests must still be answered in order
+							  if (request.getUrl().path() == "/slow")
+								  std::this_thread::sleep_for(std::chrono::milliseconds{20});
+							  HttpResponse response;
+							  response.header.setStatus(HttpResponseHeader::StatusCode::ok);
+							  response.body = request.getUrl().path() + ' ' + std::string{body};
+							  return response;
+						  },
+						  server_config};
+		if (!server.listen("127.0.0.1", 0))
+		{
+			server_failure = "listen failed";
+			break;
+		}
+
+		std::thread server_thread{[&server] { server.run(); }};
+		const std::string_view offload_input = "GET /slow HTTP/1.1\r\n\r\n"
+											   "POST /b HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc"
+											   "GET /c HTTP/1.1\r\nConnection: close\r\n\r\n";
+		std::string offload_output;
+		sockaddr_in addr{};
+		addr.sin_family      = AF_INET;
+		addr.sin_port        = htons(server.port());
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		const int fd         = ::socket(AF_INET, SOCK_STREAM, 0);
+		if (::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) == 0 &&
+			::write(fd, offload_input.data(), offload_input.size()) == static_cast<ssize_t>(offload_input.size()))
+		{
+			char buf[4096];
+			ssize_t n;
+			while ((n = ::read(fd, buf, sizeof(buf))) > 0)
+				offload_output.append(buf, n);
+		}
+		::close(fd);
+		server.stop();
+		server_thread.join();
+
+		if (offload_output != "HTTP/1.1 200 OK\r\nContent-Length: 6\r\n\r\n/slow "
+							  "HTTP/1.1 200 OK\r\nContent-Length: 6\r\n\r\n/b abc"
+							  "HTTP/1.1 200 OK\r\nContent-Length: 3\r\nConnection: close\r\n\r\n/c " ||
+			server.requests() != 3)
+			server_failure = std::string{to_string(server.backend())} + ", output = " + offload_output;
+	}
+	if (!server_failure.empty())
+		std::cerr << "HttpServer test2 failed, " << server_failure << '\n';
+	else
+		std::cerr << "HttpServer test2 success\n";
+
+#if defined(__cpp_impl_coroutine)
+	AsyncHttpServer async_server{[](HttpConnection &connection) -> HttpTask
+								 {
+									 while (const HttpRequestHeader *request = co_await connection.readRequest())
+									 {
+										 std::string body = request->getUrl().path() + ' ';
+										 for (std::string_view chunk = co_await connection.readBodyChunk(); !chunk.empty();
+											  chunk = co_await connection.readBodyChunk())
+											 body += chunk;
+										 HttpResponseHeader header;
+										 header.setStatus(HttpResponseHeader::StatusCode::ok);
+										 if (!co_await connection.writeResponse(std::move(header), body))
+											 break;
+									 }
+								 }};
+	std::string async_output[2];
+	if (async_server.listen("127.0.0.1", 0))
+	{
+		std::thread server_thread{[&async_server] { async_server.run(); }};
+		const std::string_view async_input[2] = {
+			"GET /a HTTP/1.1\r\n\r\n"
+			"POST /b HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n"
+			"POST /c HTTP/1.1\r\nContent-Length: 2\r\nConnection: close\r\n\r\nxy",
+			// rejected before the end of the header
+			"BAD\r\n",
+		};
+		for (std::size_t i = 0; i < 2; ++i)
+		{
+			sockaddr_in addr{};
+			addr.sin_family      = AF_INET;
+			addr.sin_port        = htons(async_server.port());
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			const int fd         = ::socket(AF_INET, SOCK_STREAM, 0);
+			bool sent            = ::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) == 0;
+			// the first header arrives in two reads
+			const std::size_t split = i == 0 ? 10 : 0;
+			for (std::string_view part : {async_input[i].substr(0, split), async_input[i].substr(split)})
+			{
+				sent = sent && ::write(fd, part.data(), part.size()) == static_cast<ssize_t>(part.size());
+				std::this_thread::sleep_for(std::chrono::milliseconds{20});
+			}
+			if (sent)
+			{
+				char buf[4096];
+				ssize_t n;
+				while ((n = ::read(fd, buf, sizeof(buf))) > 0)
+					async_output[i].append(buf, n);
+			}
+			::close(fd);
+		}
+		async_server.stop();
+		server_thread.join();
+	}
+
+	FramePool frame_pool;
+	for (std::size_t i = 0; i < 4; ++i)
+		frame_pool.deallocate(frame_pool.allocate(200), 200);
+	if (async_output[0] != "HTTP/1.1 200 OK\r\nContent-Length: 3\r\n\r\n/a "
+						   "HTTP/1.1 200 OK\r\nContent-Length: 6\r\n\r\n/b abc"
+						   "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nConnection: close\r\n\r\n/c xy" ||
+		async_server.requests() != 3)
+		std::cerr << "AsyncHttpServer test1 failed, output = " << async_output[0] << '\n';
+	else if (async_output[1] != "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n")
+		std::cerr << "AsyncHttpServer test1 failed, output = " << async_output[1] << '\n';
+	else if (frame_pool.allocated() != 1)
+		std::cerr << "AsyncHttpServer test1 failed, " << frame_pool.allocated() << " frames allocated\n";
+	else
+		std::cerr << "AsyncHttpServer test1 success\n";
+#endif
+
+	std::string_view raw5 =
+		"HTTP/1.1 200 OK\r\n"
+		"Set-Cookie: a=1\r\n"
+		"Content-Length: 0\r\n"
+		"Set-Cookie: b=2\r\n"
+		"\r\n";
+	HttpResponseHeader response4{raw5};
+	std::vector<std::uint8_t> serialized4 = response4.serialize();
+	if (!response4 || response4.getHeader("set-cookie") != std::list<std::string>{"a=1", "b=2"})
+		std::cerr << "HeaderMap test1 failed, Set-Cookie count = " << response4.getHeader("set-cookie").size() << '\n';
+	else if (std::string_view{reinterpret_cast<const char *>(serialized4.data()), serialized4.size()} != raw5)
+		std::cerr << "HeaderMap test1 failed, serialized = " << serialized4 << '\n';
+	else
+	{
+		response4.removeHeader("SET-COOKIE");
+		if (!response4.getHeader("Set-Cookie").empty() || response4.getHeader("Content-Length").front() != "0")
+			std::cerr << "HeaderMap test1 failed, removeHeader\n";
+		else
+			std::cerr << "HeaderMap test1 success\n";
+	}
+
+	bool header_id_ok = to_header_id("x-not-a-standard-header") == HeaderId::UNKNOWN &&
+						to_header_id("CONTENT-length") == HeaderId::CONTENT_LENGTH &&
+						to_header_id("Content-Lengthy") == HeaderId::UNKNOWN;
+	for (std::size_t i = 1; i < HEADER_ID_COUNT && header_id_ok; ++i)
+		header_id_ok = to_header_id(to_string(static_cast<HeaderId>(i))) == static_cast<HeaderId>(i);
+	if (!header_id_ok)
+		std::cerr << "HeaderId test1 failed\n";
+	else if (response4.getHeader(HeaderId::CONTENT_LENGTH).front() != "0" ||
+			 !request1.getHeaders().contains(HeaderId::USER_AGENT))
+		std::cerr << "HeaderId test1 failed, lookup by id\n";
+	else
+		std::cerr << "HeaderId test1 success\n";
+
+	HttpRequestHeaderView view1{raw4, body_start};
+	HttpRequestHeader owned1 = view1.toOwned();
+	if (!view1 || body_start != raw4.size() - 4)
+		std::cerr << "HttpRequestHeaderView test1 failed, body_start = " << body_start << "\n";
+	else if (view1.getType() != HttpRequestHeader::RequestType::GET || view1.getUrl().path() != "/index.html")
+		std::cerr << "HttpRequestHeaderView test1 failed, request target = " << view1.getTarget() << '\n';
+	else if (view1.getHeader("HOST").size() != 1 || view1.getHeader("HOST").front() != "localhost:8080" ||
+			 view1.getHeader("HOST").front().data() < raw4.data() ||
+			 view1.getHeader("HOST").front().data() >= raw4.data() + raw4.size())
+		std::cerr << "HttpRequestHeaderView test1 failed, Host = " << view1.getHeader("HOST").front() << '\n';
+	else if (!owned1 || owned1.getHeader("Accept").front() != "text/html,application/xhtml+xml" ||
+			 owned1.getHttpVersion() != std::make_pair(1, 1) || owned1.getUrl().path() != "/index.html")
+		std::cerr << "HttpRequestHeaderView test1 failed, toOwned = " << owned1 << '\n';
+	else
+		std::cerr << "HttpRequestHeaderView test1 success\n";
+
+	const std::string_view target = "/search?q=phase2&page=3&q=http&empty=";
+	UrlView url_view{target};
+	std::size_t param_count = 0;
+	for (const UrlView::Param &param : url_view.params())
+		param_count += param.name.data() >= target.data() && param.name.data() < target.data() + target.size();
+	if (url_view.path() != "/search" || url_view.query() != "q=phase2&page=3&q=http&empty=" || param_count != 4)
+		std::cerr << "UrlView test1 failed, path = " << url_view.path() << ", " << param_count << " params\n";
+	else if (url_view.getParam("q") != "phase2" || url_view.getParam("page") != "3" ||
+			 !url_view.getParam("empty").empty() || !url_view.getParam("missing").empty() || !url_view.isValid())
+		std::cerr << "UrlView test1 failed, q = " << url_view.getParam("q") << '\n';
+	else if (UrlView{"/a?b"}.isValid() || UrlView{"/a?b=1&"}.isValid() || !UrlView{"/index.html"}.isValid() ||
+			 UrlView{"/index.html"}.params().begin() != UrlView{"/index.html"}.params().end())
+		std::cerr << "UrlView test1 failed, validation\n";
+	else if (url_view.toOwned().path() != "/search" || url_view.toOwned().getParam("page") != "3" ||
+			 Url{"/a?b"}.isValid())
+		std::cerr << "UrlView test1 failed, toOwned = " << url_view.toOwned().string() << '\n';
+	else
+		std::cerr << "UrlView test1 success\n";
+
+	HttpResponseHeaderView view2{"HTTP/1.0 304 Not Modified\r\nETag: \"48763\"\r\n\r\n", body_start};
+	if (!view2 || body_start != 44 || view2.getStatus() != HttpResponseHeader::StatusCode::not_modified)
+		std::cerr << "HttpResponseHeaderView test1 failed, body_start = " << body_start << "\n";
+	else if (view2.toOwned().getHeader("etag").front() != "\"48763\"")
+		std::cerr << "HttpResponseHeaderView test1 failed, ETag = " << view2.toOwned().getHeader("etag").front() << '\n';
+	else
+		std::cerr << "HttpResponseHeaderView test1 success\n";
+
+	using RequestType = HttpRequestHeader::RequestType;
+	bool types_ok = true;
+	for (const auto &[method, type] : std::vector<std::pair<std::string_view, RequestType>>{
+			 {"GET", RequestType::GET},
+			 {"HEAD", RequestType::HEAD},
+			 {"POST", RequestType::POST},
+			 {"PUT", RequestType::PUT},
+			 {"PATCH", RequestType::PATCH},
+			 {"DELETE", RequestType::DELETE},
+			 {"CONNECT", RequestType::CONNECT},
+			 {"OPTIONS", RequestType::OPTIONS},
+			 {"TRACE", RequestType::TRACE},
+			 {"get", RequestType::UNKNOWN},
+			 {"GETS", RequestType::UNKNOWN},
+			 {std::string_view{"GET\0", 4}, RequestType::UNKNOWN},
+			 {"OPTIONSS", RequestType::UNKNOWN},
+		 })
+		types_ok = types_ok && to_type(method) == type;
+	if (!types_ok)
+		std::cerr << "start line test failed, to_type\n";
+	else if (to_version("HTTP/1.1") != std::make_pair(1, 1) || to_version("http/1.0") != std::make_pair(1, 0) ||
+			 to_version("HTTP/12.3") != std::make_pair(12, 3) || to_version("HTTP/1.x") != std::make_pair(-1, -1) ||
+			 to_version("HTTPS1.1") != std::make_pair(-1, -1))
+		std::cerr << "start line test failed, to_version\n";
+	else if (HttpResponseHeaderView{"HTTP/1.1 404 Not Found\r\n\r\n"}.getStatus() !=
+				 HttpResponseHeader::StatusCode::not_found ||
+			 HttpResponseHeaderView{"HTTP/1.1 20x OK\r\n\r\n"} || HttpResponseHeaderView{"HTTP/1.1 000 OK\r\n\r\n"})
+		std::cerr << "start line test failed, status code\n";
+	else
+		std::cerr << "start line test success\n";
+
+	std::mt19937 rng{48763};
+	std::string scan_input(4096, '\0');
+	for (char &c : scan_input)
+		c = static_cast<char>(std::uniform_int_distribution<int>{0, 99}(rng) < 98
+								  ? std::uniform_int_distribution<int>{'a', 'z'}(rng)
+								  : std::uniform_int_distribution<int>{0, 0xff}(rng));
+	bool scan_ok = true;
+	for (ScanBackend backend : {ScanBackend::SSE42, ScanBackend::AVX2})
+	{
+		if (!set_scan_backend(backend))
+			continue;
+		for (std::size_t i = 0; i < 256 && scan_ok; ++i)
+		{
+			const char *first = scan_input.data() + std::uniform_int_distribution<std::size_t>{0, 2048}(rng);
+			const char *last  = first + std::uniform_int_distribution<std::size_t>{0, 2048}(rng);
+			const char *non_token = find_non_token(first, last);
+			const char *ctl       = find_ctl(first, last);
+			set_scan_backend(ScanBackend::SCALAR);
+			scan_ok = non_token == find_non_token(first, last) && ctl == find_ctl(first, last);
+			set_scan_backend(backend);
+		}
+		if (!scan_ok)
+			std::cerr << "Scan test failed, backend = " << to_string(backend) << '\n';
+	}
+	set_scan_backend(ScanBackend::SCALAR);
+	set_scan_backend(ScanBackend::AVX2) || set_scan_backend(ScanBackend::SSE42);
+	if (scan_ok)
+		std::cerr << "Scan test success\n";
+
+	bool percent_ok = true;
+	for (ScanBackend backend : {ScanBackend::SCALAR, ScanBackend::SSE42, ScanBackend::AVX2})
+	{
+		if (!set_scan_backend(backend))
+			continue;
+		for (std::size_t i = 0; i < 512 && percent_ok; ++i)
+		{
+			std::string plain(std::uniform_int_distribution<std::size_t>{0, 300}(rng), '\0');
+			for (char &c : plain)
+				c = static_cast<char>(std::uniform_int_distribution<int>{0, 9}(rng) < 8
+										  ? std::uniform_int_distribution<int>{'%', 'z'}(rng)
+										  : std::uniform_int_distribution<int>{0, 0xff}(rng));
+			const bool path = i % 2 == 0;
+			std::string encoded, decoded, reference;
+			percent_encode(plain, encoded, path);
+			percent_ok = percent_decode(encoded, decoded, !path) && decoded == plain;
+
+			// the escapes of the scalar backend are the reference
+			set_scan_backend(ScanBackend::SCALAR);
+			percent_encode(plain, reference, path);
+			set_scan_backend(backend);
+			percent_ok = percent_ok && encoded == reference;
+		}
+		if (!percent_ok)
+			std::cerr << "percent encoding test failed, backend = " << to_string(backend) << '\n';
+	}
+	set_scan_backend(ScanBackend::AVX2) || set_scan_backend(ScanBackend::SSE42);
+	std::string percent_decoded, percent_encoded;
+	if (!percent_decode("%41%6a+c", percent_decoded) || percent_decoded != "Aj c" ||
+			 percent_decode("a%2", percent_decoded) || percent_decode("%zz", percent_decoded))
+		std::cerr << "percent encoding test failed, decoded = " << percent_decoded << '\n';
+	else if (percent_encode("a b&c=d+/\xe9", percent_encoded), percent_encoded != "a%20b%26c%3Dd%2B%2F%E9")
+		std::cerr << "percent encoding test failed, encoded = " << percent_encoded << '\n';
+	else if (Url url{"/a%20b+?q=x%26y&r=1+2"};
+			 url.path() != "/a b+" || url.getParam("q") != "x&y" || url.getParam("r") != "1 2" || Url{"/a?b=%4"}.isValid())
+		std::cerr << "percent encoding test failed, url path = " << url.path() << '\n';
+	else if (Url url{"/a%20b?q=x%26y"}; url.string() != "/a%20b?q=x%26y")
+		std::cerr << "percent encoding test failed, url = " << url.string() << '\n';
+	else if (Url{"/a%2Fb"}.isValid() || Url{"/a%2f..%2fb"}.isValid() || Url{"/a%00.html"}.isValid() ||
+			 !Url{"/a%2Eb?q=%2F%00"}.isValid())
+		std::cerr << "percent encoding test failed, escaped '/' or NUL in a path\n";
+	else if (percent_ok)
+		std::cerr << "percent encoding test success\n";
+
+	// the segments of a first serialization stay valid after a second one
+	const Url escaped{"/a%20b?q=x%26y&e="};
+	std::vector<iovec> url_iov;
+	escaped.serialize(url_iov);
+	escaped.serialize(url_iov);
+	std::string url_serialized;
+	for (const iovec &segment : url_iov)
+		url_serialized.append(static_cast<const char *>(segment.iov_base), segment.iov_len);
+
+	Url ordered{"/list?id=1&sort=name&id=2&id=3"};
+	if (ordered.getParams("id") != std::vector<std::string_view>{"1", "2", "3"} || ordered.getParam("id") != "1" ||
+		ordered.string() != "/list?id=1&sort=name&id=2&id=3")
+		std::cerr << "Url test1 failed, url = " << ordered.string() << '\n';
+	else if (ordered.setParam("id", "4"), ordered.addParam("page", "2"), ordered.removeParam("sort"),
+			 ordered.string() != "/list?id=4&page=2")
+		std::cerr << "Url test1 failed, modified url = " << ordered.string() << '\n';
+	else if (Url single{"/a?b=1"}; single.string() != "/a?b=1" || Url{"/a"}.string() != "/a")
+		std::cerr << "Url test1 failed, single parameter = " << single.string() << '\n';
+	else if (url_serialized != "/a%20b?q=x%26y&e=/a%20b?q=x%26y&e=")
+		std::cerr << "Url test1 failed, serialized = " << url_serialized << '\n';
+	else
+		std::cerr << "Url test1 success\n";
+
+	bool case_ok = true;
+	for (std::size_t i = 0; i < 1024 && case_ok; ++i)
+	{
+		std::string lhs(std::uniform_int_distribution<std::size_t>{0, 40}(rng), '\0');
+		for (char &c : lhs)
+			c = static_cast<char>(std::uniform_int_distribution<int>{0, 0xff}(rng));
+		std::string rhs = lhs;
+		for (char &c : rhs)
+			if (std::uniform_int_distribution<int>{0, 1}(rng))
+				c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+		if (!rhs.empty() && std::uniform_int_distribution<int>{0, 3}(rng) == 0)
+			rhs[std::uniform_int_distribution<std::size_t>{0, rhs.size() - 1}(rng)] ^= 0x40;
+
+		bool expected = true;
+		for (std::size_t j = 0; j < lhs.size(); ++j)
+			expected = expected && std::tolower(static_cast<unsigned char>(lhs[j])) ==
+									   std::tolower(static_cast<unsigned char>(rhs[j]));
+		case_ok = CaseInsensitiveEqual{}(lhs, rhs) == expected &&
+				  (!expected || CaseInsensitiveHash{}(lhs) == CaseInsensitiveHash{}(rhs));
+	}
+	if (!case_ok)
+		std::cerr << "CaseInsensitive test failed\n";
+	else
+		std::cerr << "CaseInsensitive test success\n";
+
 	std::string mime = get_mime(argv[0]);
 	if (mime.compare("application/x-pie-executable") != 0)
 		std::cerr << "get_mime test failed\n";
 	else
 		std::cerr << "get_mime test success\n";
 
+	if (get_mime_by_extension("JPG") != "image/jpeg" || get_mime_by_extension("woff2") != "font/woff2" ||
+		!get_mime_by_extension("jpgx").empty() || !get_mime_by_extension("").empty())
+		std::cerr << "get_mime_by_extension test failed, JPG = " << get_mime_by_extension("JPG") << '\n';
+	else if (get_mime("/nonexistent/index.html", MimeMode::EXTENSION) != "text/html" ||
+			 get_mime("/nonexistent/.html", MimeMode::EXTENSION) != "application/octet-stream")
+		std::cerr << "get_mime_by_extension test failed, extension mode\n";
+	else
+		std::cerr << "get_mime_by_extension test success\n";
+
+	const std::vector<std::uint8_t> png{
+		0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n', 0, 0, 0, 13, 'I', 'H', 'D', 'R',
+		0,    0,   0,   1,   0,    0,    0,    1,    8, 6, 0, 0,  0,
+	};
+	const std::string_view css   = "body { color: red; }\n";
+	const std::uint8_t *css_data = reinterpret_cast<const std::uint8_t *>(css.data());
+	if (get_mime(png) != "image/png")
+		std::cerr << "get_mime buffer test failed, png = " << get_mime(png) << '\n';
+	else if (get_mime(css_data, css.size()) != "text/plain" || get_mime(css_data, css.size(), "css") != "text/css")
+		std::cerr << "get_mime buffer test failed, css = " << get_mime(css_data, css.size(), "css") << '\n';
+	else
+		std::cerr << "get_mime buffer test success\n";
+
+	// a database that cannot be loaded does not replace the current one
+	const bool bad_database = init_mime("/nonexistent/magic.mgc");
+	std::string thread_mime;
+	std::thread{[&thread_mime, argv] { thread_mime = get_mime(argv[0]); }}.join();
+	if (bad_database || get_mime(argv[0]) != mime)
+		std::cerr << "init_mime test failed, nonexistent database replaced the loaded one\n";
+	else if (!init_mime() || get_mime(argv[0]) != mime || thread_mime != mime)
+		std::cerr << "init_mime test failed, thread mime = " << thread_mime << '\n';
+	else
+		std::cerr << "init_mime test success\n";
+
+	const std::filesystem::path cache_file = std::filesystem::temp_directory_path() / "phase2_mime_cache.css";
+	std::ofstream{cache_file} << "body { color: red; }\n";
+	MimeCache cache{1, 1};
+	std::string cached1 = cache.getMime(cache_file);
+	std::string cached2 = cache.getMime(cache_file);
+	std::ofstream{cache_file, std::ios::app} << "p { color: blue; }\n";
+	std::string cached3 = cache.getMime(cache_file);
+	// a hard link is the same file, but its extension refines the type
+	const std::filesystem::path cache_link = std::filesystem::temp_directory_path() / "phase2_mime_cache.js";
+	std::error_code link_error;
+	std::filesystem::remove(cache_link, link_error);
+	std::filesystem::create_hard_link(cache_file, cache_link, link_error);
+	std::string cached4 = cache.getMime(cache_link);
+	cache.getMime(argv[0]);
+	if (cached1 != "text/css" || cached2 != cached1 || cached3 != cached1)
+		std::cerr << "MimeCache test1 failed, mime = " << cached1 << '\n';
+	else if (link_error || cached4 != get_mime_by_extension("js"))
+		std::cerr << "MimeCache test1 failed, hard link mime = " << cached4 << '\n';
+	else if (cache.getHits() != 1 || cache.getMisses() != 4 || cache.size() != 1)
+		std::cerr << "MimeCache test1 failed, hits = " << cache.getHits() << ", misses = " << cache.getMisses()
+				  << '\n';
+	else
+		std::cerr << "MimeCache test1 success\n";
+
+	{
+		MimeService service{2, &cache};
+		std::vector<std::future<std::string>> futures = service.submit({cache_file, argv[0], cache_file});
+		std::promise<std::string> callback_mime;
+		service.submit(argv[0], [&callback_mime](const std::filesystem::path &, std::string mime)
+					   { callback_mime.set_value(std::move(mime)); });
+		if (futures.size() != 3 || futures[0].get() != "text/css" || futures[1].get() != mime ||
+			futures[2].get() != "text/css")
+			std::cerr << "MimeService test1 failed, batch\n";
+		else if (callback_mime.get_future().get() != mime)
+			std::cerr << "MimeService test1 failed, callback\n";
+		else
+			std::cerr << "MimeService test1 success\n";
+	}
+	std::filesystem::remove(cache_file);
+	std::filesystem::remove(cache_link, link_error);
+
+	int log_evaluated = 0;
+	set_log_level(LogModule::URL, LogLevel::LOG_ERROR);
+	PHASE2_LOG(DEBUG, URL) << "filtered record " << ++log_evaluated;
+	PHASE2_LOG(ERROR, URL) << "PHASE2_LOG test record " << ++log_evaluated;
+	set_log_level(LogModule::URL, LogLevel::LOG_DEBUG);
+	if (log_evaluated != 1 || log_enabled(LogLevel::LOG_DEBUG, LogModule::GENERAL) != (LOG_FLOOR == LogLevel::LOG_DEBUG))
+		std::cerr << "PHASE2_LOG test failed, evaluated = " << log_evaluated << '\n';
+	else
+		std::cerr << "PHASE2_LOG test success\n";
+
+	int log_pipe[2];
+	std::size_t log_lines = 0;
+	if (::pipe(log_pipe) == 0 && start_async_log(log_pipe[1], 64, LogOverflow::BLOCK))
+	{
+		std::vector<std::thread> loggers;
+		for (int i = 0; i < 4; ++i)
+			loggers.emplace_back(
+				[i]
+				{
+					for (int j = 0; j < 100; ++j)
+						log_info << "async log test, thread " << i << ", record " << j;
+				});
+		for (std::thread &logger : loggers)
+			logger.join();
+		stop_async_log();
+		::close(log_pipe[1]);
+
+		char buf[4096];
+		ssize_t n;
+		while ((n = ::read(log_pipe[0], buf, sizeof(buf))) > 0)
+			log_lines += std::count(buf, buf + n, '\n');
+		::close(log_pipe[0]);
+	}
+	if (log_lines != 400 || get_dropped_logs() != 0)
+		std::cerr << "async log test failed, lines = " << log_lines << ", dropped = " << get_dropped_logs() << '\n';
+	else
+		std::cerr << "async log test success\n";
+
 	return 0;
 }
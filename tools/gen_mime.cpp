@@ -0,0 +1,85 @@
+/**
+ * @brief Generate the extension table of get_mime from a mime.types file.
+ *
+ * Usage: gen_mime <mime.types> <output>
+ *
+ * Every extension becomes a row {"extension", "MIME type", textual}, where
+ * textual tells whether libmagic would report files of the type as text, so
+ * get_mime only refines a generic libmagic answer of the same kind.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Check whether a MIME type is a text format.
+ */
+bool is_textual(std::string_view type)
+{
+	auto ends_with = [type](std::string_view suffix)
+	{ return type.size() >= suffix.size() && type.substr(type.size() - suffix.size()) == suffix; };
+
+	return type.substr(0, 5) == "text/" || ends_with("+xml") || ends_with("+json") ||
+		   type == "application/javascript" || type == "application/json" || type == "application/xml" ||
+		   type == "application/x-sh";
+}
+
+int main(int argc, char const *argv[])
+{
+	if (argc != 3)
+	{
+		std::cerr << "usage: " << argv[0] << " <mime.types> <output>\n";
+		return 1;
+	}
+
+	std::ifstream input{argv[1]};
+	if (!input)
+	{
+		std::cerr << argv[0] << ": unable to open " << argv[1] << '\n';
+		return 1;
+	}
+
+	std::ostringstream rows;
+	std::set<std::string> extensions;
+	std::string line;
+	for (std::size_t line_number = 1; std::getline(input, line); ++line_number)
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream words{line};
+		std::string type, extension;
+		if (!(words >> type))
+			continue;
+		if (type.find('/') == type.npos)
+		{
+			std::cerr << argv[1] << ':' << line_number << ": invalid MIME type " << type << '\n';
+			return 1;
+		}
+
+		while (words >> extension)
+		{
+			for (char &c : extension)
+				if (c >= 'A' && c <= 'Z')
+					c = static_cast<char>(c | 0x20);
+			if (!extensions.insert(extension).second)
+			{
+				std::cerr << argv[1] << ':' << line_number << ": duplicate extension " << extension << '\n';
+				return 1;
+			}
+			rows << "{\"" << extension << "\", \"" << type << "\", " << (is_textual(type) ? "true" : "false")
+				 << "},\n";
+		}
+	}
+
+	std::ofstream output{argv[2]};
+	output << "// Generated by tools/gen_mime.cpp from " << argv[1] << ", do not edit.\n" << rows.str();
+	if (!output)
+	{
+		std::cerr << argv[0] << ": unable to write " << argv[2] << '\n';
+		return 1;
+	}
+	return 0;
+}